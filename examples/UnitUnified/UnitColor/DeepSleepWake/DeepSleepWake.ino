@@ -0,0 +1,9 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Example using M5UnitUnified for UnitColor
+*/
+#include "main/DeepSleepWake.cpp"
@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Example using M5UnitUnified for UnitColor
+  Deep sleep until the clear channel leaves the window, woken by the INT line of the sensor.
+  The driver state is kept in RTC memory, so the sensor is not reconfigured on wake
+  and the first sample is read in a single bus transaction.
+
+  NOTICE: INT is not on the GROVE connector. Wire it (open drain, active low) to an RTC capable GPIO.
+  The input pin of PORT.B is used here, change int_pin for your wiring.
+  The internal pull-up of the RTC IO is kept during the deep sleep. On targets without RTC IO,
+  or for long wires, an external pull-up (e.g. 10k to 3.3V) is required.
+*/
+#include <M5Unified.h>
+#include <M5UnitUnified.h>
+#include <M5UnitUnifiedCOLOR.h>
+#include <M5Utility.h>
+#include <esp_sleep.h>
+#include <soc/soc_caps.h>
+#if SOC_RTCIO_INPUT_OUTPUT_SUPPORTED
+#include <driver/rtc_io.h>
+#endif
+
+using namespace m5::unit::tcs3472x;
+
+namespace {
+m5::unit::UnitUnified Units;
+m5::unit::UnitColor unit;
+
+// GPIO connected to INT of the sensor (RTC capable)
+gpio_num_t int_pin{GPIO_NUM_NC};
+// Wake if the clear channel is outside this window for the persistence
+constexpr uint16_t window_low{0x0100};
+constexpr uint16_t window_high{0x2000};
+constexpr Persistence persistence{Persistence::Cycle5};
+
+// Preserved across the deep sleep (zero on cold boot, rejected as invalid)
+RTC_DATA_ATTR RetainedState retained{};
+RTC_DATA_ATTR uint32_t wakes{};
+
+void sleep()
+{
+    if (int_pin == GPIO_NUM_NC || !esp_sleep_is_valid_wakeup_gpio(int_pin)) {
+        M5_LOGE("Invalid wake pin %d", int_pin);
+        return;
+    }
+    if (!unit.prepareSleep(retained, window_low, window_high, persistence)) {
+        M5_LOGE("Failed to prepare");
+        return;
+    }
+#if SOC_PM_SUPPORT_EXT0_WAKEUP || SOC_PM_SUPPORT_EXT_WAKEUP
+    esp_sleep_enable_ext0_wakeup(int_pin, 0);
+#elif SOC_PM_SUPPORT_EXT1_WAKEUP
+    esp_sleep_enable_ext1_wakeup(1ULL << int_pin, ESP_EXT1_WAKEUP_ANY_LOW);
+#if SOC_PM_SUPPORT_RTC_PERIPH_PD
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);  // Keep the pull-up
+#endif
+#else
+    M5_LOGE("No EXT wakeup on this target");
+    return;
+#endif
+#if SOC_RTCIO_INPUT_OUTPUT_SUPPORTED
+    // pinMode() pull-up is of the digital GPIO, which is not kept in the deep sleep
+    rtc_gpio_pullup_en(int_pin);
+    rtc_gpio_pulldown_dis(int_pin);
+#endif
+    M5_LOGI("Sleep");
+    M5.Log.flush();
+    esp_deep_sleep_start();
+}
+
+}  // namespace
+
+void setup()
+{
+    M5.begin();
+    int_pin = static_cast<gpio_num_t>(M5.getPin(m5::pin_name_t::port_b_in));
+
+    const bool woken = (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0);
+    if (woken) {
+        // Adopt the preserved state instead of configuring on begin
+        unit.resumeFrom(retained);
+        ++wakes;
+    } else {
+        auto cfg           = unit.config();
+        cfg.start_periodic = true;
+        cfg.atime          = 24.f;
+        cfg.wtime          = 614.4f;  // Lower power while sleeping
+        cfg.gain           = Gain::Controlx4;
+        unit.config(cfg);
+    }
+
+    auto pin_num_sda = M5.getPin(m5::pin_name_t::port_a_sda);
+    auto pin_num_scl = M5.getPin(m5::pin_name_t::port_a_scl);
+    Wire.end();
+    Wire.begin(pin_num_sda, pin_num_scl, 400 * 1000U);
+    if (!Units.add(unit, Wire) || !Units.begin()) {
+        M5_LOGE("Failed to begin");
+        while (true) {
+            m5::utility::delay(10000);
+        }
+    }
+    M5_LOGI("Woken:%u Resumed:%u Wakes:%lu", woken, unit.resumed(), (unsigned long)wakes);
+}
+
+void loop()
+{
+    M5.update();
+    Units.update();
+    if (unit.updated()) {
+        const auto& d = unit.latest();
+        M5.Log.printf("RGBC:%04X,%04X,%04X,%04X Lux:%.2f Transactions:%lu\n", d.R16(), d.G16(), d.B16(), d.C16(),
+                      calculateLux(d, unit.derived()), (unsigned long)unit.statistics().transactions);
+        // Back to sleep once the reading is inside the window again
+        if (d.C16() >= window_low && d.C16() <= window_high) {
+            sleep();
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Row-based dirty-region rendering helper for M5GFX
+  Each row (text line or color bar) is compared with the previous content,
+  and only changed rows are drawn into an off-screen row sprite and pushed.
+*/
+#ifndef M5_UNIT_COLOR_EXAMPLE_DIRTY_ROWS_HPP
+#define M5_UNIT_COLOR_EXAMPLE_DIRTY_ROWS_HPP
+
+#include <M5GFX.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+class DirtyRows {
+public:
+    /*!
+      @param dst Destination display
+      @param x Left of the area
+      @param y Top of the area
+      @param w Width of the area
+      @param row_h Height of the row
+      @param rows Number of the rows
+     */
+    DirtyRows(LovyanGFX* dst, const int32_t x, const int32_t y, const int32_t w, const int32_t row_h,
+              const uint8_t rows)
+        : _dst{dst}, _canvas{dst}, _x{x}, _y{y}, _w{w}, _h{row_h}, _rows(rows)
+    {
+    }
+
+    //! @brief Allocate the row sprite
+    bool begin(const lgfx::IFont* font = &fonts::AsciiFont8x16)
+    {
+        _canvas.setColorDepth(16);
+        if (!_canvas.createSprite(_w, _h)) {
+            return false;
+        }
+        _canvas.setFont(font);
+        _canvas.setTextColor(TFT_WHITE, TFT_BLACK);
+        return true;
+    }
+
+    //! @brief Set the text of the row (printf format, left offset in pixel)
+    void text(const uint8_t row, const int32_t left, const char* fmt, ...)
+    {
+        if (row >= _rows.size()) {
+            return;
+        }
+        char buf[sizeof(Row::text)]{};
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+
+        auto& r = _rows[row];
+        if (r.kind != Kind::Text || r.left != left || std::strcmp(r.text, buf) != 0) {
+            r.kind = Kind::Text;
+            r.left = left;
+            std::memcpy(r.text, buf, sizeof(buf));
+            r.dirty = true;
+        }
+    }
+
+    //! @brief Set the color bar of the row
+    void bar(const uint8_t row, const uint16_t color)
+    {
+        if (row >= _rows.size()) {
+            return;
+        }
+        auto& r = _rows[row];
+        if (r.kind != Kind::Bar || r.color != color) {
+            r.kind  = Kind::Bar;
+            r.color = color;
+            r.dirty = true;
+        }
+    }
+
+    //! @brief Draw and push the changed rows
+    //! @return Number of pushed rows
+    uint32_t push()
+    {
+        uint32_t cnt{};
+        for (size_t i = 0; i < _rows.size(); ++i) {
+            auto& r = _rows[i];
+            if (!r.dirty) {
+                continue;
+            }
+            _canvas.fillSprite(TFT_BLACK);
+            if (r.kind == Kind::Text) {
+                _canvas.setCursor(r.left, 0);
+                _canvas.print(r.text);
+            } else if (r.kind == Kind::Bar) {
+                _canvas.drawRect(0, 0, _w, _h - 1, TFT_WHITE);
+                _canvas.fillRect(1, 1, _w - 2, _h - 3, r.color);
+            }
+            _canvas.pushSprite(_dst, _x, _y + _h * static_cast<int32_t>(i));
+            r.dirty = false;
+            ++cnt;
+        }
+        return cnt;
+    }
+
+private:
+    enum class Kind : uint8_t { None, Text, Bar };
+    struct Row {
+        Kind kind{Kind::None};
+        bool dirty{};
+        int32_t left{};
+        uint16_t color{};
+        char text[48]{};
+    };
+
+    LovyanGFX* _dst{};
+    M5Canvas _canvas;
+    int32_t _x{}, _y{}, _w{}, _h{};
+    std::vector<Row> _rows{};
+};
+
+#endif
@@ -11,6 +11,8 @@
 #include <M5UnitUnifiedCOLOR.h>
 #include <M5Utility.h>
 #include <M5HAL.hpp>
+#include <memory>
+#include "DirtyRows.hpp"
 
 using namespace m5::unit::tcs3472x;
 
@@ -19,9 +21,14 @@ auto& lcd = M5.Display;
 m5::unit::UnitUnified Units;
 m5::unit::UnitColor unit;
 
-float atime{}, max_lux{};
-Gain gc{};
-uint16_t saturation{};
+// Display is updated at this interval regardless of the sample rate, and only changed rows are pushed
+constexpr uint32_t frame_interval_ms{50};
+std::unique_ptr<DirtyRows> textRows{}, barRows{};
+Data latest{};
+bool has_new{};
+bool narrow{};
+m5::unit::types::elapsed_time_t last_sample_at{}, last_frame_at{};
+uint32_t frame_time_us{}, dropped{};
 
 // ************************************************************************
 // Self calibration
@@ -52,6 +59,13 @@ constexpr auto gammaTable = make_gamma_table(gamma_value);
 std::array<uint8_t, 256> gammaTable{};
 #endif
 
+// Conversion to the color bar
+using namespace m5::unit::tcs3472x::pipeline;
+Pipeline<Raw, ClearRatio, Linear, RGB565> toRGB;
+Pipeline<NoIR, ClearRatio, Linear, RGB565> toRGBnoIR;
+Pipeline<NoIR, Calibrate, Linear, RGB565> toCalibrated{Calibrate{calib}};
+Pipeline<NoIR, Calibrate, Gamma, RGB565> toGamma{Calibrate{calib}, Gamma{gammaTable}};
+
 #if 0
 uint16_t correction_for_blue(const Data& d)
 {
@@ -138,16 +152,9 @@ void setup()
     M5_LOGI("M5UnitUnified has been begun");
     M5_LOGI("%s", Units.debugInfo().c_str());
 
-    if (!unit.readGain(gc) || !unit.readAtime(atime)) {
-        M5_LOGE("Failed to read");
-        lcd.fillScreen(TFT_BLUE);
-        while (true) {
-            m5::utility::delay(10000);
-        }
-    }
-    saturation = calculateSaturation(atime);
-    max_lux    = calculateMaxLux(atime, gc);
-    M5_LOGI("ATIME:%f GAIN:%u SAT:%u MLUX:%f ", atime, gc, saturation, max_lux);
+    // Constants derived from the current settings (no need to read back)
+    const auto& k = unit.derived();
+    M5_LOGI("ATIME:%f GAIN:%u SAT:%u MLUX:%f ", k.atime_ms, k.gain, k.saturation, k.max_lux);
 
 #if !defined(M5_UNIT_COLOR_UTILITY_UNIT_COLOR_UTILITY_CAN_CONSTEXPR_MAKE_GAMMA_TABLE)
     gammaTable = make_gamma_table(gamma_value);
@@ -155,6 +162,66 @@ void setup()
 
     lcd.setFont(&fonts::AsciiFont8x16);
     lcd.fillScreen(TFT_BLACK);
+
+    if (!lcd.isEPD()) {
+        narrow              = lcd.width() < 200;
+        const uint8_t lines = narrow ? 5 : 6;
+        const int32_t top   = narrow ? 0 : 8;
+        const int32_t y     = top + 16 * lines;
+        int32_t h           = (lcd.height() - y) / 4;
+        if (h > 16) {
+            h = 16;
+        }
+        textRows.reset(new DirtyRows(&lcd, 0, top, lcd.width(), 16, lines));
+        barRows.reset(new DirtyRows(&lcd, 0, y, lcd.width(), h, 4));
+        if (!textRows->begin() || !barRows->begin()) {
+            M5_LOGE("Failed to create sprites");
+            textRows.reset();
+            barRows.reset();
+        }
+    }
+}
+
+void update_display()
+{
+    const auto& d = latest;
+    const uint8_t cr{calib.R8(d)}, cg{calib.G8(d)}, cb{calib.B8(d)};
+
+    // Information
+    // 1st : RGB
+    // 2nd : RGB without IR
+    // 3rd : Calibrated RGB
+    // 4th : Gamma correction of calibrated values
+    // 5th : RAW RGBC (wide display only)
+    // Last: Frame time and dropped samples
+    if (narrow) {
+        // Short format for small screens (e.g. AtomS3 128x128)
+        textRows->text(0, 0, "RGB %3u,%3u,%3u", d.R8(), d.G8(), d.B8());
+        textRows->text(1, 0, "noI %3u,%3u,%3u", d.RnoIR8(), d.GnoIR8(), d.BnoIR8());
+        textRows->text(2, 0, "Cal %3u,%3u,%3u", cr, cg, cb);
+        textRows->text(3, 0, "Gam %3u,%3u,%3u", gammaTable[cr], gammaTable[cg], gammaTable[cb]);
+        textRows->text(4, 0, "F%4luus D%lu", (unsigned long)frame_time_us, (unsigned long)dropped);
+    } else {
+        textRows->text(0, 16, "    RGB(%3u,%3u,%3u)", d.R8(), d.G8(), d.B8());
+        textRows->text(1, 16, "RGBnoIR(%3u,%3u,%3u)", d.RnoIR8(), d.GnoIR8(), d.BnoIR8());
+        textRows->text(2, 16, "RGBCalb(%3u,%3u,%3u)", cr, cg, cb);
+        textRows->text(3, 16, "CalbGam(%3u,%3u,%3u)", gammaTable[cr], gammaTable[cg], gammaTable[cb]);
+        textRows->text(4, 16, "RAW:(%04X,%04X,%04X) %04X", d.R16(), d.G16(), d.B16(), d.C16());
+        textRows->text(5, 16, "Frame:%5luus Drop:%lu", (unsigned long)frame_time_us, (unsigned long)dropped);
+    }
+
+    // Color bar (1:RGB / 2:RGB without IR / 3:Calibrated / 4:Gamma)
+    barRows->bar(0, toRGB(d));
+    barRows->bar(1, toRGBnoIR(d));
+    barRows->bar(2, toCalibrated(d));
+    barRows->bar(3, toGamma(d));
+
+    auto start = m5::utility::micros();
+    lcd.startWrite();
+    textRows->push();
+    barRows->push();
+    lcd.endWrite();
+    frame_time_us = m5::utility::micros() - start;
 }
 
 void loop()
@@ -164,72 +231,36 @@ void loop()
 
     if (unit.updated()) {
         const auto& oldest = unit.oldest();
-        uint16_t colors[4]{};
-
-        colors[0] = unit.RGB565();
-        colors[1] = oldest.RGBnoIR565();
-        colors[2] = Data::color565(calib.R8(oldest), calib.G8(oldest), calib.B8(oldest));
-        colors[3] =
-            Data::color565(gammaTable[calib.R8(oldest)], gammaTable[calib.G8(oldest)], gammaTable[calib.B8(oldest)]);
-
-        if (!lcd.isEPD()) {
-            bool narrow = lcd.width() < 200;
-            lcd.startWrite();
-            // Information
-            // 1st : RGB
-            // 2nd : RGB without IR
-            // 3rd : Calibrated RGB
-            // 4th : Gamma correction of calibrated values
-            // 5th : RAW RGBC (wide display only)
-            if (narrow) {
-                // Short format for small screens (e.g. AtomS3 128x128)
-                lcd.setCursor(0, 0 + 16 * 0);
-                lcd.printf("RGB %3u,%3u,%3u", unit.R8(), unit.G8(), unit.B8());
-                lcd.setCursor(0, 0 + 16 * 1);
-                lcd.printf("noI %3u,%3u,%3u", oldest.RnoIR8(), oldest.GnoIR8(), oldest.BnoIR8());
-                lcd.setCursor(0, 0 + 16 * 2);
-                lcd.printf("Cal %3u,%3u,%3u", calib.R8(oldest), calib.G8(oldest), calib.B8(oldest));
-                lcd.setCursor(0, 0 + 16 * 3);
-                lcd.printf("Gam %3u,%3u,%3u", gammaTable[calib.R8(oldest)], gammaTable[calib.G8(oldest)],
-                           gammaTable[calib.B8(oldest)]);
-            } else {
-                lcd.setCursor(16, 8 + 16 * 0);
-                lcd.printf("    RGB(%3u,%3u,%3u)", unit.R8(), unit.G8(), unit.B8());
-                lcd.setCursor(16, 8 + 16 * 1);
-                lcd.printf("RGBnoIR(%3u,%3u,%3u)", oldest.RnoIR8(), oldest.GnoIR8(), oldest.BnoIR8());
-                lcd.setCursor(16, 8 + 16 * 2);
-                lcd.printf("RGBCalb(%3u,%3u,%3u)", calib.R8(oldest), calib.G8(oldest), calib.B8(oldest));
-                lcd.setCursor(16, 8 + 16 * 3);
-                lcd.printf("CalbGam(%3u,%3u,%3u)", gammaTable[calib.R8(oldest)], gammaTable[calib.G8(oldest)],
-                           gammaTable[calib.B8(oldest)]);
-                lcd.setCursor(16, 8 + 16 * 4);
-                lcd.printf("RAW:(%04X,%04X,%04X) %04X", oldest.R16(), oldest.G16(), oldest.B16(), oldest.C16());
-            }
-            lcd.endWrite();
-
-            // Color bar (1:RGB / 2:RGB without IR / 3:Calibrated / 4:Gamma)
-            int32_t y = narrow ? 16 * 4 : 8 + 16 * 5;
-            int32_t h = (lcd.height() - y) / 4;
-            if (h > 16) {
-                h = 16;
-            }
-            for (uint32_t i = 0; i < 4; ++i) {
-                lcd.drawRect(0, y + h * i, lcd.width(), h - 1, TFT_WHITE);
-                lcd.fillRect(1, y + h * i + 1, lcd.width() - 2, h - 3, colors[i]);
-            }
+        const auto& k      = unit.derived();
+
+        // Count the sensor cycles missed since the previous sample
+        auto now = m5::utility::millis();
+        if (last_sample_at && k.interval_ms > 0.0f) {
+            auto cycles = static_cast<uint32_t>((now - last_sample_at) / k.interval_ms + 0.5f);
+            dropped += (cycles > 1) ? cycles - 1 : 0;
         }
+        last_sample_at = now;
+        latest         = oldest;
+        has_new        = true;
 
         // Serial
-        auto lux    = calculateLux(oldest.R16(), oldest.G16(), oldest.B16(), oldest.C16(), atime, gc);
-        auto ct     = calculateColorTemperature(oldest.R16(), oldest.G16(), oldest.B16(), oldest.C16());
+        auto lux    = calculateLux(oldest, k);
+        auto ct     = calculateColorTemperature(oldest);
         auto cratio = calculateCRATIO(oldest.R16(), oldest.G16(), oldest.B16(), oldest.C16());
-        if (oldest.C16() >= saturation) {
+        if (oldest.C16() >= k.saturation) {
             M5_LOGW("Detect saturation");
             lux = ct = cratio = 0;
         }
         M5.Log.printf("RGB(%3u,%3u,%3u) RGBC:%04X,%04X,%04X,%04X Sat?:%u IR:%d Lux:%.2f CTemp:%.2f CRATIO:%.2f\n",
                       unit.R8(), unit.G8(), unit.B8(), oldest.R16(), oldest.G16(), oldest.B16(), oldest.C16(),
-                      (oldest.C16() >= saturation), oldest.IR(), lux, ct, cratio);
+                      (oldest.C16() >= k.saturation), oldest.IR(), lux, ct, cratio);
+    }
+
+    // Display
+    if (has_new && textRows && m5::utility::millis() - last_frame_at >= frame_interval_ms) {
+        last_frame_at = m5::utility::millis();
+        has_new       = false;
+        update_display();
     }
 
     // Single shot
@@ -239,6 +270,7 @@ void loop()
             M5.Log.printf("\tSingle: RGB(%3u,%3u,%3u) RGBC:%04X,%04X,%04X,%04X\n", d.R8(), d.G8(), d.B8(), d.R16(),
                           d.G16(), d.B16(), d.C16());
             unit.startPeriodicMeasurement();
+            last_sample_at = 0;
         }
     }
 }
@@ -15,6 +15,18 @@
 
 #include "unit/unit_TCS3472x.hpp"
 #include "utility/unit_color_utility.hpp"
+#include "utility/unit_color_inference.hpp"
+#include "utility/unit_color_trace.hpp"
+#include "utility/unit_color_pipeline.hpp"
+#include "utility/unit_color_sweep.hpp"
+#include "utility/unit_color_uncertainty.hpp"
+#include "utility/unit_color_marker.hpp"
+#include "utility/unit_color_spc.hpp"
+#include "utility/unit_color_calibrator.hpp"
+#include "utility/unit_color_hotswap.hpp"
+#include "utility/unit_color_memo.hpp"
+#include "utility/unit_color_crosscore.hpp"
+#include "utility/unit_color_array.hpp"
 
 /*!
   @namespace m5
@@ -8,7 +8,10 @@
   @brief TCS3472x Unit for M5UnitUnified
 */
 #include "unit_TCS3472x.hpp"
+#include "unit_TCS3472x_register.hpp"
 #include "../utility/unit_color_utility.hpp"
+#include "../utility/unit_color_trace.hpp"
+#include "../utility/unit_color_spc.hpp"
 #include <M5Utility.hpp>
 #include <cmath>
 
@@ -35,71 +38,116 @@ struct Command {
 };
 constexpr uint8_t clear_channel_interrupt_clear{Command::CMD | 0x66};  // Special function
 
-struct Enable {
-    inline bool AIEN() const
-    {
-        return value & (1U << 4);
-    }
-    inline bool WEN() const
-    {
-        return value & (1U << 3);
-    }
-    inline bool AEN() const
-    {
-        return value & (1U << 1);
-    }
-    inline bool PON() const
-    {
-        return value & (1U << 0);
-    }
-    //
-    inline void AIEN(const bool b)
-    {
-        value = (value & ~(1U << 4)) | ((b != false) << 4);
-    }
-    inline void WEN(const bool b)
-    {
-        value = (value & ~(1U << 3)) | ((b != false) << 3);
+// Frequently used ENABLE updates
+constexpr auto power_on  = ENABLE::PON::value<1>();
+constexpr auto rgbc_run  = Compose<FieldValue<ENABLE::PON, 1>, FieldValue<ENABLE::AEN, 1>>::update();
+constexpr auto rgbc_stop = ENABLE::AEN::value<0>();
+
+// One step lower sensitivity (about 1/4)
+bool lower_sensitivity(Gain& gc, uint8_t& atime)
+{
+    if (gc != Gain::Controlx1) {
+        gc = static_cast<Gain>(m5::stl::to_underlying(gc) - 1);
+        return true;
     }
-    inline void AEN(const bool b)
-    {
-        value = (value & ~(1U << 1)) | ((b != false) << 1);
+    const uint16_t steps = 256 - atime;
+    if (steps > 1) {
+        atime = static_cast<uint8_t>(256 - std::max<uint16_t>(steps >> 2, 1));
+        return true;
     }
-    inline void PON(const bool b)
-    {
-        value = (value & ~(1U << 0)) | ((b != false) << 0);
+    return false;
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+// struct RetainedState
+uint16_t RetainedState::calculateChecksum() const
+{
+    // Member by member (padding is not retained by copies)
+    uint8_t buf[4 + 16 + sizeof(GainTable) + 4 + 1 + 1]{};
+    uint8_t* p = buf;
+    std::memcpy(p, &magic, 4);
+    p += 4;
+    std::memcpy(p, shadow.data(), shadow.size());
+    p += shadow.size();
+    std::memcpy(p, gains.data(), sizeof(GainTable));
+    p += sizeof(GainTable);
+    std::memcpy(p, &interval, 4);
+    p += 4;
+    *p++ = channels;
+    *p++ = periodic;
+
+    uint16_t s1{}, s2{};
+    for (auto&& b : buf) {
+        s1 = (s1 + b) % 255;
+        s2 = (s2 + s1) % 255;
     }
-    uint8_t value{};
-};
+    return (s2 << 8) | s1;
+}
 
-struct Config {
-    inline bool WLONG() const
-    {
-        return value & (1U << 1);
+// class Decimator
+bool Decimator::push(const Data& d)
+{
+    if (!_decimation) {
+        return false;
     }
-    inline void WLONG(const bool b)
-    {
-        value = (value & ~(1U << 1)) | ((b != false) << 1);
+    // Raw counts of different settings can not be aggregated
+    if (_samples && (d.atime != _atime || d.gain != _gain)) {
+        _samples = 0;
     }
-    uint8_t value{};
-};
-
-struct Status {
-    inline bool AINT() const
-    {
-        return value & (1U << 4);
+    const uint16_t v[4] = {d.C16(), d.R16(), d.G16(), d.B16()};
+    if (!_samples) {
+        _atime    = d.atime;
+        _gain     = d.gain;
+        _flags    = d.flags;
+        _channels = d.channels;
+        for (uint_fast8_t i = 0; i < 4; ++i) {
+            _acc[i] = v[i];
+        }
+    } else {
+        _flags |= d.flags;
+        _channels &= d.channels;
+        for (uint_fast8_t i = 0; i < 4; ++i) {
+            switch (_aggregation) {
+                case Aggregation::Mean:
+                    _acc[i] += v[i];
+                    break;
+                case Aggregation::Min:
+                    _acc[i] = std::min<uint32_t>(_acc[i], v[i]);
+                    break;
+                case Aggregation::Max:
+                    _acc[i] = std::max<uint32_t>(_acc[i], v[i]);
+                    break;
+                default:
+                    _acc[i] = v[i];
+                    break;
+            }
+        }
     }
-    inline bool AVALID() const
-    {
-        return value & (1U << 0);
+    if (++_samples < _decimation) {
+        return false;
     }
-    uint8_t value{};
-};
 
-}  // namespace
+    _output = Data{};
+    for (uint_fast8_t i = 0; i < 4; ++i) {
+        const uint32_t r = (_aggregation == Aggregation::Mean) ? (_acc[i] + _samples / 2) / _samples : _acc[i];
+        _output.raw[i * 2]     = r & 0xFF;
+        _output.raw[i * 2 + 1] = (r >> 8) & 0xFF;
+    }
+    _output.atime    = _atime;
+    _output.gain     = _gain;
+    _output.flags    = _flags;
+    _output.channels = _channels;
+    _samples         = 0;
+    ++_count;
+    return true;
+}
 
-namespace m5 {
-namespace unit {
+}  // namespace tcs3472x
 
 // class UnitTCS3472x
 const char UnitTCS3472x::name[] = "UnitTCS3472x";
@@ -118,32 +166,225 @@ bool UnitTCS3472x::begin()
         }
     }
 
+    _resumed = false;
+    if (_resume_pending) {
+        _resume_pending = false;
+        return resume();
+    }
+
     uint8_t id{};
     if (!read_register8(ID_REG, id) || !is_valid_id(id)) {
         M5_LIB_LOGE("Cannot detect %s %X", deviceName(), id);
         return false;
     }
+
+    // Synchronize the shadow
+    uint8_t regs[16]{};
+    if (!read_register(ENABLE_REG, regs, sizeof(regs))) {
+        M5_LIB_LOGE("Failed to read settings");
+        return false;
+    }
+    update_shadow(ENABLE_REG, regs, sizeof(regs));
     return _cfg.start_periodic ? start_periodic_measurement(_cfg.gain, _cfg.atime, _cfg.wtime) : true;
 }
 
 void UnitTCS3472x::update(const bool force)
 {
-    _updated = false;
+    M5_UNIT_COLOR_TRACE_SCOPE(Update);
+    _updated        = false;
+    _stream_updated = 0;
+    if (inTriggerMode()) {
+        update_trigger();
+        return;
+    }
     if (inPeriodic()) {
         elapsed_time_t at{m5::utility::millis()};
+
+        // Backoff after bus errors, then verify the device before resuming
+        if (_failures) {
+            if (at < _backoff_at) {
+                return;
+            }
+            if (!synchronize()) {
+                on_update_failure(at);
+                return;
+            }
+            _failures = 0;
+        }
+
         if (force || !_latest || at >= _latest + _interval) {
+            const auto errors = _stats.errors;
             Data d{};
-            _updated = is_data_ready() && read_measurement(d);
+            bool wake{};
+            if (_burst_next) {
+                // First sample after the wake
+                _burst_next = false;
+                wake        = true;
+                _updated    = read_status_and_measurement(d);
+            } else {
+                _updated = is_data_ready() && read_measurement(d);
+            }
+            if (_updated && _cfg.saturation_recovery && (d.channels & m5::stl::to_underlying(Channel::Clear)) &&
+                d.C16() >= calculateSaturation(d.atime)) {
+                const uint8_t enable = _shadow[ENABLE_REG];
+                recover_saturation(d, enable);
+                write_register8(ENABLE_REG, enable);  // Resume periodic
+                _interval = std::ceil(_derived.interval_ms);
+                at        = m5::utility::millis();
+            }
             if (_updated) {
-                _latest = at;
+                _latest = _checked_at = at;
                 _data->push_back(d);
+                feed_streams(d);
+            } else if (_stats.errors != errors) {
+                on_update_failure(m5::utility::millis());  // Back off from the end of the retries
+            } else if (wake || at > _checked_at + _interval * 2 + 100) {
+                // No data on the wake (INT should have woken us) or for too long, the device may have been reset
+                _checked_at = at;
+                synchronize();
             }
         }
     }
 }
 
+void UnitTCS3472x::on_update_failure(const types::elapsed_time_t at)
+{
+    ++_stats.missed;
+    _failures = std::min<uint8_t>(_failures + 1, 16);
+    _backoff_at = at + std::min<uint32_t>(1U << _failures, _cfg.max_backoff);
+}
+
+bool UnitTCS3472x::synchronize()
+{
+    M5_UNIT_COLOR_TRACE_SCOPE(Synchronize);
+    // Raw read (does not touch the shadow)
+    uint8_t buf[2]{};
+    Command cmd{ENABLE_REG, Command::Type::AutoIncrement};
+    if (writeWithTransaction(cmd.value.data(), 1U) != m5::hal::error::error_t::OK ||
+        readWithTransaction(buf, 2) != m5::hal::error::error_t::OK) {
+        ++_stats.errors;
+        return false;
+    }
+    count_transaction(3);
+    if (buf[0] == _shadow[ENABLE_REG] && buf[1] == _shadow[ATIME_REG]) {
+        return true;
+    }
+
+    // Power-on defaults means reset
+    const bool reset = (buf[0] == 0x00 && buf[1] == 0xFF);
+    M5_LIB_LOGW("Configuration mismatch E:%02X/%02X A:%02X/%02X %s", buf[0], _shadow[ENABLE_REG], buf[1],
+                _shadow[ATIME_REG], reset ? "(reset)" : "");
+    if (restore_configuration(reset)) {
+        ++_stats.recoveries;
+        _latest     = 0;
+        _checked_at = m5::utility::millis();
+        return true;
+    }
+    return false;
+}
+
+bool UnitTCS3472x::prepareSleep(tcs3472x::RetainedState& state, const uint16_t low, const uint16_t high,
+                                const tcs3472x::Persistence pers)
+{
+    if (!inPeriodic()) {
+        M5_LIB_LOGD("Periodic measurement is not running");
+        return false;
+    }
+    if (!writeInterruptThreshold(low, high) || !writePersistence(pers) || !writeInterrupt(true) ||
+        !clearInterrupt()) {
+        return false;
+    }
+    state          = RetainedState{};
+    state.magic    = RetainedState::MAGIC;
+    state.shadow   = _shadow;
+    state.gains    = _derived.gains;
+    state.interval = _interval;
+    state.channels = _cfg.channels;
+    state.periodic = _periodic;
+    state.checksum = state.calculateChecksum();
+    return true;
+}
+
+bool UnitTCS3472x::resumeFrom(const tcs3472x::RetainedState& state)
+{
+    if (!state.valid()) {
+        M5_LIB_LOGW("Invalid retained state");
+        return false;
+    }
+    _retained       = state;
+    _resume_pending = true;
+    return true;
+}
+
+bool UnitTCS3472x::resume()
+{
+    // Adopt the preserved state instead of reading the device
+    _derived.gains = _retained.gains;
+    update_shadow(ENABLE_REG, _retained.shadow.data(), _retained.shadow.size());
+    _cfg.channels = _retained.channels;
+    _periodic     = _retained.periodic;
+    _interval     = _retained.interval;
+    // The sleep duration is unknown, so the schedule restarts from the first sample (ready as INT woke us)
+    _latest     = 0;
+    _checked_at = m5::utility::millis();
+    _burst_next = _periodic;
+    _resumed    = true;
+    return true;
+}
+
+bool UnitTCS3472x::read_status_and_measurement(tcs3472x::Data& d)
+{
+    M5_UNIT_COLOR_TRACE_SCOPE(ReadMeasurement, STATUS_REG, 9);
+    uint8_t buf[1 + 8]{};
+    if (!read_register(STATUS_REG, buf, sizeof(buf)) || !STATUS::AVALID::get(buf[0])) {
+        return false;
+    }
+    Data nd{};  // Nothing of the previous contents of d (flags, IR cache) survives
+    std::memcpy(nd.raw.data(), buf + 1, nd.raw.size());
+    fill_settings(nd);
+    d = nd;
+    return true;
+}
+
+bool UnitTCS3472x::restore_configuration(const bool reset)
+{
+    // Power-on defaults of 0x00 - 0x0F
+    constexpr uint8_t defaults[16] = {0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00,
+                                      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    const auto shadow = _shadow;
+    auto need         = [&shadow, &defaults, reset](const uint8_t reg) {
+        return !reset || shadow[reg] != defaults[reg];
+    };
+
+    const uint8_t enable = shadow[ENABLE_REG];
+    const uint8_t pon    = ENABLE::PON::set(ENABLE::PON::get(enable)).apply(0x00);
+
+    // Configure while RGBC is disabled
+    bool ok = write_register8(ENABLE_REG, pon);
+    ok      = ok && (!need(ATIME_REG) || write_register8(ATIME_REG, shadow[ATIME_REG]));
+    ok      = ok && (!need(WTIME_REG) || write_register8(WTIME_REG, shadow[WTIME_REG]));
+    if (ok && (need(AILTL_REG) || need(AILTH_REG) || need(AIHTL_REG) || need(AIHTH_REG))) {
+        ok = write_register(AILTL_REG, shadow.data() + AILTL_REG, 4);
+    }
+    if (ok && need(PERS_REG)) {
+        ok = need(CONFIG_REG) ? write_register(PERS_REG, shadow.data() + PERS_REG, 2)
+                              : write_register8(PERS_REG, shadow[PERS_REG]);
+    } else if (ok && need(CONFIG_REG)) {
+        ok = write_register8(CONFIG_REG, shadow[CONFIG_REG]);
+    }
+    ok = ok && (!need(CONTROL_REG) || write_register8(CONTROL_REG, shadow[CONTROL_REG]));
+    if (ok && ENABLE::AEN::get(enable)) {
+        m5::utility::delay(3);  // PON to RGBC
+    }
+    return ok && (enable == pon || write_register8(ENABLE_REG, enable));
+}
+
 bool UnitTCS3472x::start_periodic_measurement(const tcs3472x::Gain gc, const float atime, const float wtime)
 {
+    if (inTriggerMode()) {
+        M5_LIB_LOGD("External trigger mode is running");
+        return false;
+    }
     if (inPeriodic()) {
         M5_LIB_LOGD("Periodic measurements are running");
         return false;
@@ -153,27 +394,28 @@ bool UnitTCS3472x::start_periodic_measurement(const tcs3472x::Gain gc, const flo
 
 bool UnitTCS3472x::start_periodic_measurement()
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(StartPeriodic);
+    if (inTriggerMode()) {
+        M5_LIB_LOGD("External trigger mode is running");
+        return false;
+    }
     if (inPeriodic()) {
         M5_LIB_LOGD("Periodic measurements are running");
         return false;
     }
 
-    Enable e{};
-    float atime{}, wtime{};
-    if (readAtime(atime) && readWtime(wtime) && read_register8(ENABLE_REG, e.value)) {
-        bool needWait = !e.PON();
-        e.PON(true);  // power on
-        e.AEN(true);  // RGBC enable
-        e.WEN(true);  // Wait enable
-        _periodic = write_register8(ENABLE_REG, e.value);
-        if (_periodic) {
-            _latest   = 0;
-            _interval = std::ceil(atime + wtime);
-            if (needWait) {
-                // Datasheet says
-                // A minimum interval of 2.4 ms must pass after PON is asserted before an RGBC can be initiated
-                m5::utility::delay(3);
-            }
+    // Settings from the shadow, no need to read
+    constexpr auto run   = rgbc_run | ENABLE::WEN::value<1>();
+    const uint8_t enable = _shadow[ENABLE_REG];
+    _periodic            = write_register8(ENABLE_REG, run.apply(enable));
+    if (_periodic) {
+        _latest     = 0;
+        _checked_at = m5::utility::millis();
+        _interval   = std::ceil(_derived.interval_ms);
+        if (!ENABLE::PON::get(enable)) {
+            // Datasheet says
+            // A minimum interval of 2.4 ms must pass after PON is asserted before an RGBC can be initiated
+            m5::utility::delay(3);
         }
     }
     return _periodic;
@@ -181,20 +423,21 @@ bool UnitTCS3472x::start_periodic_measurement()
 
 bool UnitTCS3472x::stop_periodic_measurement(const bool power_off)
 {
-    Enable e{};
-    if (read_register8(ENABLE_REG, e.value)) {
-        e.AEN(false);       // disable RGBC
-        e.PON(!power_off);  // power off if true
-        if (write_register8(ENABLE_REG, e.value)) {
-            _periodic = false;
-            return true;
-        }
+    M5_UNIT_COLOR_TRACE_SCOPE(StopPeriodic, power_off);
+    // Disable RGBC, and power off if true
+    if (write_register8(ENABLE_REG, (rgbc_stop | ENABLE::PON::set(!power_off)).apply(_shadow[ENABLE_REG]))) {
+        _periodic = false;
+        return true;
     }
     return false;
 }
 
 bool UnitTCS3472x::measureSingleshot(tcs3472x::Data& d, const tcs3472x::Gain gc, const float atime)
 {
+    if (inTriggerMode()) {
+        M5_LIB_LOGD("External trigger mode is running");
+        return false;
+    }
     if (inPeriodic()) {
         M5_LIB_LOGD("Periodic measurements are running");
         return false;
@@ -204,63 +447,213 @@ bool UnitTCS3472x::measureSingleshot(tcs3472x::Data& d, const tcs3472x::Gain gc,
 
 bool UnitTCS3472x::measureSingleshot(tcs3472x::Data& d)
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(Singleshot, m5::stl::to_underlying(shadow_gain()), shadow_atime());
+    if (inTriggerMode()) {
+        M5_LIB_LOGD("External trigger mode is running");
+        return false;
+    }
     if (inPeriodic()) {
         M5_LIB_LOGD("Periodic measurements are running");
         return false;
     }
 
-    Enable e{};
-    float atime{};
-    if (readAtime(atime) && read_register8(ENABLE_REG, e.value)) {
-        const auto original = e.value;
-        e.PON(true);  // power on
-        e.AEN(true);  // RGBC enable
-        if (!write_register8(ENABLE_REG, e.value)) {
+    const uint8_t original = _shadow[ENABLE_REG];
+    const uint8_t enable   = rgbc_run.apply(original);
+    if (!write_register8(ENABLE_REG, enable)) {
+        return false;
+    }
+    // Wait during ATIME
+    bool ret = wait_measurement(d, std::ceil(_derived.atime_ms) + (!ENABLE::PON::get(original) ? 3 : 0));
+    if (ret && _cfg.saturation_recovery && (d.channels & m5::stl::to_underlying(Channel::Clear)) &&
+        d.C16() >= calculateSaturation(d.atime)) {
+        recover_saturation(d, enable);
+    }
+    return write_register8(ENABLE_REG, original) && ret;
+}
+
+bool UnitTCS3472x::measureSingleshotSequence(tcs3472x::Data* out, const tcs3472x::Exposure* exposures,
+                                             const size_t num)
+{
+    M5_UNIT_COLOR_TRACE_SCOPE(Sequence, 0, num);
+    if (inTriggerMode()) {
+        M5_LIB_LOGD("External trigger mode is running");
+        return false;
+    }
+    if (inPeriodic()) {
+        M5_LIB_LOGD("Periodic measurements are running");
+        return false;
+    }
+    if (!out || !exposures || !num) {
+        return false;
+    }
+
+    const uint8_t original = _shadow[ENABLE_REG];
+    const uint8_t idle     = (power_on | rgbc_stop | ENABLE::WEN::value<0>()).apply(original);
+    const uint8_t run      = rgbc_run.apply(idle);
+
+    // Power on and set up the first shot
+    bool ok = write_register8(ENABLE_REG, idle) && apply_exposure(exposures[0]);
+    if (ok && !ENABLE::PON::get(original)) {
+        m5::utility::delay(3);  // PON to RGBC
+    }
+    ok = ok && write_register8(ENABLE_REG, run);
+    elapsed_time_t start_at = m5::utility::millis();
+
+    for (size_t i = 0; ok && i < num; ++i) {
+        ok = wait_ready(start_at, std::ceil(atime_to_ms(exposures[i].atime)));
+        // Start the next shot first, the result registers hold this shot until the next one completes
+        if (ok && i + 1 < num) {
+            ok = write_register8(ENABLE_REG, idle) && apply_exposure(exposures[i + 1]) &&
+                 write_register8(ENABLE_REG, run);
+            start_at = m5::utility::millis();
+        }
+        out[i] = Data{};
+        ok     = ok && read_measurement(out[i]);
+        // Settings of this shot (The shadow already points to the next one)
+        out[i].gain  = exposures[i].gain;
+        out[i].atime = exposures[i].atime;
+    }
+    return write_register8(ENABLE_REG, original) && ok;
+}
+
+bool UnitTCS3472x::setGainTable(const tcs3472x::GainTable& gains)
+{
+    for (uint_fast8_t i = 0; i < gains.size(); ++i) {
+        if (!(gains[i] > 0.0f) || (i && gains[i] <= gains[i - 1])) {
+            M5_LIB_LOGE("Invalid gain table");
             return false;
         }
-        uint32_t at     = std::ceil(atime);
-        auto timeout_at = m5::utility::millis() + at + 1000;
-        Enable orig_e{};
-        orig_e.value = original;
-        m5::utility::delay(at + (!orig_e.PON() ? 3 : 0));  // Wait during ATIME
-        do {
-            if (is_data_ready() && read_measurement(d)) {
-                return write_register8(ENABLE_REG, original);
-            }
-            m5::utility::delay(1);
-        } while (m5::utility::millis() <= timeout_at);
+    }
+    _derived = calculateDerivedConstants(_derived.atime, _derived.gain, _derived.interval_ms - _derived.atime_ms, DGF,
+                                         gains);
+    return true;
+}
 
-        return write_register8(ENABLE_REG, original);
+bool UnitTCS3472x::calibrateGainTable(tcs3472x::GainTable& gains, const uint8_t atime, const uint8_t repeats)
+{
+    if (!repeats || repeats > 4) {
+        return false;
+    }
+    // Palindromic sequence, so that the ratios of the steps up and down cancel a linear drift of the source
+    constexpr Gain order[6] = {Gain::Controlx1, Gain::Controlx4,  Gain::Controlx16,
+                               Gain::Controlx60, Gain::Controlx16, Gain::Controlx4};
+    Exposure exp[6 * 4 + 1]{};
+    Data out[6 * 4 + 1]{};
+    const size_t num = 6 * repeats + 1;
+    for (size_t i = 0; i < num; ++i) {
+        exp[i] = Exposure{order[i % 6], atime};
+    }
+    if (!measureSingleshotSequence(out, exp, num)) {
+        return false;
     }
+    if (!calculateGainTable(gains, out, num)) {
+        M5_LIB_LOGW("Failed to calibrate, the source may be too dark or too bright for ATIME:%u", atime);
+        return false;
+    }
+    return true;
+}
+
+bool UnitTCS3472x::apply_exposure(const tcs3472x::Exposure& exp)
+{
+    return (exp.gain == shadow_gain() ||
+            write_register8(CONTROL_REG, CONTROL::AGAIN::set(m5::stl::to_underlying(exp.gain)).apply(0x00))) &&
+           (exp.atime == shadow_atime() || write_register8(ATIME_REG, exp.atime));
+}
+
+bool UnitTCS3472x::wait_ready(const types::elapsed_time_t start_at, const uint32_t wait_ms)
+{
+    auto now = m5::utility::millis();
+    if (now < start_at + wait_ms) {
+        m5::utility::delay(start_at + wait_ms - now);
+    }
+    auto timeout_at = start_at + wait_ms + 1000;
+    do {
+        if (is_data_ready()) {
+            return true;
+        }
+        m5::utility::delay(1);
+    } while (m5::utility::millis() <= timeout_at);
     return false;
 }
 
-bool UnitTCS3472x::readPersistence(Persistence& pers)
+bool UnitTCS3472x::wait_measurement(tcs3472x::Data& d, const uint32_t wait_ms)
 {
-    uint8_t v{};
-    if (read_register8(PERS_REG, v)) {
-        pers = static_cast<Persistence>(v & 0x0F);
+    return wait_ready(m5::utility::millis(), wait_ms) && read_measurement(d);
+}
+
+bool UnitTCS3472x::recover_saturation(tcs3472x::Data& d, const uint8_t enable)
+{
+    Exposure exp{shadow_gain(), shadow_atime()};
+    if (!lower_sensitivity(exp.gain, exp.atime)) {
+        return false;  // Already the lowest sensitivity
+    }
+
+    // Stop the cycle, change settings and start a single integration without wait
+    if (!write_register8(ENABLE_REG, rgbc_stop.apply(enable)) || !apply_exposure(exp)) {
+        return false;
+    }
+    Data nd{};
+    if (write_register8(ENABLE_REG, (rgbc_run | ENABLE::WEN::value<0>()).apply(enable)) &&
+        wait_measurement(nd, std::ceil(atime_to_ms(exp.atime)))) {
+        nd.flags |= m5::stl::to_underlying(Flag::SaturationRecovered);
+        d = nd;
+        M5_LIB_LOGD("Recovered from saturation G:%u A:%u", exp.gain, exp.atime);
         return true;
     }
     return false;
 }
 
-bool UnitTCS3472x::writePersistence(const Persistence pers)
+void UnitTCS3472x::fill_settings(tcs3472x::Data& d) const
+{
+    d.atime = shadow_atime();
+    d.gain  = shadow_gain();
+}
+
+uint8_t UnitTCS3472x::shadow_atime() const
+{
+    return _shadow[ATIME_REG];
+}
+
+tcs3472x::Gain UnitTCS3472x::shadow_gain() const
+{
+    return static_cast<Gain>(CONTROL::AGAIN::get(_shadow[CONTROL_REG]));
+}
+
+void UnitTCS3472x::update_shadow(const uint8_t reg, const uint8_t* buf, const uint32_t len)
+{
+    bool settings{};
+    for (uint32_t r = reg; r < reg + len && r < _shadow.size(); ++r) {
+        _shadow[r] = buf[r - reg];
+        settings |= (r == ATIME_REG || r == WTIME_REG || r == CONFIG_REG || r == CONTROL_REG);
+    }
+    // Recalculate the derived constants if the settings are changed
+    if (settings) {
+        _derived = calculateDerivedConstants(shadow_atime(), shadow_gain(),
+                                             wtime_to_ms(_shadow[WTIME_REG], CONFIG::WLONG::get(_shadow[CONFIG_REG])),
+                                             DGF, _derived.gains);
+    }
+}
+
+bool UnitTCS3472x::readPersistence(Persistence& pers)
 {
     uint8_t v{};
     if (read_register8(PERS_REG, v)) {
-        v = (v & 0xF0) | (m5::stl::to_underlying(pers) & 0x0F);
-        return write_register8(PERS_REG, v);
+        pers = static_cast<Persistence>(PERS::APERS::get(v));
+        return true;
     }
-
     return false;
 }
 
+bool UnitTCS3472x::writePersistence(const Persistence pers)
+{
+    return write_register8(PERS_REG, PERS::APERS::set(m5::stl::to_underlying(pers)).apply(_shadow[PERS_REG]));
+}
+
 bool UnitTCS3472x::readGain(tcs3472x::Gain& gc)
 {
     uint8_t v{};
     if (read_register8(CONTROL_REG, v)) {
-        gc = static_cast<Gain>(v & 0x03);
+        gc = static_cast<Gain>(CONTROL::AGAIN::get(v));
         return true;
     }
     return false;
@@ -272,7 +665,8 @@ bool UnitTCS3472x::writeGain(const tcs3472x::Gain gc)
         M5_LIB_LOGD("Periodic measurements are running");
         return false;
     }
-    return write_register8(CONTROL_REG, m5::stl::to_underlying(gc) & 0x03);
+    return write_register8(CONTROL_REG,
+                           CONTROL::AGAIN::set(m5::stl::to_underlying(gc)).apply(_shadow[CONTROL_REG]));
 }
 
 bool UnitTCS3472x::readAtime(uint8_t& raw)
@@ -315,9 +709,9 @@ bool UnitTCS3472x::writeAtime(const float ms)
 
 bool UnitTCS3472x::readWtime(uint8_t& raw, bool& wlong)
 {
-    Config c{};
-    if (read_register8(WTIME_REG, raw) && read_register8(CONFIG_REG, c.value)) {
-        wlong = c.WLONG();
+    uint8_t v{};
+    if (read_register8(WTIME_REG, raw) && read_register8(CONFIG_REG, v)) {
+        wlong = CONFIG::WLONG::get(v);
         return true;
     }
     return false;
@@ -341,9 +735,8 @@ bool UnitTCS3472x::writeWtime(const uint8_t raw, const bool wlong)
         return false;
     }
 
-    Config c{};
-    c.WLONG(wlong);
-    return write_register8(WTIME_REG, raw) && write_register8(CONFIG_REG, c.value);
+    return write_register8(WTIME_REG, raw) &&
+           write_register8(CONFIG_REG, CONFIG::WLONG::set(wlong).apply(_shadow[CONFIG_REG]));
 }
 
 bool UnitTCS3472x::writeWtime(const float ms)
@@ -362,9 +755,9 @@ bool UnitTCS3472x::writeWtime(const float ms)
 
 bool UnitTCS3472x::readInterrupt(bool& enable)
 {
-    Enable e{};
-    if (read_register8(ENABLE_REG, e.value)) {
-        enable = e.AIEN();
+    uint8_t v{};
+    if (read_register8(ENABLE_REG, v)) {
+        enable = ENABLE::AIEN::get(v);
         return true;
     }
     return false;
@@ -372,12 +765,7 @@ bool UnitTCS3472x::readInterrupt(bool& enable)
 
 bool UnitTCS3472x::writeInterrupt(const bool enable)
 {
-    Enable e{};
-    if (read_register8(ENABLE_REG, e.value)) {
-        e.AIEN(enable);
-        return write_register8(ENABLE_REG, e.value);
-    }
-    return false;
+    return write_register8(ENABLE_REG, ENABLE::AIEN::set(enable).apply(_shadow[ENABLE_REG]));
 }
 
 bool UnitTCS3472x::readInterruptThreshold(uint16_t& low, uint16_t& high)
@@ -403,7 +791,15 @@ bool UnitTCS3472x::writeInterruptThreshold(const uint16_t low, const uint16_t hi
 
 bool UnitTCS3472x::clearInterrupt()
 {
-    return writeWithTransaction(&clear_channel_interrupt_clear, 1) == m5::hal::error::error_t::OK;
+    for (uint8_t i = 0;; ++i) {
+        if (writeWithTransaction(&clear_channel_interrupt_clear, 1) == m5::hal::error::error_t::OK) {
+            count_transaction(1);
+            return true;
+        }
+        if (!retry_transaction(i)) {
+            return false;
+        }
+    }
 }
 
 bool UnitTCS3472x::readStatus(uint8_t& status)
@@ -411,29 +807,275 @@ bool UnitTCS3472x::readStatus(uint8_t& status)
     return read_register8(STATUS_REG, status);
 }
 
+bool UnitTCS3472x::startTriggerMode(const tcs3472x::Gain gc, const uint8_t atime, const bool use_interrupt)
+{
+    if (inPeriodic() || inTriggerMode()) {
+        M5_LIB_LOGD("Measurements are running");
+        return false;
+    }
+
+    // Armed: powered, RGBC stopped. Settings are written in advance so that a trigger needs only one write
+    const uint8_t original = _shadow[ENABLE_REG];
+    const uint8_t pers     = _shadow[PERS_REG];
+    const uint8_t armed =
+        (power_on | rgbc_stop | ENABLE::WEN::value<0>() | ENABLE::AIEN::set(use_interrupt)).apply(original);
+    if (!apply_exposure(Exposure{gc, atime}) ||
+        (use_interrupt && (!write_register8(PERS_REG, PERS::APERS::set(0 /* Every */).apply(pers)) ||
+                           !clearInterrupt())) ||
+        !write_register8(ENABLE_REG, armed)) {
+        return false;
+    }
+    if (!ENABLE::PON::get(original)) {
+        m5::utility::delay(3);  // PON to RGBC
+    }
+    _trigger_aien      = ENABLE::AIEN::get(original);
+    _trigger_pers      = pers;
+    _trigger_interrupt = use_interrupt;
+    _trigger_running   = false;
+    _trigger_completed = false;
+    _trigger_pending   = false;
+    _triggered.clear();
+    _trigger_mode = true;
+    return true;
+}
+
+bool UnitTCS3472x::stopTriggerMode(const bool power_off)
+{
+    if (!inTriggerMode()) {
+        return true;
+    }
+    // Restore the interrupt settings of the user (e.g. the wake window of prepareSleep())
+    const auto disable = rgbc_stop | ENABLE::AIEN::set(_trigger_aien) | ENABLE::PON::set(!power_off);
+    if ((_shadow[PERS_REG] == _trigger_pers || write_register8(PERS_REG, _trigger_pers)) &&
+        write_register8(ENABLE_REG, disable.apply(_shadow[ENABLE_REG]))) {
+        _trigger_mode = _trigger_running = false;
+        _trigger_pending                 = false;
+        return true;
+    }
+    return false;
+}
+
+bool UnitTCS3472x::popTriggered(tcs3472x::TriggerResult& r)
+{
+    auto front = _triggered.front();
+    if (!front) {
+        return false;
+    }
+    r = front.value();
+    _triggered.pop_front();
+    return true;
+}
+
+UnitTCS3472x::trigger_statistics_t UnitTCS3472x::triggerStatistics() const
+{
+    trigger_statistics_t s = _trigger_stats;
+    s.dropped              = _trigger_dropped;
+    return s;
+}
+
+void UnitTCS3472x::resetTriggerStatistics()
+{
+    _trigger_stats   = trigger_statistics_t{};
+    _trigger_dropped = 0;
+}
+
+uint32_t UnitTCS3472x::triggerLatencyBound() const
+{
+    return 2400 /* RGBC init */ + static_cast<uint32_t>(_derived.atime_ms * 1000.0f) + TRIGGER_BUS_US;
+}
+
+int8_t UnitTCS3472x::addStream(const uint16_t decimation, const tcs3472x::Aggregation agg)
+{
+    if (!decimation) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < MAX_STREAMS; ++i) {
+        if (!_streams[i].enabled()) {
+            _streams[i] = Decimator(decimation, agg);
+            return static_cast<int8_t>(i);
+        }
+    }
+    M5_LIB_LOGW("No room for the stream");
+    return -1;
+}
+
+void UnitTCS3472x::clearStreams()
+{
+    _streams.fill(Decimator{});
+    _stream_updated = 0;
+}
+
+void UnitTCS3472x::feed_streams(const tcs3472x::Data& d)
+{
+    for (uint8_t i = 0; i < MAX_STREAMS; ++i) {
+        if (_streams[i].push(d)) {
+            _stream_updated |= (1U << i);
+        }
+    }
+    if (_drift) {
+        _drift->push(d, _derived);
+    }
+}
+
+void UnitTCS3472x::update_trigger()
+{
+    if (!_trigger_running) {
+        if (!_trigger_pending) {
+            return;
+        }
+        // Start the integration with a single write
+        M5_UNIT_COLOR_TRACE_SCOPE(TriggerStart);
+        _trigger_completed = false;
+        if (!write_register8(ENABLE_REG, rgbc_run.apply(_shadow[ENABLE_REG]))) {
+            ++_trigger_stats.failed;
+            _trigger_pending = false;
+            return;
+        }
+        _trigger_start    = static_cast<uint32_t>(m5::utility::micros());
+        _trigger_deadline = _trigger_start + triggerLatencyBound() - TRIGGER_BUS_US;
+        _trigger_running  = true;
+        return;
+    }
+
+    // Completion by INT, or by the elapsed time
+    const uint32_t now = static_cast<uint32_t>(m5::utility::micros());
+    if (!_trigger_completed && static_cast<int32_t>(now - _trigger_deadline) < 0) {
+        return;
+    }
+
+    // STATUS and all channels in a single burst
+    M5_UNIT_COLOR_TRACE_SCOPE(TriggerRead);
+    uint8_t buf[1 + 8]{};
+    if (!read_register(STATUS_REG, buf, sizeof(buf))) {
+        finish_trigger(false);
+        return;
+    }
+    if (!STATUS::AVALID::get(buf[0])) {
+        // Not yet (the INT pin may be shared), give up after a while
+        if (static_cast<int32_t>(now - _trigger_deadline) > 100 * 1000) {
+            M5_LIB_LOGW("Trigger timeout");
+            finish_trigger(false);
+        }
+        _trigger_completed = false;
+        return;
+    }
+
+    TriggerResult r{};
+    std::memcpy(r.data.raw.data(), buf + 1, r.data.raw.size());
+    fill_settings(r.data);
+    r.trigger_us  = _trigger_at;
+    r.dispatch_us = _trigger_start - r.trigger_us;
+    r.latency_us  = static_cast<uint32_t>(m5::utility::micros()) - r.trigger_us;
+
+    auto& s = _trigger_stats;
+    if (_triggered.full()) {
+        ++s.overflows;
+    }
+    _triggered.push_back(r);
+    feed_streams(r.data);
+    s.min_us = s.measured ? std::min(s.min_us, r.latency_us) : r.latency_us;
+    s.max_us = std::max(s.max_us, r.latency_us);
+    s.total_us += r.latency_us;
+    ++s.measured;
+    if (r.latency_us > triggerLatencyBound()) {
+        ++s.over_bound;
+    }
+    finish_trigger(true);
+}
+
+void UnitTCS3472x::finish_trigger(const bool ok)
+{
+    // Back to armed (RGBC must be stopped to restart the integration on the next trigger)
+    write_register8(ENABLE_REG, rgbc_stop.apply(_shadow[ENABLE_REG]));
+    if (_trigger_interrupt) {
+        clearInterrupt();
+    }
+    if (!ok) {
+        ++_trigger_stats.failed;
+    }
+    _trigger_running = false;
+    _trigger_pending = false;
+}
+
 //
 bool UnitTCS3472x::is_data_ready()
 {
-    Status s{};
-    return read_register8(STATUS_REG, s.value) && s.AVALID();
+    uint8_t v{};
+    const bool ready = read_register8(STATUS_REG, v) && STATUS::AVALID::get(v);
+    M5_UNIT_COLOR_TRACE(IsDataReady, ready);
+    return ready;
 }
 
 bool UnitTCS3472x::read_measurement(tcs3472x::Data& d)
 {
-    return read_register(CDATAL_REG, d.raw.data(), d.raw.size());
+    // Contiguous range covering the selected channels (C,R,G,B order)
+    const uint8_t mask = _cfg.channels & CHANNEL_ALL;
+    uint8_t first{}, last{3};
+    while (mask && !(mask & (1U << first))) {
+        ++first;
+    }
+    while (mask && !(mask & (1U << last))) {
+        --last;
+    }
+    const uint8_t offset = first * 2;
+    M5_UNIT_COLOR_TRACE_SCOPE(ReadMeasurement, CDATAL_REG + offset, (last - first + 1) * 2);
+    // Into a fresh one, so that unread channels are zero and flags and the IR cache are not left over when d is
+    // reused (d is untouched on failure)
+    Data nd{};
+    if (read_register(CDATAL_REG + offset, nd.raw.data() + offset, (last - first + 1) * 2)) {
+        fill_settings(nd);
+        nd.channels = static_cast<uint8_t>(((1U << (last + 1)) - 1) & ~((1U << first) - 1));
+        if (nd.channels != CHANNEL_ALL) {
+            nd.flags |= m5::stl::to_underlying(Flag::Partial);
+        }
+        d = nd;
+        return true;
+    }
+    return false;
+}
+
+bool UnitTCS3472x::retry_transaction(const uint8_t attempt)
+{
+    if (attempt < _cfg.retries) {
+        M5_UNIT_COLOR_TRACE(Retry, attempt);
+        ++_stats.retries;
+        m5::utility::delay(1U << attempt);
+        return true;
+    }
+    ++_stats.errors;
+    return false;
 }
 
 bool UnitTCS3472x::read_register8(const uint8_t reg, uint8_t& val)
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(ReadRegister, reg, 1);
     Command cmd{reg};
-    return (writeWithTransaction(cmd.value.data(), 1U) == m5::hal::error::error_t::OK) &&
-           (readWithTransaction(&val, 1) == m5::hal::error::error_t::OK);
+    for (uint8_t i = 0;; ++i) {
+        if ((writeWithTransaction(cmd.value.data(), 1U) == m5::hal::error::error_t::OK) &&
+            (readWithTransaction(&val, 1) == m5::hal::error::error_t::OK)) {
+            count_transaction(2);
+            return true;
+        }
+        if (!retry_transaction(i)) {
+            return false;
+        }
+    }
 }
 
 bool UnitTCS3472x::write_register8(const uint8_t reg, const uint8_t val)
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(WriteRegister, reg, 1);
     Command cmd{reg, val};
-    return writeWithTransaction(cmd.value.data(), cmd.value.size()) == m5::hal::error::error_t::OK;
+    for (uint8_t i = 0;; ++i) {
+        if (writeWithTransaction(cmd.value.data(), cmd.value.size()) == m5::hal::error::error_t::OK) {
+            update_shadow(reg, &val, 1);
+            count_transaction(2);
+            return true;
+        }
+        if (!retry_transaction(i)) {
+            return false;
+        }
+    }
 }
 
 #if 0
@@ -460,18 +1102,38 @@ bool UnitTCS3472x::write_register16(const uint8_t reg, const uint16_t val)
 
 bool UnitTCS3472x::read_register(const uint8_t reg, uint8_t* buf, const uint32_t len)
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(ReadRegister, reg, len);
     Command cmd{reg, Command::Type::AutoIncrement};
-    return (writeWithTransaction(cmd.value.data(), 1U) == m5::hal::error::error_t::OK) &&
-           (readWithTransaction(buf, len) == m5::hal::error::error_t::OK);
+    for (uint8_t i = 0;; ++i) {
+        if ((writeWithTransaction(cmd.value.data(), 1U) == m5::hal::error::error_t::OK) &&
+            (readWithTransaction(buf, len) == m5::hal::error::error_t::OK)) {
+            count_transaction(len + 1);
+            return true;
+        }
+        if (!retry_transaction(i)) {
+            return false;
+        }
+    }
 }
+
 bool UnitTCS3472x::write_register(const uint8_t reg, const uint8_t* buf, const uint32_t len)
 {
+    M5_UNIT_COLOR_TRACE_SCOPE(WriteRegister, reg, len);
     assert(len + 1 <= 32 && "write_register: buffer too large");
     Command cmd{reg, Command::Type::AutoIncrement};
     uint8_t wbuf[32]{};
     wbuf[0] = cmd.value[0];
     std::memcpy(wbuf + 1, buf, len);
-    return (writeWithTransaction(wbuf, len + 1) == m5::hal::error::error_t::OK);
+    for (uint8_t i = 0;; ++i) {
+        if (writeWithTransaction(wbuf, len + 1) == m5::hal::error::error_t::OK) {
+            update_shadow(reg, buf, len);
+            count_transaction(len + 1);
+            return true;
+        }
+        if (!retry_transaction(i)) {
+            return false;
+        }
+    }
 }
 
 // class UnitTCS34725
@@ -57,12 +57,108 @@ enum class Gain : uint8_t {
     Controlx60,  //!< 60x gain
 };
 
+/*!
+  @enum Channel
+  @brief Channel bits for the channel mask
+ */
+enum class Channel : uint8_t {
+    Clear = 0x01,  //!< Clear
+    Red   = 0x02,  //!< Red
+    Green = 0x04,  //!< Green
+    Blue  = 0x08,  //!< Blue
+};
+constexpr uint8_t CHANNEL_ALL{0x0F};  //!< All channels
+
+///@cond
+constexpr inline uint8_t operator|(const Channel a, const Channel b)
+{
+    return static_cast<uint8_t>(a) | static_cast<uint8_t>(b);
+}
+constexpr inline uint8_t operator|(const uint8_t a, const Channel b)
+{
+    return a | static_cast<uint8_t>(b);
+}
+///@endcond
+
+/*!
+  @enum Flag
+  @brief Attributes of the measurement data
+ */
+enum class Flag : uint8_t {
+    SaturationRecovered = 0x01,  //!< Re-measured with lower gain/ATIME after saturation
+    Partial             = 0x02,  //!< Only some channels are populated (See also Data::channels)
+};
+
+/*!
+  @enum Aggregation
+  @brief Aggregation function of the output stream
+ */
+enum class Aggregation : uint8_t {
+    Mean,  //!< Mean of each channel
+    Min,   //!< Minimum of each channel
+    Max,   //!< Maximum of each channel
+    Last,  //!< Last sample
+};
+
+/*!
+  @struct Exposure
+  @brief Gain and ATIME pair
+ */
+struct Exposure {
+    Gain gain{Gain::Controlx1};  //!< Gain
+    uint8_t atime{0xFF};         //!< ATIME raw value
+
+    Exposure()
+    {
+    }
+    /*!
+      @param gc Gain
+      @param at ATIME raw value
+     */
+    Exposure(const Gain gc, const uint8_t at) : gain{gc}, atime{at}
+    {
+    }
+};
+
+//! @brief Gain factor of each gain (x1, x4, x16, x60)
+using GainTable = std::array<float, 4>;
+//! @brief Nominal gain factors of the datasheet
+constexpr GainTable NOMINAL_GAINS{{1.0f, 4.0f, 16.0f, 60.0f}};
+
+/*!
+  @struct DerivedConstants
+  @brief Constants derived from the settings
+  @details Held by UnitTCS3472x and recalculated whenever gain, ATIME or WTIME are changed.
+  See also calculateDerivedConstants(), calculateLux(const Data&, const DerivedConstants&)
+ */
+struct DerivedConstants {
+    uint8_t atime{0xFF};             //!< ATIME raw value
+    Gain gain{Gain::Controlx1};      //!< Gain
+    float atime_ms{};                //!< Integration time(ms)
+    float interval_ms{};             //!< Integration and wait time(ms)
+    uint16_t saturation{};           //!< Saturation value of the clear channel
+    float cpl{};                     //!< Counts per Lux
+    float inv_cpl{};                 //!< 1 / CPL
+    float max_lux{};                 //!< Maximum Lux(lx)
+    GainTable gains{NOMINAL_GAINS};  //!< Gain factors used
+};
+
 /*!
   @struct Data
   @brief Measurement data group
  */
 struct Data {
-    std::array<uint8_t, 8> raw{};  //!< Raw data ClCh/RlRh/GlGh/BlBh
+    std::array<uint8_t, 8> raw{};   //!< Raw data ClCh/RlRh/GlGh/BlBh
+    uint8_t atime{};                //!< ATIME raw value used for the measurement
+    Gain gain{};                    //!< Gain used for the measurement
+    uint8_t flags{};                //!< Flags (bitwise OR of Flag)
+    uint8_t channels{CHANNEL_ALL};  //!< Populated channels (bitwise OR of Channel)
+
+    //! @brief Has the flag?
+    inline bool hasFlag(const Flag f) const
+    {
+        return flags & m5::stl::to_underlying(f);
+    }
 
     ///@name Raw value
     ///@{
@@ -224,6 +320,112 @@ private:
     mutable bool _cacheValid{};  // True if _cache holds a computed value
 };
 
+/*!
+  @struct TriggerResult
+  @brief Result of the externally triggered measurement
+ */
+struct TriggerResult {
+    Data data{};             //!< Measured data
+    uint32_t trigger_us{};   //!< Time of the trigger (us)
+    uint32_t dispatch_us{};  //!< Trigger to the start of the integration (us)
+    uint32_t latency_us{};   //!< Trigger to the result (us)
+};
+
+/*!
+  @struct RetainedState
+  @brief Driver state preserved across the deep sleep of the MCU (e.g. in RTC_DATA_ATTR memory)
+  @details Validated by the magic and the checksum, so zero or garbage memory on cold boot is rejected
+ */
+struct RetainedState {
+    uint32_t magic{};                  //!< MAGIC if stored
+    std::array<uint8_t, 16> shadow{};  //!< Shadow of the registers 0x00 - 0x0F
+    GainTable gains{NOMINAL_GAINS};    //!< Gain factors
+    uint32_t interval{};               //!< Measurement interval (ms)
+    uint8_t channels{};                //!< Channels to be read
+    bool periodic{};                   //!< Periodic measurement was running
+    uint16_t checksum{};               //!< Checksum of the above
+
+    //! @brief Stored and not corrupted?
+    inline bool valid() const
+    {
+        return magic == MAGIC && checksum == calculateChecksum();
+    }
+    //! @brief Fletcher-16 of the members except checksum
+    uint16_t calculateChecksum() const;
+
+    static constexpr uint32_t MAGIC{0x54435331};  //!< "TCS1"
+};
+
+/*!
+  @class Decimator
+  @brief Incremental decimation with aggregation
+  @details Aggregates each channel of every decimation samples into one output with fixed memory.
+  The window restarts if the gain/ATIME changes (e.g. saturation recovery), because raw counts of different
+  settings can not be aggregated. Flags of the output are the OR, channels are the AND of the window
+ */
+class Decimator {
+public:
+    Decimator()
+    {
+    }
+    /*!
+      @param decimation Number of samples per output (0: disabled)
+      @param agg Aggregation function
+     */
+    Decimator(const uint16_t decimation, const Aggregation agg) : _decimation{decimation}, _aggregation{agg}
+    {
+    }
+
+    //! @brief Enabled?
+    inline bool enabled() const
+    {
+        return _decimation != 0;
+    }
+    //! @brief Gets the decimation factor
+    inline uint16_t decimation() const
+    {
+        return _decimation;
+    }
+    //! @brief Gets the aggregation function
+    inline Aggregation aggregation() const
+    {
+        return _aggregation;
+    }
+    //! @brief Gets the latest output
+    inline const Data& output() const
+    {
+        return _output;
+    }
+    //! @brief Number of outputs so far
+    inline uint32_t count() const
+    {
+        return _count;
+    }
+    /*!
+      @brief Push the sample
+      @return True if the output is produced
+     */
+    bool push(const Data& d);
+    //! @brief Discard the current window
+    inline void reset()
+    {
+        _samples = 0;
+    }
+
+private:
+    uint16_t _decimation{}, _samples{};
+    Aggregation _aggregation{};
+    uint8_t _atime{}, _flags{}, _channels{};
+    Gain _gain{};
+    uint32_t _acc[4]{};  // C,R,G,B
+    uint32_t _count{};
+    Data _output{};
+};
+
+namespace spc {
+class Monitor;
+}
+
 }  // namespace tcs3472x
 
 /*!
@@ -248,6 +450,48 @@ public:
         float wtime{2.4f};
         //! Gain if start on begin
         tcs3472x::Gain gain{tcs3472x::Gain::Controlx4};
+        //! Re-measure with lower gain/ATIME immediately if saturated?
+        bool saturation_recovery{false};
+        //! Channels to be read (bitwise OR of tcs3472x::Channel)
+        uint8_t channels{tcs3472x::CHANNEL_ALL};
+        //! Number of retries for a failed transaction (n-th retry waits 2^n ms)
+        uint8_t retries{2};
+        //! Maximum backoff time(ms) of update() after consecutive bus errors
+        uint32_t max_backoff{1000};
+    };
+
+    /*!
+      @struct statistics_t
+      @brief Bus cost, error and recovery counters
+     */
+    struct statistics_t {
+        uint32_t errors{};        //!< Transactions failed even after retries
+        uint32_t retries{};       //!< Retry attempts
+        uint32_t missed{};        //!< update() cycles lost by bus errors
+        uint32_t recoveries{};    //!< Configuration restored after device reset detected
+        uint32_t transactions{};  //!< Successful register accesses
+        uint32_t bytes{};         //!< Bytes transferred by successful accesses (including the command byte)
+    };
+
+    /*!
+      @struct trigger_statistics_t
+      @brief Counters and latency of the external trigger mode
+     */
+    struct trigger_statistics_t {
+        uint32_t measured{};    //!< Results queued
+        uint32_t dropped{};     //!< Triggers ignored while measuring
+        uint32_t failed{};      //!< Triggers lost by bus errors or timeout
+        uint32_t overflows{};   //!< Results discarded because the queue was full
+        uint32_t over_bound{};  //!< Results exceeding triggerLatencyBound()
+        uint32_t min_us{};      //!< Minimum latency (us)
+        uint32_t max_us{};      //!< Maximum latency (us)
+        uint64_t total_us{};    //!< Sum of the latencies (us)
+
+        //! @brief Average latency (us)
+        inline uint32_t average() const
+        {
+            return measured ? static_cast<uint32_t>(total_us / measured) : 0;
+        }
     };
 
     /*!
@@ -287,6 +531,116 @@ public:
     }
     ///@}
 
+    ///@name Saturation recovery
+    ///@{
+    //! @brief Is saturation recovery enabled?
+    inline bool saturationRecovery() const
+    {
+        return _cfg.saturation_recovery;
+    }
+    /*!
+      @brief Enable/disable saturation recovery
+      @param enable True to enable
+      @details If the clear channel reaches the saturation value,
+      one step lower gain (or 1/4 ATIME at Controlx1) is written and a fresh single integration is taken immediately.
+      The sample is flagged with Flag::SaturationRecovered, and the lowered settings remain in effect.
+      Applies to update() and measureSingleshot()
+     */
+    inline void saturationRecovery(const bool enable)
+    {
+        _cfg.saturation_recovery = enable;
+    }
+    ///@}
+
+    ///@name Channel mask
+    ///@{
+    //! @brief Gets the channels to be read
+    inline uint8_t channelMask() const
+    {
+        return _cfg.channels;
+    }
+    /*!
+      @brief Set the channels to be read
+      @param mask Bitwise OR of tcs3472x::Channel (0 means all)
+      @details Only the contiguous register range covering the selected channels is read
+      (e.g. Clear only: 2 bytes, Clear and Green: 6 bytes instead of 8).
+      Samples that do not contain all channels are flagged with Flag::Partial and
+      the channels not read are zero, so IR/noIR/ratio values are meaningless for them.
+      Applies to periodic and single shot measurement.
+      Saturation recovery works only if Clear is included
+     */
+    inline void channelMask(const uint8_t mask)
+    {
+        _cfg.channels = (mask & tcs3472x::CHANNEL_ALL) ? (mask & tcs3472x::CHANNEL_ALL) : tcs3472x::CHANNEL_ALL;
+    }
+    ///@}
+
+    ///@name Derived constants
+    ///@{
+    /*!
+      @brief Gets the constants derived from the current settings
+      @details Recalculated when gain, ATIME or WTIME are written, so no bus read is needed
+     */
+    inline const tcs3472x::DerivedConstants& derived() const
+    {
+        return _derived;
+    }
+    //! @brief Gets the gain factors used for CPL and Lux
+    inline const tcs3472x::GainTable& gainTable() const
+    {
+        return _derived.gains;
+    }
+    /*!
+      @brief Set the gain factors used for CPL and Lux
+      @param gains Gain factors (positive and increasing)
+      @return True if successful
+      @details Derived constants are recalculated, no bus access. Store the result of calibrateGainTable()
+      (e.g. in NVS) and set it on startup, so that readings are continuous across gain switches
+     */
+    bool setGainTable(const tcs3472x::GainTable& gains);
+    /*!
+      @brief Measure the gain factors against a stable source
+      @param[out] gains Measured gain factors (x1 is 1.0)
+      @param atime ATIME raw value
+      @param repeats Number of x1-x60-x1 sweeps (1 - 4)
+      @return True if successful
+      @details Adjacent gains are measured alternately in a palindromic single shot sequence
+      and the ratios are averaged (See also calculateGainTable()).
+      The result is not applied, call setGainTable() to use it
+      @note All the gains share the ATIME, so the clear count at x1 must be at least 100 and x60 must not
+      saturate. With the default 0xC0 (153.6ms, saturation 65535) the usable range is about 100 - 1000 counts
+      at x1. Use a longer ATIME for a dimmer source and a shorter one for a brighter source
+      (the saturation of ATIME below 0xC0 is lower, see calculateSaturation())
+      @warning During periodic detection runs, an error is returned
+      @warning Gain and ATIME are overwritten
+     */
+    bool calibrateGainTable(tcs3472x::GainTable& gains, const uint8_t atime = 0xC0 /* 153.6ms */,
+                            const uint8_t repeats = 2);
+    ///@}
+
+    ///@name Resilience
+    ///@{
+    //! @brief Gets the bus error and recovery counters
+    inline const statistics_t& statistics() const
+    {
+        return _stats;
+    }
+    //! @brief Reset the counters
+    inline void resetStatistics()
+    {
+        _stats = statistics_t{};
+    }
+    /*!
+      @brief Detect the device reset and restore the configuration
+      @return True if the device configuration matches (or has been restored)
+      @details Compares ENABLE/ATIME with the shadow held by the driver.
+      If the device has been reset (e.g. brown-out), only registers that differ from the power-on defaults
+      are written, with contiguous registers in a burst.
+      Called from update() after bus errors, or when no data arrives for too long
+     */
+    bool synchronize();
+    ///@}
+
     ///@name Measurement data by periodic
     ///@{
     //! @brief Oldest measured Red
@@ -440,6 +794,27 @@ public:
     bool measureSingleshot(tcs3472x::Data& d, const tcs3472x::Gain gc, const float atime);
     //! @brief Measurement single shot using current settings
     bool measureSingleshot(tcs3472x::Data& d);
+    /*!
+      @brief Measurement single shot sequence (e.g. exposure bracket)
+      @param[out] out Measured data (num elements). Each has the gain/ATIME used
+      @param exposures Settings for each shot
+      @param num Number of shots
+      @return True if all shots are successful
+      @details PON is kept asserted throughout the sequence. When a shot completes, the settings for the next
+      shot are written and its integration is started before the result of the completed shot is read out,
+      so the total time approaches the sum of the integration times.
+      Only changed registers are written
+      @warning During periodic detection runs, an error is returned
+      @warning Each setting is overwritten (The last exposure remains)
+    */
+    bool measureSingleshotSequence(tcs3472x::Data* out, const tcs3472x::Exposure* exposures, const size_t num);
+    //! @brief Measurement single shot sequence for std::array
+    template <size_t N>
+    inline bool measureSingleshotSequence(std::array<tcs3472x::Data, N>& out,
+                                          const std::array<tcs3472x::Exposure, N>& exposures)
+    {
+        return measureSingleshotSequence(out.data(), exposures.data(), N);
+    }
     ///@}
 
     ///@name Interrupt
@@ -482,6 +857,163 @@ public:
      */
     bool readStatus(uint8_t& status);
 
+    ///@name Output streams
+    ///@{
+    /*!
+      @brief Register the output stream
+      @param decimation Number of measurements per output (1 for full rate)
+      @param agg Aggregation function
+      @return Stream index, -1 if no room or invalid
+      @details Streams are maintained incrementally by update() from the same acquisition,
+      e.g. full rate raw, 1 Hz mean and 1 minute max, each with fixed memory
+     */
+    int8_t addStream(const uint16_t decimation, const tcs3472x::Aggregation agg);
+    //! @brief Remove all the streams
+    void clearStreams();
+    //! @brief Was the stream output produced in the last update()?
+    inline bool streamUpdated(const uint8_t idx) const
+    {
+        return idx < MAX_STREAMS && (_stream_updated & (1U << idx));
+    }
+    //! @brief Gets the latest output of the stream
+    inline const tcs3472x::Data& streamData(const uint8_t idx) const
+    {
+        return _streams[idx < MAX_STREAMS ? idx : 0].output();
+    }
+    //! @brief Number of outputs of the stream so far (to detect new output without streamUpdated())
+    inline uint32_t streamCount(const uint8_t idx) const
+    {
+        return idx < MAX_STREAMS ? _streams[idx].count() : 0;
+    }
+    //! @brief Maximum number of the streams
+    static constexpr uint8_t MAX_STREAMS{4};
+    ///@}
+
+    ///@name Drift monitoring
+    ///@{
+    /*!
+      @brief Attach the drift monitor
+      @param monitor Monitor fed with every measurement by update(), nullptr to detach
+      @note The monitor is not owned, and must outlive the attachment (See also unit_color_spc.hpp)
+     */
+    inline void setDriftMonitor(tcs3472x::spc::Monitor* monitor)
+    {
+        _drift = monitor;
+    }
+    //! @brief Gets the attached drift monitor
+    inline tcs3472x::spc::Monitor* driftMonitor() const
+    {
+        return _drift;
+    }
+    ///@}
+
+    ///@name Deep sleep
+    ///@{
+    /*!
+      @brief Prepare for the deep sleep of the MCU woken by the INT pin
+      @param[out] state State to be preserved (place it in the memory retained across the sleep)
+      @param low Low threshold of the clear channel
+      @param high High threshold of the clear channel
+      @param pers Persistence
+      @return True if successful
+      @details Programs the interrupt window and the persistence, enables the interrupt and clears the pending one.
+      The sensor keeps measuring, and asserts INT (active low) when the clear channel stays outside [low, high].
+      Configure the wake source and enter the sleep after this
+      (e.g. esp_sleep_enable_ext0_wakeup(pin, 0) and esp_deep_sleep_start())
+      @warning Periodic measurement must be running
+     */
+    bool prepareSleep(tcs3472x::RetainedState& state, const uint16_t low, const uint16_t high,
+                      const tcs3472x::Persistence pers);
+    /*!
+      @brief Resume with the preserved state on the next begin()
+      @param state Preserved state
+      @return True if the state is valid and will be used
+      @details begin() adopts the state without reading the ID and the settings, and without reconfiguring
+      the sensor. The first update() reads STATUS and the channels in a single burst.
+      If the sensor was reset during the sleep, it is detected and restored by update() as usual
+     */
+    bool resumeFrom(const tcs3472x::RetainedState& state);
+    //! @brief Resumed from the preserved state by the last begin()?
+    inline bool resumed() const
+    {
+        return _resumed;
+    }
+    ///@}
+
+    ///@name External trigger
+    ///@{
+    /*!
+      @brief Start the external trigger mode
+      @param gc Gain
+      @param atime ATIME raw value
+      @param use_interrupt Completion is notified by notifyComplete() from the INT pin if true,
+      otherwise detected by the elapsed time
+      @return True if successful
+      @details The sensor is kept powered (PON) and armed with the settings written in advance.
+      On a trigger, update() starts the integration with a single ENABLE write,
+      and reads STATUS and all channels in a single burst on completion.
+      Results are queued with the timestamps (See also popTriggered())
+      @warning Periodic measurement and single shot are not available during the mode
+      @warning Call update() frequently, the dispatch delay is included in the latency
+     */
+    bool startTriggerMode(const tcs3472x::Gain gc, const uint8_t atime, const bool use_interrupt = false);
+    /*!
+      @brief Stop the external trigger mode
+      @param power_off To power off if true
+      @return True if successful
+      @note The persistence and the interrupt enable are restored to those before startTriggerMode()
+     */
+    bool stopTriggerMode(const bool power_off = true);
+    //! @brief In the external trigger mode?
+    inline bool inTriggerMode() const
+    {
+        return _trigger_mode;
+    }
+    /*!
+      @brief Notify the trigger (ISR safe)
+      @param at_us Time of the trigger (e.g. micros() in the GPIO ISR)
+      @note Ignored and counted as dropped while the previous trigger is being measured
+     */
+    inline void notifyTrigger(const uint32_t at_us)
+    {
+        if (_trigger_pending) {
+            _trigger_dropped = _trigger_dropped + 1;
+            return;
+        }
+        _trigger_at      = at_us;
+        _trigger_pending = true;
+    }
+    //! @brief Notify the completion from the INT pin (ISR safe)
+    inline void notifyComplete()
+    {
+        _trigger_completed = true;
+    }
+    //! @brief Number of queued results
+    inline size_t availableTriggered() const
+    {
+        return _triggered.size();
+    }
+    /*!
+      @brief Pop the oldest result
+      @param[out] r Result
+      @return True if popped
+     */
+    bool popTriggered(tcs3472x::TriggerResult& r);
+    //! @brief Gets the trigger statistics
+    trigger_statistics_t triggerStatistics() const;
+    //! @brief Reset the trigger statistics
+    void resetTriggerStatistics();
+    /*!
+      @brief Latency bound of the current settings (us)
+      @details RGBC init (2.4ms) + ATIME + fixed bus time (TRIGGER_BUS_US)
+     */
+    uint32_t triggerLatencyBound() const;
+    //! @brief Bus time allowance for the latency bound (ENABLE write and the result burst)
+    static constexpr uint32_t TRIGGER_BUS_US{2000};
+    //! @brief Capacity of the result queue
+    static constexpr size_t TRIGGER_QUEUE_SIZE{8};
+    ///@}
+
 protected:
     inline virtual bool is_valid_id(const uint8_t id)
     {
@@ -504,11 +1036,60 @@ protected:
 
     bool write_atime(const uint8_t raw);
 
+    bool retry_transaction(const uint8_t attempt);
+    inline void count_transaction(const uint32_t bytes)
+    {
+        ++_stats.transactions;
+        _stats.bytes += bytes;
+    }
+    bool restore_configuration(const bool reset);
+    void on_update_failure(const types::elapsed_time_t at);
+
+    uint8_t shadow_atime() const;
+    tcs3472x::Gain shadow_gain() const;
+    void update_shadow(const uint8_t reg, const uint8_t* buf, const uint32_t len);
+
+    bool apply_exposure(const tcs3472x::Exposure& exp);
+    bool wait_ready(const types::elapsed_time_t start_at, const uint32_t wait_ms);
+    bool wait_measurement(tcs3472x::Data& d, const uint32_t wait_ms);
+    bool recover_saturation(tcs3472x::Data& d, const uint8_t enable);
+    void fill_settings(tcs3472x::Data& d) const;
+    void update_trigger();
+    void finish_trigger(const bool ok);
+    void feed_streams(const tcs3472x::Data& d);
+    bool resume();
+    bool read_status_and_measurement(tcs3472x::Data& d);
+
     M5_UNIT_COMPONENT_PERIODIC_MEASUREMENT_ADAPTER_HPP_BUILDER(UnitTCS3472x, tcs3472x::Data);
 
 private:
     std::unique_ptr<m5::container::CircularBuffer<tcs3472x::Data>> _data{};
     config_t _cfg{};
+    statistics_t _stats{};
+    // Shadow of the writable registers 0x00 - 0x0F (Synchronized on begin, updated on write)
+    std::array<uint8_t, 16> _shadow{{0x00, 0xFF, 0x00, 0xFF}};
+    tcs3472x::DerivedConstants _derived{};
+    uint8_t _failures{};
+    types::elapsed_time_t _backoff_at{}, _checked_at{};
+
+    // External trigger
+    bool _trigger_mode{}, _trigger_running{}, _trigger_interrupt{}, _trigger_aien{};
+    uint8_t _trigger_pers{};  // PERS before the mode
+    volatile bool _trigger_pending{}, _trigger_completed{};
+    volatile uint32_t _trigger_at{}, _trigger_dropped{};
+    uint32_t _trigger_start{}, _trigger_deadline{};
+    trigger_statistics_t _trigger_stats{};
+    m5::container::FixedCircularBuffer<tcs3472x::TriggerResult, TRIGGER_QUEUE_SIZE> _triggered{};
+
+    // Output streams
+    std::array<tcs3472x::Decimator, MAX_STREAMS> _streams{};
+    uint8_t _stream_updated{};  // Bit per stream
+
+    tcs3472x::spc::Monitor* _drift{};
+
+    // Deep sleep
+    tcs3472x::RetainedState _retained{};
+    bool _resume_pending{}, _resumed{}, _burst_next{};
 };
 
 /*!
@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_TCS3472x_register.hpp
+  @brief Compile-time register map for TCS3472x
+  @details Fields are declared with their position and width, which are validated at compile time.
+  Updates of multiple fields of the same register are composed into one masked update.
+  If all writable bits are determined, the update folds into a constant and needs no current value.
+*/
+#ifndef M5_UNIT_COLOR_UNIT_TCS3472X_REGISTER_HPP
+#define M5_UNIT_COLOR_UNIT_TCS3472X_REGISTER_HPP
+
+#include "unit_TCS3472x.hpp"
+#include <cstdint>
+#include <type_traits>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+///@cond
+namespace command {
+
+/*!
+  @struct Register
+  @brief Register definition
+  @tparam Address Register address
+  @tparam Writable Writable bits (0 if read only, other bits are reserved and written as 0)
+  @tparam Reset Power-on value
+ */
+template <uint8_t Address, uint8_t Writable, uint8_t Reset = 0x00>
+struct Register {
+    static constexpr uint8_t address{Address};
+    static constexpr uint8_t writable{Writable};
+    static constexpr uint8_t reset{Reset};
+};
+
+/*!
+  @struct Update
+  @brief Masked update of the register
+  @tparam Reg Register
+ */
+template <class Reg>
+struct Update {
+    uint8_t mask;  //!< Bits to be updated
+    uint8_t bits;  //!< New value of the bits
+
+    //! @brief Apply to the current value (reserved bits are cleared)
+    constexpr uint8_t apply(const uint8_t v) const
+    {
+        return static_cast<uint8_t>((v & ~mask & Reg::writable) | bits);
+    }
+    //! @brief All writable bits are determined? (The result does not depend on the current value)
+    constexpr bool complete() const
+    {
+        return (mask & Reg::writable) == Reg::writable;
+    }
+    //! @brief Compose with the update of the same register (The right side wins on overlap)
+    constexpr Update operator|(const Update& o) const
+    {
+        return Update{static_cast<uint8_t>(mask | o.mask), static_cast<uint8_t>((bits & ~o.mask) | o.bits)};
+    }
+};
+
+/*!
+  @struct Field
+  @brief Bit field in the register
+  @tparam Reg Register
+  @tparam Shift LSB position
+  @tparam Width Number of bits
+ */
+template <class Reg, uint8_t Shift, uint8_t Width = 1>
+struct Field {
+    static_assert(Width >= 1 && Shift + Width <= 8, "Field exceeds the register");
+    using register_type = Reg;
+    static constexpr uint8_t shift{Shift};
+    static constexpr uint8_t max{static_cast<uint8_t>((1U << Width) - 1)};
+    static constexpr uint8_t mask{static_cast<uint8_t>(max << Shift)};
+    static_assert(!Reg::writable || !(mask & ~Reg::writable), "Field overlaps reserved bits");
+
+    //! @brief Gets the field value
+    static constexpr uint8_t get(const uint8_t v)
+    {
+        return static_cast<uint8_t>((v & mask) >> Shift);
+    }
+    //! @brief Update by runtime value (truncated to the width)
+    static constexpr Update<Reg> set(const uint8_t v)
+    {
+        return Update<Reg>{mask, static_cast<uint8_t>((v << Shift) & mask)};
+    }
+    //! @brief Update by compile-time value (checked against the width)
+    template <uint8_t V>
+    static constexpr Update<Reg> value()
+    {
+        static_assert(V <= max, "Value exceeds the field width");
+        return Update<Reg>{mask, static_cast<uint8_t>(V << Shift)};
+    }
+};
+
+/*!
+  @struct FieldValue
+  @brief Compile-time value of the field
+  @tparam F Field
+  @tparam V Value
+ */
+template <class F, uint8_t V>
+struct FieldValue {
+    static_assert(V <= F::max, "Value exceeds the field width");
+    using field         = F;
+    using register_type = typename F::register_type;
+    static constexpr uint8_t mask{F::mask};
+    static constexpr uint8_t bits{static_cast<uint8_t>(V << F::shift)};
+};
+
+/*!
+  @struct Compose
+  @brief Compile-time multi-field update
+  @tparam Fields FieldValue of each field
+  @details Fields must belong to the same register and must not overlap
+ */
+template <class... Fields>
+struct Compose;
+
+template <class FV>
+struct Compose<FV> {
+    using register_type = typename FV::register_type;
+    static constexpr uint8_t mask{FV::mask};
+    static constexpr uint8_t bits{FV::bits};
+    static constexpr Update<register_type> update()
+    {
+        return Update<register_type>{mask, bits};
+    }
+};
+
+template <class FV, class... Rest>
+struct Compose<FV, Rest...> {
+    using register_type = typename FV::register_type;
+    static_assert(std::is_same<register_type, typename Compose<Rest...>::register_type>::value,
+                  "Fields of different registers");
+    static_assert(!(FV::mask & Compose<Rest...>::mask), "Fields overlap");
+    static constexpr uint8_t mask{static_cast<uint8_t>(FV::mask | Compose<Rest...>::mask)};
+    static constexpr uint8_t bits{static_cast<uint8_t>(FV::bits | Compose<Rest...>::bits)};
+    static constexpr Update<register_type> update()
+    {
+        return Update<register_type>{mask, bits};
+    }
+};
+
+// Register map
+struct ENABLE : Register<ENABLE_REG, 0x1B> {
+    using PON  = Field<ENABLE, 0>;  // Power ON
+    using AEN  = Field<ENABLE, 1>;  // RGBC enable
+    using WEN  = Field<ENABLE, 3>;  // Wait enable
+    using AIEN = Field<ENABLE, 4>;  // RGBC interrupt enable
+};
+struct ATIME : Register<ATIME_REG, 0xFF, 0xFF> {
+    using VALUE = Field<ATIME, 0, 8>;
+};
+struct WTIME : Register<WTIME_REG, 0xFF, 0xFF> {
+    using VALUE = Field<WTIME, 0, 8>;
+};
+struct PERS : Register<PERS_REG, 0x0F> {
+    using APERS = Field<PERS, 0, 4>;  // Interrupt persistence
+};
+struct CONFIG : Register<CONFIG_REG, 0x02> {
+    using WLONG = Field<CONFIG, 1>;  // Wait long
+};
+struct CONTROL : Register<CONTROL_REG, 0x03> {
+    using AGAIN = Field<CONTROL, 0, 2>;  // RGBC gain
+};
+struct STATUS : Register<STATUS_REG, 0x00> {
+    using AVALID = Field<STATUS, 0>;  // RGBC valid
+    using AINT   = Field<STATUS, 4>;  // RGBC interrupt
+};
+
+}  // namespace command
+///@endcond
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
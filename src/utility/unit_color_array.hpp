@@ -0,0 +1,358 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_array.hpp
+  @brief Batch processing of sensor arrays in structure of arrays
+  @details The latest samples of multiple units are gathered into per-channel arrays (C[], R[], G[], B[]),
+  and IR compensation, per-unit color correction matrix, Lux and classification are done as
+  simple loops across all the sensors without branches per unit, which the compiler can vectorize.
+  @code
+  soa::SensorArray<16> sensors{};
+  for (auto&& u : units) { sensors.add(u); }
+  sensors.setPalette(palette, 4);
+  ...
+  Units.update();
+  sensors.collect();
+  sensors.process();
+  for (size_t i = 0; i < sensors.size(); ++i) { sensors.lux()[i], sensors.classes()[i], ... }
+  M5_LOGI("%u us/frame", sensors.frameUs());
+  @endcode
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_ARRAY_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_ARRAY_HPP
+
+#include "unit_color_utility.hpp"
+#include <M5Utility.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace soa
+  @brief Structure of arrays processing of sensor arrays
+ */
+namespace soa {
+
+constexpr uint8_t UNKNOWN{0xFF};  //!< Class of the unclassified (or no sample) sensor
+
+/*!
+  @struct Matrix
+  @brief Color correction matrix (row major), applied to R, G, B without IR component
+ */
+struct Matrix {
+    float m[9];
+};
+//! @brief Identity matrix
+constexpr Matrix IDENTITY{{1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f}};
+
+/*!
+  @struct Chromaticity
+  @brief Reference of the class, r + g + b = 1 of the corrected values
+ */
+struct Chromaticity {
+    float r, g, b;
+};
+
+/*!
+  @class SensorArray
+  @brief Sensor array
+  @tparam N Maximum number of the sensors (up to 32)
+ */
+template <size_t N>
+class SensorArray {
+    static_assert(N > 0 && N <= 32, "N must be 1 - 32");
+
+public:
+    SensorArray()
+    {
+        for (size_t i = 0; i < N; ++i) {
+            set_matrix(i, IDENTITY);
+        }
+    }
+
+    ///@name Settings
+    ///@{
+    /*!
+      @brief Add the unit
+      @param unit Unit (must outlive the array)
+      @param m Color correction matrix of the unit
+      @return True if successful, false if full
+      @note Takes the first index without the unit, which may be below size() if samples were set()
+     */
+    bool add(UnitTCS3472x& unit, const Matrix& m = IDENTITY)
+    {
+        for (size_t i = 0; i < N; ++i) {
+            if (!_units[i]) {
+                _units[i] = &unit;
+                set_matrix(i, m);
+                _size = std::max(_size, i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+    //! @brief Number of the sensors
+    inline size_t size() const
+    {
+        return _size;
+    }
+    /*!
+      @brief Set the color correction matrix of the sensor
+      @param idx Index of the sensor
+      @param m Matrix
+      @return True if successful
+     */
+    bool setMatrix(const size_t idx, const Matrix& m)
+    {
+        if (idx >= _size) {
+            return false;
+        }
+        set_matrix(idx, m);
+        return true;
+    }
+    /*!
+      @brief Set the references of the classification
+      @param palette References, the index is the class (must outlive the array)
+      @param num Number of references (up to UNKNOWN - 1)
+      @param tolerance Maximum distance of the chromaticity to a reference
+     */
+    void setPalette(const Chromaticity* palette, const size_t num, const float tolerance = 0.05f)
+    {
+        _palette     = palette;
+        _num_palette = palette ? std::min<size_t>(num, UNKNOWN) : 0;
+        _tolerance2  = tolerance * tolerance;
+    }
+    ///@}
+
+    ///@name Input
+    ///@{
+    /*!
+      @brief Gather the latest sample of each unit
+      @return Bits of the sensors updated in the last update() of the unit
+      @note Sensors without any sample are processed as zero and classified as UNKNOWN
+      @note Indexes without the unit keep the sample given by set()
+     */
+    uint32_t collect()
+    {
+        const uint32_t start = static_cast<uint32_t>(m5::utility::micros());
+        uint32_t updated{};
+        for (size_t i = 0; i < _size; ++i) {
+            if (!_units[i]) {
+                continue;
+            }
+            if (_units[i]->empty()) {
+                clear(i);
+                continue;
+            }
+            set(i, _units[i]->latest(), _units[i]->derived());
+            updated |= _units[i]->updated() ? (1U << i) : 0U;
+        }
+        _collect_us = static_cast<uint32_t>(m5::utility::micros()) - start;
+        return updated;
+    }
+    /*!
+      @brief Set the sample of the sensor directly
+      @param idx Index of the sensor (< N, extends size() if needed)
+      @param d Measurement data
+      @param k Derived constants of the unit
+     */
+    void set(const size_t idx, const Data& d, const DerivedConstants& k)
+    {
+        if (idx >= N) {
+            return;
+        }
+        _size       = std::max(_size, idx + 1);
+        _c[idx]     = d.C16();
+        _r[idx]     = d.R16();
+        _g[idx]     = d.G16();
+        _b[idx]     = d.B16();
+        _scale[idx] = inverseCPL(d, k);
+        const uint16_t sat = (d.atime == k.atime) ? k.saturation : calculateSaturation(d.atime);
+        _present |= 1U << idx;
+        _saturated = (d.C16() >= sat) ? (_saturated | (1U << idx)) : (_saturated & ~(1U << idx));
+    }
+    //! @brief Clear the sample of the sensor
+    void clear(const size_t idx)
+    {
+        if (idx >= N) {
+            return;
+        }
+        _c[idx] = _r[idx] = _g[idx] = _b[idx] = 0;
+        _scale[idx]                           = 0.0f;
+        _present &= ~(1U << idx);
+        _saturated &= ~(1U << idx);
+    }
+    ///@}
+
+    /*!
+      @brief Process all the sensors
+      @details Lux is the same as calculateLux(const Data&, const DerivedConstants&).
+      Color is the IR compensated R, G, B (clamped at 0) multiplied by the matrix of the sensor.
+      Class is the nearest reference of the chromaticity of the color within the tolerance
+     */
+    void process()
+    {
+        const uint32_t start = static_cast<uint32_t>(m5::utility::micros());
+        const size_t n       = _size;
+
+        // IR compensation and Lux
+        for (size_t i = 0; i < n; ++i) {
+            const float ir = (static_cast<float>(_r[i]) + _g[i] + _b[i] - _c[i]) * 0.5f;
+            const float r = _r[i] - ir, g = _g[i] - ir, b = _b[i] - ir;
+            const float lux = (R_Coef * r + G_Coef * g + B_Coef * b) * _scale[i];
+            _lux[i]         = lux > 0.0f ? lux : 0.0f;
+            _red[i]         = r > 0.0f ? r : 0.0f;
+            _green[i]       = g > 0.0f ? g : 0.0f;
+            _blue[i]        = b > 0.0f ? b : 0.0f;
+        }
+        // Color correction matrix
+        for (size_t i = 0; i < n; ++i) {
+            const float r = _red[i], g = _green[i], b = _blue[i];
+            _red[i]   = _m[0][i] * r + _m[1][i] * g + _m[2][i] * b;
+            _green[i] = _m[3][i] * r + _m[4][i] * g + _m[5][i] * b;
+            _blue[i]  = _m[6][i] * r + _m[7][i] * g + _m[8][i] * b;
+        }
+        // Classification (references outer, sensors inner)
+        std::array<float, N> cr, cg, cb, best;
+        for (size_t i = 0; i < n; ++i) {
+            const float sum = _red[i] + _green[i] + _blue[i];
+            const float inv = sum > 0.0f ? 1.0f / sum : 0.0f;
+            cr[i]           = _red[i] * inv;
+            cg[i]           = _green[i] * inv;
+            cb[i]           = _blue[i] * inv;
+            best[i]         = (sum > 0.0f) ? _tolerance2 : -1.0f;  // Negative never matches
+            _class[i]       = UNKNOWN;
+        }
+        for (size_t k = 0; k < _num_palette; ++k) {
+            const Chromaticity& ref = _palette[k];
+            for (size_t i = 0; i < n; ++i) {
+                const float dr = cr[i] - ref.r, dg = cg[i] - ref.g, db = cb[i] - ref.b;
+                const float d2 = dr * dr + dg * dg + db * db;
+                const bool hit = d2 <= best[i];
+                best[i]        = hit ? d2 : best[i];
+                _class[i]      = hit ? static_cast<uint8_t>(k) : _class[i];
+            }
+        }
+        _frame_us = static_cast<uint32_t>(m5::utility::micros()) - start;
+        ++_frames;
+    }
+
+    ///@name Output
+    ///@{
+    //! @brief Lux of each sensor
+    inline const float* lux() const
+    {
+        return _lux.data();
+    }
+    //! @brief Corrected red of each sensor
+    inline const float* red() const
+    {
+        return _red.data();
+    }
+    //! @brief Corrected green of each sensor
+    inline const float* green() const
+    {
+        return _green.data();
+    }
+    //! @brief Corrected blue of each sensor
+    inline const float* blue() const
+    {
+        return _blue.data();
+    }
+    //! @brief Class of each sensor (UNKNOWN if none)
+    inline const uint8_t* classes() const
+    {
+        return _class.data();
+    }
+    ///@}
+
+    ///@name Raw input
+    ///@{
+    inline const uint16_t* rawC() const
+    {
+        return _c.data();
+    }
+    inline const uint16_t* rawR() const
+    {
+        return _r.data();
+    }
+    inline const uint16_t* rawG() const
+    {
+        return _g.data();
+    }
+    inline const uint16_t* rawB() const
+    {
+        return _b.data();
+    }
+    //! @brief Bits of the sensors having the sample
+    inline uint32_t present() const
+    {
+        return _present;
+    }
+    //! @brief Bits of the sensors whose clear channel is saturated
+    inline uint32_t saturated() const
+    {
+        return _saturated;
+    }
+    ///@}
+
+    ///@name Timing
+    ///@{
+    //! @brief Time of the last process() (us)
+    inline uint32_t frameUs() const
+    {
+        return _frame_us;
+    }
+    //! @brief Time of the last collect() (us)
+    inline uint32_t collectUs() const
+    {
+        return _collect_us;
+    }
+    //! @brief Number of process() calls
+    inline uint32_t frames() const
+    {
+        return _frames;
+    }
+    ///@}
+
+protected:
+    void set_matrix(const size_t idx, const Matrix& m)
+    {
+        for (size_t e = 0; e < 9; ++e) {
+            _m[e][idx] = m.m[e];
+        }
+    }
+
+private:
+    std::array<UnitTCS3472x*, N> _units{};
+    size_t _size{};
+    // Input
+    std::array<uint16_t, N> _c{}, _r{}, _g{}, _b{};
+    std::array<float, N> _scale{};  // 1 / CPL
+    uint32_t _present{}, _saturated{};
+    // Matrix elements, each across the sensors
+    std::array<std::array<float, N>, 9> _m{};
+    // Classification
+    const Chromaticity* _palette{};
+    size_t _num_palette{};
+    float _tolerance2{0.0025f};
+    // Output
+    std::array<float, N> _lux{}, _red{}, _green{}, _blue{};
+    std::array<uint8_t, N> _class{};
+    // Timing
+    uint32_t _frame_us{}, _collect_us{}, _frames{};
+};
+
+}  // namespace soa
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
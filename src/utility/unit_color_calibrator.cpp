@@ -0,0 +1,162 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_calibrator.cpp
+  @brief Online black/white calibration
+*/
+#include "unit_color_calibrator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+inline uint16_t to_raw(const float v)
+{
+    return static_cast<uint16_t>(std::fmin(std::fmax(std::round(v), 0.0f), 65535.0f));
+}
+
+// Raw counts are proportional to the integration steps and the gain
+inline float count_scale(const uint8_t atime, const m5::unit::tcs3472x::Gain gc,
+                         const m5::unit::tcs3472x::GainTable& gains)
+{
+    return (256 - atime) * gains[m5::stl::to_underlying(gc) & 0x03];
+}
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace calibrator {
+
+bool Online::setGainTable(const GainTable& gains)
+{
+    for (uint_fast8_t i = 0; i < gains.size(); ++i) {
+        if (!(gains[i] > 0.0f) || (i && gains[i] <= gains[i - 1])) {
+            M5_LIB_LOGE("Invalid gain table");
+            return false;
+        }
+    }
+    _gains = gains;
+    return true;
+}
+
+bool Online::push(const Data& d, const Reference ref)
+{
+    // Masked channels read as zero, the values without IR would corrupt the references
+    if (d.channels != CHANNEL_ALL || d.C16() >= calculateSaturation(d.atime)) {
+        return false;
+    }
+    // Raw ranges of different settings can not be mixed
+    bool rescaled{};
+    if (!_settled || d.atime != _atime || d.gain != _gain) {
+        if (_settled) {
+            // Keep the published range in the raw scale of the new settings
+            rescaled = rescale(count_scale(d.atime, d.gain, _gains) / count_scale(_atime, _gain, _gains));
+        }
+        _atime   = d.atime;
+        _gain    = d.gain;
+        _settled = true;
+        abortReference();
+        resetExtremes();
+    }
+
+    // Same values as Calibration uses
+    const float v[3] = {static_cast<float>(d.RnoIR16()), static_cast<float>(d.GnoIR16()),
+                        static_cast<float>(d.BnoIR16())};
+    if (ref != Reference::None) {
+        return push_reference(v, ref) || rescaled;
+    }
+    return (_cfg.track_extremes && track(v)) || rescaled;
+}
+
+void Online::abortReference()
+{
+    _ref       = Reference::None;
+    _ref_count = 0;
+    std::fill(std::begin(_ref_acc), std::end(_ref_acc), 0.0f);
+}
+
+void Online::resetExtremes()
+{
+    _tracked = 0;
+}
+
+bool Online::push_reference(const float* v, const Reference ref)
+{
+    if (ref != _ref) {
+        abortReference();
+        _ref = ref;
+    }
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+        _ref_acc[i] += v[i];
+    }
+    if (++_ref_count < std::max<uint8_t>(_cfg.reference_samples, 1)) {
+        return false;
+    }
+
+    // Blend the reading into the published one
+    const float black[3] = {static_cast<float>(_active.blackR), static_cast<float>(_active.blackG),
+                            static_cast<float>(_active.blackB)};
+    const float white[3] = {static_cast<float>(_active.whiteR), static_cast<float>(_active.whiteG),
+                            static_cast<float>(_active.whiteB)};
+    float updated[3]{};
+    const float* cur = (ref == Reference::White) ? white : black;
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+        updated[i] = cur[i] + _cfg.smoothing * (_ref_acc[i] / _ref_count - cur[i]);
+    }
+    abortReference();
+    return (ref == Reference::White) ? publish(black, updated) : publish(updated, white);
+}
+
+bool Online::track(const float* v)
+{
+    if (!_tracked) {
+        std::copy(v, v + 3, _low);
+        std::copy(v, v + 3, _high);
+    }
+    // Stochastic quantile tracking: converges where P(x > q) = 1 - quantile
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+        const float step = _cfg.quantile_rate * std::fmax(_high[i], 16.0f);
+        _low[i] += (v[i] > _low[i]) ? step * _cfg.low_quantile : -step * (1.0f - _cfg.low_quantile);
+        _high[i] += (v[i] > _high[i]) ? step * _cfg.high_quantile : -step * (1.0f - _cfg.high_quantile);
+    }
+    ++_tracked;
+    const uint16_t interval = std::max<uint16_t>(_cfg.extremes_interval, 1);
+    return (_tracked % interval) == 0 ? publish(_low, _high) : false;
+}
+
+bool Online::rescale(const float k)
+{
+    // Not subject to min_span, it is the same range in another scale
+    const Calibration& a = _active;
+    const Calibration c{to_raw(a.blackR * k), to_raw(a.whiteR * k), to_raw(a.blackG * k),
+                        to_raw(a.whiteG * k), to_raw(a.blackB * k), to_raw(a.whiteB * k)};
+    _active = c;
+    ++_generation;
+    return true;
+}
+
+bool Online::publish(const float* black, const float* white)
+{
+    uint16_t raw[6]{};
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+        raw[i * 2]     = to_raw(black[i]);
+        raw[i * 2 + 1] = to_raw(white[i]);
+        if (raw[i * 2 + 1] < raw[i * 2] + std::max<uint32_t>(_cfg.min_span, 1)) {
+            ++_rejected;
+            return false;
+        }
+    }
+    // Built aside and replaced as a whole
+    const Calibration c{raw[0], raw[1], raw[2], raw[3], raw[4], raw[5]};
+    _active = c;
+    ++_generation;
+    return true;
+}
+
+}  // namespace calibrator
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
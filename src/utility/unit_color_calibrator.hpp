@@ -0,0 +1,164 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_calibrator.hpp
+  @brief Online black/white calibration
+  @details Keeps Calibration up to date while measuring, from either
+  - Reference events: samples known to be of the black/white reference (e.g. a white tile passing at known times)
+  - Robust running extremes: low/high quantiles of all the samples, tracked in O(1) per sample
+  A new calibration is built aside and published as a whole between samples, so consumers
+  (Calibration::R8/G8/B8, pipeline::Calibrate) never see a half-updated range.
+  @code
+  calibrator::Online online{Calibration{0x75, 0xAFE, 0xA1, 0x15A6, 0xAF, 0x194D}};
+  pipeline::Pipeline<pipeline::NoIR, pipeline::Calibrate, pipeline::Linear, pipeline::RGB565>
+      toCalibrated{pipeline::Calibrate{online.calibration()}};  // Follows the publications
+  ...
+  online.push(unit.latest(), tile_detected ? calibrator::Reference::White : calibrator::Reference::None);
+  @endcode
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_CALIBRATOR_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_CALIBRATOR_HPP
+
+#include "unit_color_utility.hpp"
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace calibrator
+  @brief Online black/white calibration
+ */
+namespace calibrator {
+
+/*!
+  @enum Reference
+  @brief Kind of the sample
+ */
+enum class Reference : uint8_t {
+    None,   //!< Production sample
+    Black,  //!< Black reference
+    White,  //!< White reference
+};
+
+/*!
+  @struct Config
+  @brief Calibrator settings
+ */
+struct Config {
+    //! Reference samples averaged into a reference reading
+    uint8_t reference_samples{8};
+    //! Weight of the new reference reading (1: replace)
+    float smoothing{0.5f};
+    //! Track the running extremes of the production samples
+    bool track_extremes{false};
+    //! Quantile tracked as black
+    float low_quantile{0.02f};
+    //! Quantile tracked as white
+    float high_quantile{0.98f};
+    //! Step of the quantile trackers relative to the value
+    float quantile_rate{0.02f};
+    //! Production samples between the publications of the extremes (and before the first)
+    uint16_t extremes_interval{64};
+    //! Minimum white - black of each channel to publish
+    uint16_t min_span{64};
+};
+
+/*!
+  @class Online
+  @brief Online black/white calibrator
+  @note Raw ranges depend on gain/ATIME. If they change, the published range is rescaled by the ratio of the counts
+  (ATIME steps x gain factor of the gain table) and published, and the accumulation restarts.
+  The initial calibration is taken as of the settings of the first sample
+ */
+class Online {
+public:
+    /*!
+      @param initial Calibration until the first publication
+      @param cfg Settings
+      @param gains Gain factors of the unit (See also UnitTCS3472x::gainTable())
+     */
+    explicit Online(const Calibration& initial, const Config& cfg = Config{},
+                    const GainTable& gains = NOMINAL_GAINS)
+        : _cfg{cfg}, _active{initial}, _gains(gains)
+    {
+    }
+
+    /*!
+      @brief Push the sample
+      @param d Measurement data
+      @param ref Kind of the sample
+      @return True if a new calibration is published
+      @note Saturated and partial (Data::channels is not CHANNEL_ALL) samples are ignored
+     */
+    bool push(const Data& d, const Reference ref = Reference::None);
+    //! @brief Discard the reference reading in progress
+    void abortReference();
+    //! @brief Restart the extreme tracking
+    void resetExtremes();
+
+    //! @brief Gets the published calibration
+    inline const Calibration& calibration() const
+    {
+        return _active;
+    }
+    //! @brief Number of publications
+    inline uint32_t generation() const
+    {
+        return _generation;
+    }
+    //! @brief Number of candidates rejected by min_span
+    inline uint32_t rejected() const
+    {
+        return _rejected;
+    }
+    //! @brief Gets the settings
+    inline const Config& config() const
+    {
+        return _cfg;
+    }
+    //! @brief Gets the gain factors
+    inline const GainTable& gainTable() const
+    {
+        return _gains;
+    }
+    /*!
+      @brief Set the gain factors used to rescale on a gain change
+      @param gains Gain factors (positive and increasing, e.g. UnitTCS3472x::gainTable() after setGainTable())
+      @return True if successful
+     */
+    bool setGainTable(const GainTable& gains);
+
+protected:
+    bool publish(const float* black, const float* white);
+    bool rescale(const float k);
+    bool push_reference(const float* v, const Reference ref);
+    bool track(const float* v);
+
+private:
+    Config _cfg{};
+    Calibration _active;
+    GainTable _gains{};
+    uint32_t _generation{}, _rejected{};
+    // Settings of the accumulation
+    uint8_t _atime{};
+    Gain _gain{};
+    bool _settled{};
+    // Reference reading in progress
+    Reference _ref{Reference::None};
+    uint8_t _ref_count{};
+    float _ref_acc[3]{};
+    // Quantile trackers (R, G, B)
+    float _low[3]{}, _high[3]{};
+    uint32_t _tracked{};
+};
+
+}  // namespace calibrator
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_crosscore.cpp
+  @brief Cross-core pipelined processing of the measurements
+*/
+#include "unit_color_crosscore.hpp"
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace crosscore {
+
+bool Task::start_task(void* step, size_t (*fn)(void*), const char* name, const int core, const uint32_t priority,
+                      const uint32_t stack_size)
+{
+    if (_handle) {
+        M5_LIB_LOGE("Already running");
+        return false;
+    }
+    _step    = step;
+    _process = fn;
+    _stop    = false;
+    _stopped = false;
+#if CONFIG_FREERTOS_UNICORE
+    const BaseType_t affinity = tskNO_AFFINITY;
+    (void)core;
+#else
+    const BaseType_t affinity = (core >= 0 && core < portNUM_PROCESSORS) ? core : tskNO_AFFINITY;
+#endif
+    TaskHandle_t handle{};
+    if (xTaskCreatePinnedToCore(&Task::entry, name, stack_size, this, priority, &handle, affinity) != pdPASS) {
+        M5_LIB_LOGE("Failed to create the task %s", name ? name : "");
+        return false;
+    }
+    _handle = handle;
+    return true;
+}
+
+void Task::stop()
+{
+    if (!_handle) {
+        return;
+    }
+    _stop = true;
+    while (!_stopped) {
+        vTaskDelay(1);
+    }
+    _handle = nullptr;
+}
+
+void Task::entry(void* arg)
+{
+    auto self = static_cast<Task*>(arg);
+    while (!self->_stop) {
+        if (!self->_process(self->_step)) {
+            vTaskDelay(1);  // Nothing to do, yield to the other tasks
+        }
+    }
+    self->_stopped = true;
+    vTaskDelete(nullptr);
+}
+
+}  // namespace crosscore
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,356 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_crosscore.hpp
+  @brief Cross-core pipelined processing of the measurements
+  @details Acquisition (update() and the bus) runs on one core, and the processing stages (conversion, filter,
+  classification, ...) on the other, connected by lock-free single-producer single-consumer rings.
+  Stages hand off the items in batches and apply back pressure to each other, so only the acquisition drops
+  the samples if the processing can not keep up, and the processing cost never delays the sensor reads.
+  Each step has timing and backlog metrics.
+  @code
+  crosscore::Acquisition<32> acq{unit};
+  auto convert = [&calib](const Data& d) { return calib.R8(d); };
+  crosscore::Stage<Data, decltype(convert), 32> stage{acq.output(), convert};
+  crosscore::Task acqTask{}, procTask{};
+  acqTask.start(acq, "acq", 1);     // Same core as the bus
+  procTask.start(stage, "proc", 0);  // The other core
+  ...
+  uint8_t r{};
+  while (stage.output().pop(r)) { ... }
+  @endcode
+  @warning After the acquisition task is started, access the unit only from that task
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_CROSSCORE_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_CROSSCORE_HPP
+
+#include "../unit/unit_TCS3472x.hpp"
+#include <M5Utility.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace crosscore
+  @brief Cross-core pipelined processing
+ */
+namespace crosscore {
+
+/*!
+  @class Ring
+  @brief Lock-free single-producer single-consumer ring
+  @tparam T Copy-assignable type
+  @tparam N Capacity (power of 2)
+  @details A batch is published with a single release store, so the consumer sees all of it or none of it
+ */
+template <typename T, size_t N>
+class Ring {
+    static_assert(N && !(N & (N - 1)), "N must be power of 2");
+
+public:
+    using value_type = T;
+
+    ///@name Producer
+    ///@{
+    //! @brief Push the item, false if full
+    bool push(const T& v)
+    {
+        return push(&v, 1) == 1;
+    }
+    /*!
+      @brief Push the items
+      @param src Items
+      @param num Number of items
+      @return Number of pushed items (from the first)
+     */
+    size_t push(const T* src, const size_t num)
+    {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        const uint32_t tail = _tail.load(std::memory_order_acquire);
+        const size_t cnt    = std::min<size_t>(num, N - (head - tail));
+        for (size_t i = 0; i < cnt; ++i) {
+            _buf[(head + i) & (N - 1)] = src[i];
+        }
+        _head.store(head + cnt, std::memory_order_release);
+        return cnt;
+    }
+    //! @brief Number of the items that can be pushed
+    inline size_t space() const
+    {
+        return N - size();
+    }
+    ///@}
+
+    ///@name Consumer
+    ///@{
+    //! @brief Pop the oldest item, false if empty
+    bool pop(T& v)
+    {
+        return pop(&v, 1) == 1;
+    }
+    /*!
+      @brief Pop the items from the oldest
+      @param[out] out Buffer
+      @param num Buffer length
+      @return Number of popped items
+     */
+    size_t pop(T* out, const size_t num)
+    {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        const uint32_t head = _head.load(std::memory_order_acquire);
+        const size_t cnt    = std::min<size_t>(num, head - tail);
+        for (size_t i = 0; i < cnt; ++i) {
+            out[i] = _buf[(tail + i) & (N - 1)];
+        }
+        _tail.store(tail + cnt, std::memory_order_release);
+        return cnt;
+    }
+    ///@}
+
+    //! @brief Number of the held items
+    inline size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    inline bool empty() const
+    {
+        return size() == 0;
+    }
+    inline static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+private:
+    std::array<T, N> _buf{};
+    std::atomic<uint32_t> _head{}, _tail{};
+};
+
+/*!
+  @struct Metrics
+  @brief Timing and backlog of the step
+  @note Updated by the task of the step. Each member is consistent by itself,
+  but the members read from the other task may be of different batches
+ */
+struct Metrics {
+    uint32_t batches{};      //!< Number of the batches (or update() for the acquisition)
+    uint32_t items{};        //!< Number of the processed items
+    uint32_t last_us{};      //!< Time of the last batch
+    uint32_t max_us{};       //!< Maximum time of a batch
+    uint32_t total_us{};     //!< Total time (wraps)
+    uint32_t backlog{};      //!< Input items waiting at the start of the last batch
+    uint32_t max_backlog{};  //!< Maximum of backlog
+    uint32_t dropped{};      //!< Items lost because the output was full (acquisition only)
+
+    //! @brief Average time per item (us)
+    inline float averageUs() const
+    {
+        return items ? static_cast<float>(total_us) / items : 0.0f;
+    }
+    //! @brief Record the batch
+    void record(const uint32_t elapsed_us, const uint32_t num, const uint32_t waiting)
+    {
+        ++batches;
+        items += num;
+        last_us = elapsed_us;
+        max_us  = std::max(max_us, elapsed_us);
+        total_us += elapsed_us;
+        backlog     = waiting;
+        max_backlog = std::max(max_backlog, waiting);
+    }
+    inline void reset()
+    {
+        *this = Metrics{};
+    }
+};
+
+/*!
+  @class Acquisition
+  @brief Source step calling update() of the unit
+  @tparam N Capacity of the output ring (power of 2)
+ */
+template <size_t N = 32>
+class Acquisition {
+public:
+    using value_type = Data;
+
+    explicit Acquisition(UnitTCS3472x& unit) : _unit(unit)
+    {
+    }
+
+    /*!
+      @brief Update the unit and push the new measurement
+      @return Number of the items pushed (0 or 1)
+     */
+    size_t process()
+    {
+        const uint32_t start = static_cast<uint32_t>(m5::utility::micros());
+        _unit.update();
+        size_t cnt{};
+        if (_unit.updated()) {
+            if (_output.push(_unit.latest())) {
+                cnt = 1;
+            } else {
+                ++_metrics.dropped;
+            }
+        }
+        _metrics.record(static_cast<uint32_t>(m5::utility::micros()) - start, cnt, 0);
+        return cnt;
+    }
+
+    inline Ring<Data, N>& output()
+    {
+        return _output;
+    }
+    inline const Metrics& metrics() const
+    {
+        return _metrics;
+    }
+
+private:
+    UnitTCS3472x& _unit;
+    Ring<Data, N> _output{};
+    Metrics _metrics{};
+};
+
+/*!
+  @class Stage
+  @brief Processing step
+  @tparam In Type of the input
+  @tparam F Processing, value_type(const In&) (e.g. pipeline::Pipeline, lambda, function pointer)
+  @tparam N Capacity of the output ring (power of 2)
+  @tparam InN Capacity of the input ring
+ */
+template <typename In, typename F, size_t N = 32, size_t InN = N>
+class Stage {
+public:
+    using input_type = In;
+    using value_type = typename std::decay<decltype(std::declval<const F&>()(std::declval<const In&>()))>::type;
+
+    /*!
+      @param input Output ring of the previous step
+      @param f Processing
+      @param batch Maximum items per batch (1 - N)
+     */
+    Stage(Ring<In, InN>& input, const F& f, const size_t batch = 8)
+        : _input(input), _f(f), _batch{std::max<size_t>(1, std::min(batch, std::min(N, InN)))}
+    {
+    }
+
+    /*!
+      @brief Process a batch
+      @return Number of the processed items
+      @note Items are left in the input while the output is full (back pressure)
+     */
+    size_t process()
+    {
+        const size_t waiting = _input.size();
+        const size_t num     = std::min(_batch, std::min(waiting, _output.space()));
+        if (!num) {
+            return 0;
+        }
+        const uint32_t start = static_cast<uint32_t>(m5::utility::micros());
+        In in[N < InN ? N : InN];
+        value_type out[N < InN ? N : InN];
+        const size_t cnt = _input.pop(in, num);
+        for (size_t i = 0; i < cnt; ++i) {
+            out[i] = _f(in[i]);
+        }
+        _output.push(out, cnt);  // Never full, only this stage pushes
+        _metrics.record(static_cast<uint32_t>(m5::utility::micros()) - start, cnt, waiting);
+        return cnt;
+    }
+
+    inline Ring<value_type, N>& output()
+    {
+        return _output;
+    }
+    inline const Metrics& metrics() const
+    {
+        return _metrics;
+    }
+
+private:
+    Ring<In, InN>& _input;
+    F _f;
+    size_t _batch{};
+    Ring<value_type, N> _output{};
+    Metrics _metrics{};
+};
+
+#if defined(ESP_PLATFORM)
+/*!
+  @class Task
+  @brief FreeRTOS task pinned to the core, calling process() of the step repeatedly
+  @details Waits a tick while the step has nothing to process
+  @note On single core targets, the core is ignored
+ */
+class Task {
+public:
+    Task() = default;
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task()
+    {
+        stop();
+    }
+
+    /*!
+      @brief Start the task
+      @tparam S Step (Acquisition, Stage or any with size_t process())
+      @param step Step (must outlive the task)
+      @param name Task name
+      @param core Core to run on
+      @param priority Task priority
+      @param stack_size Stack size (bytes)
+      @return True if successful
+      @note The batch buffers of Stage are on the stack
+     */
+    template <class S>
+    bool start(S& step, const char* name, const int core, const uint32_t priority = 2,
+               const uint32_t stack_size = 4096)
+    {
+        return start_task(&step, &Task::invoke<S>, name, core, priority, stack_size);
+    }
+    //! @brief Stop the task and wait for its end
+    void stop();
+    //! @brief Is running?
+    inline bool running() const
+    {
+        return _handle != nullptr;
+    }
+
+protected:
+    template <class S>
+    static size_t invoke(void* step)
+    {
+        return static_cast<S*>(step)->process();
+    }
+    bool start_task(void* step, size_t (*fn)(void*), const char* name, const int core, const uint32_t priority,
+                    const uint32_t stack_size);
+    static void entry(void* arg);
+
+private:
+    void* _handle{};
+    void* _step{};
+    size_t (*_process)(void*){};
+    std::atomic<bool> _stop{}, _stopped{};
+};
+#endif
+
+}  // namespace crosscore
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
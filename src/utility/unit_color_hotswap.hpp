@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_hotswap.hpp
+  @brief Lock-free hot swap of lookup structures (Calibration, gamma table, palette, ...)
+  @details RCU-style double buffer. Readers on the sample path pin the published version without locking,
+  and the writer copies a new version into the other slot and publishes it with a single atomic store.
+  The writer waits (or fails with tryPublish()) only while a reader still pins the slot to be overwritten,
+  so reconfiguration adds no latency or contention to the readers.
+  @code
+  hotswap::Holder<Calibration> calib{Calibration{0x75, 0xAFE, 0xA1, 0x15A6, 0xAF, 0x194D}};
+  // Sample task
+  {
+      auto snap = calib.read();  // Pinned until the end of the scope
+      pipeline::Calibrate stage{*snap};
+      ...
+  }
+  // Other task
+  calib.publish(online.calibration());
+  @endcode
+  @warning Single writer. Keep the snapshots short-lived
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_HOTSWAP_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_HOTSWAP_HPP
+
+#include <M5Utility.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace hotswap
+  @brief Lock-free hot swap
+ */
+namespace hotswap {
+
+/*!
+  @class Holder
+  @brief Double-buffered holder
+  @tparam T Copy-assignable type
+ */
+template <typename T>
+class Holder {
+public:
+    /*!
+      @class Snapshot
+      @brief Pinned version (move only)
+     */
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& o) : _holder{o._holder}, _slot{o._slot}
+        {
+            o._holder = nullptr;
+        }
+        Snapshot(const Snapshot&)            = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&)      = delete;
+        ~Snapshot()
+        {
+            if (_holder) {
+                _holder->_readers[_slot].fetch_sub(1);
+            }
+        }
+
+        inline const T& operator*() const
+        {
+            return _holder->_slots[_slot];
+        }
+        inline const T* operator->() const
+        {
+            return &_holder->_slots[_slot];
+        }
+        inline const T* get() const
+        {
+            return &_holder->_slots[_slot];
+        }
+
+    private:
+        friend class Holder;
+        Snapshot(const Holder* h, const uint8_t slot) : _holder{h}, _slot{slot}
+        {
+        }
+        const Holder* _holder{};
+        uint8_t _slot{};
+    };
+
+    explicit Holder(const T& initial) : _slots{{initial, initial}}
+    {
+    }
+    Holder(const Holder&)            = delete;
+    Holder& operator=(const Holder&) = delete;
+
+    /*!
+      @brief Pin the published version (reader, lock-free)
+      @return Snapshot valid until destroyed, even if a new version is published meanwhile
+     */
+    Snapshot read() const
+    {
+        for (;;) {
+            const uint8_t slot = _index.load();
+            _readers[slot].fetch_add(1);
+            // Published again before pinned? The slot may be being overwritten
+            if (_index.load() == slot) {
+                return Snapshot{this, slot};
+            }
+            _readers[slot].fetch_sub(1);
+        }
+    }
+
+    /*!
+      @brief Publish the new version without waiting (writer)
+      @param v New version
+      @return True if published, false if a reader still pins the previous version
+     */
+    bool tryPublish(const T& v)
+    {
+        const uint8_t next = _index.load() ^ 1;
+        if (_readers[next].load()) {
+            return false;
+        }
+        _slots[next] = v;
+        _index.store(next);
+        _version.fetch_add(1);
+        return true;
+    }
+    /*!
+      @brief Publish the new version (writer)
+      @param v New version
+      @param timeout_ms Maximum time to wait for the readers of the previous version
+      @return True if published
+     */
+    bool publish(const T& v, const uint32_t timeout_ms = 100)
+    {
+        auto timeout_at = m5::utility::millis() + timeout_ms;
+        do {
+            if (tryPublish(v)) {
+                return true;
+            }
+            m5::utility::delay(1);
+        } while (m5::utility::millis() <= timeout_at);
+        return false;
+    }
+    /*!
+      @brief Publish the modified copy of the current version (writer)
+      @tparam F Function of void(T&)
+      @param f Modifier
+      @param timeout_ms Maximum time to wait for the readers of the previous version
+      @return True if published
+     */
+    template <typename F>
+    bool update(F f, const uint32_t timeout_ms = 100)
+    {
+        T v = _slots[_index.load()];
+        f(v);
+        return publish(v, timeout_ms);
+    }
+
+    //! @brief Number of the publications
+    inline uint32_t version() const
+    {
+        return _version.load();
+    }
+    //! @brief Is the version pinned by any reader?
+    inline bool pinned() const
+    {
+        return _readers[0].load() || _readers[1].load();
+    }
+
+private:
+    std::array<T, 2> _slots;
+    std::atomic<uint8_t> _index{0};
+    std::atomic<uint32_t> _version{0};
+    mutable std::array<std::atomic<uint32_t>, 2> _readers{};
+};
+
+}  // namespace hotswap
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_inference.cpp
+  @brief Quantized inference for color/material classification
+*/
+#include "unit_color_inference.hpp"
+#include <M5Utility.hpp>
+
+namespace {
+
+constexpr uint32_t gain_table[4] = {1, 4, 16, 60};
+
+// (v / c) in Q8, clamped to 0 - 255 and shifted to int8
+inline int8_t ratio_q8(const int32_t v, const int32_t c)
+{
+    if (c <= 0 || v <= 0) {
+        return -128;
+    }
+    const uint32_t q = (static_cast<uint32_t>(v) << 8) / static_cast<uint32_t>(c);
+    return static_cast<int8_t>(static_cast<int32_t>(q > 255 ? 255 : q) - 128);
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace inference {
+
+uint8_t log2_q3(const uint64_t v)
+{
+    if (!v) {
+        return 0;
+    }
+    uint8_t p{};
+    while ((v >> p) > 1) {
+        ++p;
+    }
+    // 3 bits below the MSB as linear fraction
+    const uint8_t frac = static_cast<uint8_t>(((p >= 3) ? (v >> (p - 3)) : (v << (3 - p))) & 0x07);
+    return static_cast<uint8_t>(p * 8 + frac);
+}
+
+Features extractFeatures(const Data& d, const uint8_t atime, const Gain gc)
+{
+    Features f{};
+    const int32_t r  = d.R16();
+    const int32_t g  = d.G16();
+    const int32_t b  = d.B16();
+    const int32_t c  = d.C16();
+    const int32_t ir = (r + g + b - c) / 2;  // Same as Data::IR()
+
+    f[m5::stl::to_underlying(Feature::RatioR)]     = ratio_q8(r, c);
+    f[m5::stl::to_underlying(Feature::RatioG)]     = ratio_q8(g, c);
+    f[m5::stl::to_underlying(Feature::RatioB)]     = ratio_q8(b, c);
+    f[m5::stl::to_underlying(Feature::RatioRnoIR)] = ratio_q8(d.RnoIR16(), d.CnoIR16());
+    f[m5::stl::to_underlying(Feature::RatioGnoIR)] = ratio_q8(d.GnoIR16(), d.CnoIR16());
+    f[m5::stl::to_underlying(Feature::RatioBnoIR)] = ratio_q8(d.BnoIR16(), d.CnoIR16());
+    f[m5::stl::to_underlying(Feature::CRATIO)]     = ratio_q8(ir, c);
+
+    // Lux as calculateLux, in integer
+    // G'' = 0.136R' + G' - 0.444B' (Q10), lux = G'' * DF / (2.4 * steps * gain)
+    const int64_t g2 = 139 * static_cast<int64_t>(r - ir) + 1024 * static_cast<int64_t>(g - ir) -
+                       455 * static_cast<int64_t>(b - ir);
+    uint64_t lux{};
+    if (g2 > 0) {
+        const uint64_t den = 1024ULL * 24ULL * (256U - atime) * gain_table[m5::stl::to_underlying(gc) & 0x03];
+        lux                = (static_cast<uint64_t>(g2) * 3100ULL) / den;
+    }
+    f[m5::stl::to_underlying(Feature::LogLux)] = static_cast<int8_t>(static_cast<int32_t>(log2_q3(lux + 1)) - 128);
+    return f;
+}
+
+}  // namespace inference
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
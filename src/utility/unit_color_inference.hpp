@@ -0,0 +1,246 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_inference.hpp
+  @brief Quantized inference for color/material classification
+  @details Integer-only int8 MLP and decision forest evaluated on features extracted from tcs3472x::Data.
+  Model parameters are intended to be constexpr arrays (placed in flash) generated by tools/color_model_export.py.
+  All arithmetic is integer, so results are bit-exact between host and device.
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_INFERENCE_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_INFERENCE_HPP
+
+#include "../unit/unit_TCS3472x.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace inference
+  @brief Quantized tiny-ML inference
+ */
+namespace inference {
+
+/*!
+  @enum Feature
+  @brief Index of each element in Features
+  @details Ratio features are Q8 (real * 256) shifted by -128 to int8
+ */
+enum class Feature : uint8_t {
+    RatioR,      //!< R / C
+    RatioG,      //!< G / C
+    RatioB,      //!< B / C
+    RatioRnoIR,  //!< RnoIR / CnoIR
+    RatioGnoIR,  //!< GnoIR / CnoIR
+    RatioBnoIR,  //!< BnoIR / CnoIR
+    CRATIO,      //!< IR / C (clamped 0 - 1)
+    LogLux,      //!< log2(lux + 1) in Q3, shifted by -128
+};
+
+constexpr size_t NUMBER_OF_FEATURES{8};                   //!< Number of features
+using Features = std::array<int8_t, NUMBER_OF_FEATURES>;  //!< Quantized feature vector
+
+/*!
+  @brief Extract quantized features
+  @param d Measurement data
+  @param atime ATIME raw value used for the measurement
+  @param gc Gain used for the measurement
+  @return Features
+ */
+Features extractFeatures(const Data& d, const uint8_t atime, const Gain gc);
+
+/*!
+  @brief Integer log2 in Q3 fixed point
+  @param v Value
+  @return floor(log2(v)) * 8 + 3 bit linear fraction, 0 if v is zero
+ */
+uint8_t log2_q3(const uint64_t v);
+
+/*!
+  @struct QuantizedMLP
+  @brief int8 multilayer perceptron with one hidden layer
+  @tparam In Number of inputs
+  @tparam Hidden Number of hidden units
+  @tparam Out Number of classes
+  @details
+  hidden = clamp((acc * multiplier + round) >> shift, 0, 127) (ReLU)
+  output = argmax(acc) of the output layer
+ */
+template <size_t In, size_t Hidden, size_t Out>
+struct QuantizedMLP {
+    static_assert(In > 0 && Hidden > 0 && Out > 1, "Invalid layer size");
+
+    const int8_t* w1;    //!< Hidden weights [Hidden][In]
+    const int32_t* b1;   //!< Hidden bias [Hidden] (input zero point folded)
+    int32_t multiplier;  //!< Requantization multiplier for hidden layer
+    uint8_t shift;       //!< Requantization shift for hidden layer
+    const int8_t* w2;    //!< Output weights [Out][Hidden]
+    const int32_t* b2;   //!< Output bias [Out]
+
+    /*!
+      @brief Evaluate the scores
+      @param x Input
+      @param[out] scores Output layer accumulators
+     */
+    void evaluate(const std::array<int8_t, In>& x, std::array<int32_t, Out>& scores) const
+    {
+        int8_t h[Hidden];
+        const int64_t rounding = (shift > 0) ? (static_cast<int64_t>(1) << (shift - 1)) : 0;
+        for (size_t j = 0; j < Hidden; ++j) {
+            int32_t acc       = b1[j];
+            const int8_t* row = w1 + j * In;
+            for (size_t i = 0; i < In; ++i) {
+                acc += static_cast<int32_t>(row[i]) * x[i];
+            }
+            int64_t v = (static_cast<int64_t>(acc) * multiplier + rounding) >> shift;
+            h[j]      = static_cast<int8_t>(v < 0 ? 0 : (v > 127 ? 127 : v));
+        }
+        for (size_t k = 0; k < Out; ++k) {
+            int32_t acc       = b2[k];
+            const int8_t* row = w2 + k * Hidden;
+            for (size_t j = 0; j < Hidden; ++j) {
+                acc += static_cast<int32_t>(row[j]) * h[j];
+            }
+            scores[k] = acc;
+        }
+    }
+
+    /*!
+      @brief Classify
+      @param x Input
+      @return Class index (lowest index wins a tie)
+     */
+    uint8_t classify(const std::array<int8_t, In>& x) const
+    {
+        std::array<int32_t, Out> scores{};
+        evaluate(x, scores);
+        uint8_t best{};
+        for (size_t k = 1; k < Out; ++k) {
+            if (scores[k] > scores[best]) {
+                best = static_cast<uint8_t>(k);
+            }
+        }
+        return best;
+    }
+};
+
+/*!
+  @struct TreeNode
+  @brief Node of the decision tree
+  @details Go to left if x[feature] <= threshold, otherwise right.
+  Leaf if feature is LEAF, then left is the class index
+ */
+struct TreeNode {
+    static constexpr uint8_t LEAF{0xFF};
+    uint8_t feature;   //!< Feature index or LEAF
+    int8_t threshold;  //!< Split threshold
+    uint16_t left;     //!< Left child index or class
+    uint16_t right;    //!< Right child index
+};
+
+/*!
+  @struct DecisionForest
+  @brief Decision forest with majority vote
+  @tparam In Number of inputs
+  @tparam Out Number of classes
+ */
+template <size_t In, size_t Out>
+struct DecisionForest {
+    static_assert(In > 0 && In < TreeNode::LEAF && Out > 1, "Invalid size");
+
+    const TreeNode* nodes;  //!< All nodes of all trees
+    const uint16_t* roots;  //!< Root node index for each tree
+    uint16_t trees;         //!< Number of trees
+    uint16_t max_depth;     //!< Upper bound of the depth (Guard against malformed models)
+    uint16_t num_nodes;     //!< Number of nodes
+
+    /*!
+      @brief Is the model well-formed?
+      @details All roots and children are in nodes, features are less than In, and classes are less than Out
+      @note constexpr, so the generated model is checked by static_assert
+     */
+    constexpr bool valid() const
+    {
+        return nodes && roots && num_nodes && valid_roots(0, trees) && valid_nodes(0, num_nodes);
+    }
+
+    /*!
+      @brief Evaluate the votes
+      @param x Input
+      @param[out] votes Votes for each class
+      @note Out of range indices of a malformed model end the tree without vote, never read out of bounds
+     */
+    void evaluate(const std::array<int8_t, In>& x, std::array<uint16_t, Out>& votes) const
+    {
+        votes.fill(0);
+        for (uint16_t t = 0; t < trees; ++t) {
+            if (roots[t] >= num_nodes) {
+                continue;
+            }
+            const TreeNode* n = nodes + roots[t];
+            uint16_t depth{};
+            while (n->feature < In && depth++ < max_depth) {
+                const uint16_t next = (x[n->feature] <= n->threshold) ? n->left : n->right;
+                if (next >= num_nodes) {
+                    break;
+                }
+                n = nodes + next;
+            }
+            if (n->feature == TreeNode::LEAF && n->left < Out) {
+                ++votes[n->left];
+            }
+        }
+    }
+
+    /*!
+      @brief Classify
+      @param x Input
+      @return Class index (lowest index wins a tie)
+     */
+    uint8_t classify(const std::array<int8_t, In>& x) const
+    {
+        std::array<uint16_t, Out> votes{};
+        evaluate(x, votes);
+        uint8_t best{};
+        for (size_t k = 1; k < Out; ++k) {
+            if (votes[k] > votes[best]) {
+                best = static_cast<uint8_t>(k);
+            }
+        }
+        return best;
+    }
+
+protected:
+    // Divide and conquer keeps the constexpr recursion depth at log2(n)
+    constexpr bool valid_node(const TreeNode& n) const
+    {
+        return (n.feature == TreeNode::LEAF) ? n.left < Out
+                                             : (n.feature < In && n.left < num_nodes && n.right < num_nodes);
+    }
+    constexpr bool valid_nodes(const size_t first, const size_t last) const
+    {
+        return (last - first == 1) ? valid_node(nodes[first])
+                                   : (valid_nodes(first, first + (last - first) / 2) &&
+                                      valid_nodes(first + (last - first) / 2, last));
+    }
+    constexpr bool valid_roots(const size_t first, const size_t last) const
+    {
+        return (last - first == 0)   ? true
+               : (last - first == 1) ? roots[first] < num_nodes
+                                     : (valid_roots(first, first + (last - first) / 2) &&
+                                        valid_roots(first + (last - first) / 2, last));
+    }
+};
+
+}  // namespace inference
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,180 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_marker.cpp
+  @brief Streaming color-code / marker sequence decoder
+*/
+#include "unit_color_marker.hpp"
+#include <M5Utility.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+inline uint8_t ratio_q8(const uint16_t v, const uint16_t c)
+{
+    return c ? static_cast<uint8_t>(std::min<uint32_t>((static_cast<uint32_t>(v) << 8) / c, 255U)) : 0;
+}
+
+inline uint16_t l1(const m5::unit::tcs3472x::marker::Chroma& a, const m5::unit::tcs3472x::marker::Chroma& b)
+{
+    return std::abs(a.r - b.r) + std::abs(a.g - b.g) + std::abs(a.b - b.b);
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace marker {
+
+Chroma chroma(const Data& d)
+{
+    const uint16_t c = d.C16();
+    return Chroma{ratio_q8(d.R16(), c), ratio_q8(d.G16(), c), ratio_q8(d.B16(), c)};
+}
+
+// class Decoder
+Decoder::Decoder(const Reference* palette, const size_t num, const Config& cfg)
+    : _palette{palette}, _num{static_cast<uint8_t>(std::min(num, MAX_PALETTE))}, _cfg{cfg}
+{
+    assert(num <= MAX_PALETTE && "Too many references");
+}
+
+uint8_t Decoder::classify(const Chroma& c, uint16_t& dist) const
+{
+    uint8_t sym{UNKNOWN};
+    dist = 0xFFFF;
+    for (uint_fast8_t i = 0; i < _num; ++i) {
+        const uint16_t dd = l1(c, _palette[i].chroma);
+        if (dd < dist) {
+            dist = dd;
+            sym  = _palette[i].symbol;
+        }
+    }
+    return (dist <= _cfg.tolerance) ? sym : UNKNOWN;
+}
+
+uint16_t Decoder::distance_to(const Chroma& c, const uint8_t symbol) const
+{
+    for (uint_fast8_t i = 0; i < _num; ++i) {
+        if (_palette[i].symbol == symbol) {
+            return l1(c, _palette[i].chroma);
+        }
+    }
+    return 0xFFFF;
+}
+
+bool Decoder::push(const Data& d, const uint32_t at_ms)
+{
+    uint8_t cls{UNKNOWN};
+    if (d.C16() >= _cfg.min_clear) {
+        const Chroma c = chroma(d);
+        uint16_t dist{};
+        cls = classify(c, dist);
+        // Hysteresis: stay in the current class unless the new one is clearly closer
+        if (cls != _current && _current != UNKNOWN) {
+            const uint16_t cur = distance_to(c, _current);
+            if (cur <= _cfg.tolerance + _cfg.hysteresis && (cls == UNKNOWN || cur <= dist + _cfg.hysteresis)) {
+                cls = _current;
+            }
+        }
+    }
+
+    if (cls == _current) {
+        _candidate_count = 0;
+    } else {
+        if (cls != _candidate || !_candidate_count) {
+            _candidate       = cls;
+            _candidate_count = 0;
+            _candidate_at    = at_ms;
+        }
+        // Minimum dwell
+        if (++_candidate_count >= _cfg.min_dwell) {
+            close_run(_candidate_at);
+            // Background to background (e.g. dark to the tape base) continues the gap
+            if (!is_background(_current) || !is_background(_candidate)) {
+                _run_start = _candidate_at;
+            }
+            _current         = _candidate;
+            _candidate_count = 0;
+        }
+    }
+
+    // Long background ends the sequence
+    if (_seq.length && is_background(_current) && !_candidate_count && at_ms - _run_start >= _cfg.gap_ms) {
+        return emit();
+    }
+    return false;
+}
+
+bool Decoder::flush(const uint32_t at_ms)
+{
+    close_run(at_ms);
+    _current         = UNKNOWN;
+    _run_start       = at_ms;
+    _candidate_count = 0;
+    return _seq.length ? emit() : false;
+}
+
+void Decoder::reset()
+{
+    _current         = UNKNOWN;
+    _candidate       = UNKNOWN;
+    _candidate_count = 0;
+    _seq             = Sequence{};
+    _head = _count = 0;
+    _dropped       = 0;
+}
+
+void Decoder::close_run(const uint32_t end_ms)
+{
+    if (is_background(_current)) {
+        return;
+    }
+    if (!_seq.length) {
+        _seq.start_ms = _run_start;
+    }
+    if (_seq.length < MAX_SEQUENCE_LENGTH) {
+        _seq.symbols[_seq.length]      = _current;
+        _seq.durations_ms[_seq.length] = static_cast<uint16_t>(std::min<uint32_t>(end_ms - _run_start, 0xFFFF));
+        ++_seq.length;
+    } else {
+        _seq.overflow = true;
+    }
+    _seq.end_ms = end_ms;
+}
+
+bool Decoder::emit()
+{
+    if (_count >= _queue.size()) {
+        // Discard the oldest
+        _head = (_head + 1) % _queue.size();
+        --_count;
+        ++_dropped;
+    }
+    _queue[(_head + _count) % _queue.size()] = _seq;
+    ++_count;
+    _seq = Sequence{};
+    return true;
+}
+
+bool Decoder::pop(Sequence& seq)
+{
+    if (!_count) {
+        return false;
+    }
+    seq   = _queue[_head];
+    _head = (_head + 1) % _queue.size();
+    --_count;
+    return true;
+}
+
+}  // namespace marker
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
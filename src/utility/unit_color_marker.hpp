@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_marker.hpp
+  @brief Streaming color-code / marker sequence decoder
+  @details Samples are classified to the nearest reference chromaticity of a palette, segmented into color runs
+  with hysteresis and minimum dwell, and runs between background gaps are emitted as symbol sequences with timing.
+  Per-sample cost is bounded by the palette size, and all the state is fixed size.
+  @code
+  unit.update();
+  if (unit.updated()) {
+      decoder.push(unit.latest(), unit.updatedMillis());
+  }
+  marker::Sequence seq{};
+  while (decoder.pop(seq)) { ... }
+  @endcode
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_MARKER_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_MARKER_HPP
+
+#include "../unit/unit_TCS3472x.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace marker
+  @brief Color-code / marker sequence decoder
+ */
+namespace marker {
+
+constexpr uint8_t UNKNOWN{0xFF};           //!< Symbol of the unclassified (or too dark) sample
+constexpr size_t MAX_PALETTE{16};          //!< Maximum number of the references
+constexpr size_t MAX_SEQUENCE_LENGTH{16};  //!< Maximum number of symbols in a sequence
+constexpr size_t SEQUENCE_QUEUE_SIZE{4};   //!< Number of the sequences to be held until popped
+
+/*!
+  @struct Chroma
+  @brief Chromaticity of the sample in Q8 (channel * 256 / clear, saturated)
+ */
+struct Chroma {
+    uint8_t r, g, b;
+};
+
+/*!
+  @struct Reference
+  @brief Reference color of the symbol
+ */
+struct Reference {
+    uint8_t symbol;  //!< Symbol (any value except UNKNOWN)
+    Chroma chroma;   //!< Reference chromaticity (See also chroma())
+};
+
+//! @brief Chromaticity of the sample
+Chroma chroma(const Data& d);
+
+/*!
+  @struct Config
+  @brief Decoder settings
+ */
+struct Config {
+    //! Maximum L1 distance of the chromaticity to a reference
+    uint16_t tolerance{36};
+    //! Distance margin required to leave the current class (hysteresis)
+    uint16_t hysteresis{8};
+    //! Consecutive samples required to confirm a new class (minimum dwell)
+    uint8_t min_dwell{2};
+    //! Clear value below is UNKNOWN (e.g. no tape)
+    uint16_t min_clear{16};
+    //! Symbol of the tape base. UNKNOWN is always treated as background
+    uint8_t background{UNKNOWN};
+    //! Background longer than this (ms) ends the sequence (must exceed the gap between the marks)
+    uint32_t gap_ms{100};
+};
+
+/*!
+  @struct Sequence
+  @brief Decoded symbol sequence with timing
+ */
+struct Sequence {
+    uint8_t symbols[MAX_SEQUENCE_LENGTH]{};        //!< Symbols
+    uint16_t durations_ms[MAX_SEQUENCE_LENGTH]{};  //!< Duration of each symbol (ms)
+    uint8_t length{};                              //!< Number of the symbols
+    bool overflow{};                               //!< Symbols exceeding MAX_SEQUENCE_LENGTH were discarded
+    uint32_t start_ms{};                           //!< Start of the first symbol
+    uint32_t end_ms{};                             //!< End of the last symbol
+};
+
+/*!
+  @class Decoder
+  @brief Streaming marker sequence decoder
+ */
+class Decoder {
+public:
+    /*!
+      @param palette References (placed in flash as constexpr is recommended)
+      @param num Number of references (up to MAX_PALETTE)
+      @param cfg Settings
+     */
+    Decoder(const Reference* palette, const size_t num, const Config& cfg = Config{});
+
+    /*!
+      @brief Push the sample
+      @param d Measurement data
+      @param at_ms Time of the sample (e.g. updatedMillis())
+      @return True if a sequence is emitted
+     */
+    bool push(const Data& d, const uint32_t at_ms);
+    /*!
+      @brief Emit the sequence in progress
+      @param at_ms Current time
+      @return True if a sequence is emitted
+     */
+    bool flush(const uint32_t at_ms);
+    //! @brief Discard the state and the queued sequences
+    void reset();
+
+    //! @brief Number of the queued sequences
+    inline size_t available() const
+    {
+        return _count;
+    }
+    /*!
+      @brief Pop the oldest sequence
+      @param[out] seq Sequence
+      @return True if popped
+     */
+    bool pop(Sequence& seq);
+    //! @brief Number of the sequences discarded because the queue was full
+    inline uint32_t dropped() const
+    {
+        return _dropped;
+    }
+    //! @brief Current confirmed symbol
+    inline uint8_t current() const
+    {
+        return _current;
+    }
+    /*!
+      @brief Classify the sample
+      @param c Chromaticity
+      @param[out] dist L1 distance to the class (or to the nearest if UNKNOWN)
+      @return Symbol, UNKNOWN if no reference is within the tolerance
+     */
+    uint8_t classify(const Chroma& c, uint16_t& dist) const;
+
+protected:
+    uint16_t distance_to(const Chroma& c, const uint8_t symbol) const;
+    bool is_background(const uint8_t symbol) const
+    {
+        return symbol == UNKNOWN || symbol == _cfg.background;
+    }
+    void close_run(const uint32_t end_ms);
+    bool emit();
+
+private:
+    const Reference* _palette{};
+    uint8_t _num{};
+    Config _cfg{};
+
+    // Confirmed run
+    uint8_t _current{UNKNOWN};
+    uint32_t _run_start{};
+    // Candidate of the next run
+    uint8_t _candidate{UNKNOWN}, _candidate_count{};
+    uint32_t _candidate_at{};
+    // Sequence in progress
+    Sequence _seq{};
+    // Output queue
+    std::array<Sequence, SEQUENCE_QUEUE_SIZE> _queue{};
+    uint8_t _head{}, _count{};
+    uint32_t _dropped{};
+};
+
+}  // namespace marker
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
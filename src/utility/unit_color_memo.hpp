@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_memo.hpp
+  @brief Memoizing cache for per-color computations
+  @details Fixed-size direct-mapped cache keyed on the quantized raw channels and the gain/ATIME of the sample.
+  Any computation of Data (color conversion, distance to references, classification, ...) is memoized,
+  so on static scenes the cost approaches a hash and a compare.
+  Invalidation is O(1) by the generation, e.g. when the calibration or the palette used by the computation changes.
+  @code
+  auto classify = memo::make_cache<64>([&model](const Data& d) { return model.classify(d); });
+  uint8_t cls = classify(unit.latest());
+  classify.sync(calibration.version());  // Invalidate if the source is updated
+  @endcode
+  @note With Shift > 0, samples in the same quantization step share the result of the first one
+  @note Quantization does not absorb noise across a step boundary. A channel jittering between 4001 and 4002
+  (Shift 1) is two keys, so a static scene costs up to 2^4 misses (every combination of the four channels)
+  instead of one, and more if those keys collide in the cache. Use a larger Shift than the noise, or filter
+  the samples before the cache, where the hit rate matters
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_MEMO_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_MEMO_HPP
+
+#include "../unit/unit_TCS3472x.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace memo
+  @brief Memoization
+ */
+namespace memo {
+
+/*!
+  @class Cache
+  @brief Direct-mapped memoizing cache
+  @tparam F Computation, value_type(const Data&) (value_type must be default constructible)
+  @tparam Size Number of entries (power of 2)
+  @tparam Shift Quantization of the raw channels (right shift, 0 for exact)
+ */
+template <typename F, size_t Size = 64, uint8_t Shift = 1>
+class Cache {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of 2");
+    static_assert(Shift < 16, "Invalid shift");
+
+public:
+    using value_type = typename std::decay<decltype(std::declval<const F&>()(std::declval<const Data&>()))>::type;
+
+    explicit Cache(const F& f) : _f(f)
+    {
+    }
+
+    /*!
+      @brief Gets the (memoized) result
+      @param d Measurement data
+      @return Result, valid until the next call
+     */
+    const value_type& operator()(const Data& d)
+    {
+        const uint64_t ch = static_cast<uint64_t>(d.C16() >> Shift) | (static_cast<uint64_t>(d.R16() >> Shift) << 16) |
+                            (static_cast<uint64_t>(d.G16() >> Shift) << 32) |
+                            (static_cast<uint64_t>(d.B16() >> Shift) << 48);
+        const uint16_t settings = (static_cast<uint16_t>(d.atime) << 2) | m5::stl::to_underlying(d.gain);
+        auto& e                 = _entries[index_of(ch, settings)];
+        if (e.generation == _generation && e.channels == ch && e.settings == settings) {
+            ++_hits;
+            return e.value;
+        }
+        ++_misses;
+        e.value      = _f(d);
+        e.channels   = ch;
+        e.settings   = settings;
+        e.generation = _generation;
+        return e.value;
+    }
+
+    //! @brief Invalidate all the entries
+    void invalidate()
+    {
+        if (++_generation == 0) {
+            // Wrapped, entries of the old generations must not match
+            for (auto&& e : _entries) {
+                e.generation = 0;
+            }
+            _generation = 1;
+        }
+    }
+    /*!
+      @brief Invalidate if the source of the computation is updated
+      @param version Version of the source (e.g. hotswap::Holder::version())
+      @return True if invalidated
+     */
+    bool sync(const uint32_t version)
+    {
+        if (version == _version) {
+            return false;
+        }
+        _version = version;
+        invalidate();
+        return true;
+    }
+
+    ///@name Statistics
+    ///@{
+    inline uint32_t hits() const
+    {
+        return _hits;
+    }
+    inline uint32_t misses() const
+    {
+        return _misses;
+    }
+    //! @brief Hit rate (0.0 - 1.0)
+    inline float hitRate() const
+    {
+        return (_hits + _misses) ? static_cast<float>(_hits) / (_hits + _misses) : 0.0f;
+    }
+    inline void resetStatistics()
+    {
+        _hits = _misses = 0;
+    }
+    ///@}
+
+    //! @brief Number of entries
+    static constexpr size_t size()
+    {
+        return Size;
+    }
+
+protected:
+    static size_t index_of(const uint64_t ch, const uint16_t settings)
+    {
+        // Fibonacci hashing, upper bits are the best mixed
+        return static_cast<size_t>(((ch ^ (static_cast<uint64_t>(settings) << 7)) * 0x9E3779B97F4A7C15ULL) >>
+                                   (64 - log2(Size)));
+    }
+    static constexpr uint8_t log2(const size_t v)
+    {
+        return v > 1 ? 1 + log2(v >> 1) : 0;
+    }
+
+private:
+    struct Entry {
+        uint64_t channels{};
+        uint16_t settings{};
+        uint16_t generation{};  // 0: empty
+        value_type value{};
+    };
+
+    F _f;
+    std::array<Entry, Size> _entries{};
+    uint16_t _generation{1};
+    uint32_t _version{};
+    uint32_t _hits{}, _misses{};
+};
+
+/*!
+  @brief Make the cache of the computation
+  @tparam Size Number of entries (power of 2)
+  @tparam Shift Quantization of the raw channels (right shift, 0 for exact)
+  @param f Computation
+ */
+template <size_t Size = 64, uint8_t Shift = 1, typename F>
+Cache<F, Size, Shift> make_cache(const F& f)
+{
+    return Cache<F, Size, Shift>(f);
+}
+
+}  // namespace memo
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_pipeline.hpp
+  @brief Compile-time composed conversion from Data to pixel
+  @details Each step (IR compensation, normalization, tone and output format) is a policy type.
+  The composed Pipeline::operator() is a single inlined function without runtime branches on the options,
+  and the shared values (e.g. IR component) are calculated only once per sample.
+  Results are identical to the corresponding hand-written calls of Data / Calibration.
+  @code
+  using namespace m5::unit::tcs3472x::pipeline;
+  // Same as Data::color565(gamma[calib.R8(d)], gamma[calib.G8(d)], gamma[calib.B8(d)])
+  Pipeline<NoIR, Calibrate, Gamma, RGB565> pl{Calibrate{calib}, Gamma{gammaTable}};
+  uint16_t clr = pl(d);
+  @endcode
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_PIPELINE_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_PIPELINE_HPP
+
+#include "unit_color_utility.hpp"
+#include <array>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace pipeline
+  @brief Policy-based conversion pipeline
+ */
+namespace pipeline {
+
+/*!
+  @struct Channels
+  @brief Intermediate values between the steps
+ */
+struct Channels {
+    int32_t r, g, b, c;
+};
+
+/*!
+  @struct RGB8
+  @brief 8-bit RGB between the steps
+ */
+struct RGB8 {
+    uint8_t r, g, b;
+};
+
+///@name Source policies
+///@{
+//! @brief Raw RGBC (Same as R16/G16/B16/C16)
+struct Raw {
+    inline static Channels apply(const Data& d)
+    {
+        return Channels{d.R16(), d.G16(), d.B16(), d.C16()};
+    }
+};
+
+//! @brief RGBC without IR component (Same as RnoIR16/GnoIR16/BnoIR16/CnoIR16)
+struct NoIR {
+    inline static Channels apply(const Data& d)
+    {
+        const int32_t r = d.R16(), g = d.G16(), b = d.B16(), c = d.C16();
+        // Same as Data::IR()
+        const int32_t ir = static_cast<int32_t>((r + g + b - c) * 0.5f);
+        return Channels{clamp16(r - ir), clamp16(g - ir), clamp16(b - ir), clamp16(c - ir)};
+    }
+
+private:
+    inline static int32_t clamp16(const int32_t v)
+    {
+        return v < 0 ? 0 : (v > 0xFFFF ? 0xFFFF : v);
+    }
+};
+///@}
+
+///@name Normalize policies
+///@{
+//! @brief Scale by clear channel (Same as R8/G8/B8 or RnoIR8/GnoIR8/BnoIR8)
+struct ClearRatio {
+    inline RGB8 apply(const Channels& ch) const
+    {
+        return RGB8{Data::raw_to_uint8(ch.r, ch.c), Data::raw_to_uint8(ch.g, ch.c), Data::raw_to_uint8(ch.b, ch.c)};
+    }
+};
+
+/*!
+  @brief Black/white calibration (Same as Calibration::R8/G8/B8)
+  @note Calibration uses the values without IR component, so combine with NoIR to get the same result
+  @note The calibration is referenced (must outlive the pipeline), so its updates are applied
+ */
+struct Calibrate {
+    explicit Calibrate(const Calibration& c) : calib{&c}
+    {
+    }
+    explicit Calibrate(Calibration&&) = delete;  // Would dangle
+    inline RGB8 apply(const Channels& ch) const
+    {
+        return RGB8{Calibration::linear(ch.r, calib->blackR, calib->whiteR),
+                    Calibration::linear(ch.g, calib->blackG, calib->whiteG),
+                    Calibration::linear(ch.b, calib->blackB, calib->whiteB)};
+    }
+    const Calibration* calib{};
+};
+///@}
+
+///@name Tone policies
+///@{
+//! @brief As is
+struct Linear {
+    inline RGB8 apply(const RGB8& v) const
+    {
+        return v;
+    }
+};
+
+//! @brief Gamma correction by table (e.g. make_gamma_table(), must outlive the pipeline)
+struct Gamma {
+    explicit Gamma(const std::array<uint8_t, 256>& t) : table{t.data()}
+    {
+    }
+    explicit Gamma(std::array<uint8_t, 256>&&) = delete;  // Would dangle
+    inline RGB8 apply(const RGB8& v) const
+    {
+        return RGB8{table[v.r], table[v.g], table[v.b]};
+    }
+    const uint8_t* table{};
+};
+///@}
+
+///@name Format policies
+///@{
+//! @brief RGB565
+struct RGB565 {
+    using value_type = uint16_t;
+    inline static constexpr value_type apply(const RGB8& v)
+    {
+        return Data::color565(v.r, v.g, v.b);
+    }
+};
+//! @brief RGB888
+struct RGB888 {
+    using value_type = uint32_t;
+    inline static constexpr value_type apply(const RGB8& v)
+    {
+        return Data::color888(v.r, v.g, v.b);
+    }
+};
+//! @brief RGB332
+struct RGB332 {
+    using value_type = uint8_t;
+    inline static constexpr value_type apply(const RGB8& v)
+    {
+        return Data::color332(v.r, v.g, v.b);
+    }
+};
+//! @brief Byte-swapped RGB565 (For transferring to the panel directly)
+struct Swap565 {
+    using value_type = uint16_t;
+    inline static constexpr value_type apply(const RGB8& v)
+    {
+        return Data::swap565(v.r, v.g, v.b);
+    }
+};
+//! @brief 8-bit RGB as is
+struct Components {
+    using value_type = RGB8;
+    inline static constexpr value_type apply(const RGB8& v)
+    {
+        return v;
+    }
+};
+///@}
+
+/*!
+  @class Pipeline
+  @brief Composed conversion from Data
+  @tparam Source Source policy (Raw, NoIR)
+  @tparam Normalize Normalize policy (ClearRatio, Calibrate)
+  @tparam Tone Tone policy (Linear, Gamma)
+  @tparam Format Format policy (RGB565, RGB888, RGB332, Swap565, Components)
+ */
+template <class Source, class Normalize, class Tone, class Format>
+class Pipeline {
+public:
+    using value_type = typename Format::value_type;
+
+    explicit Pipeline(const Normalize& n = Normalize{}, const Tone& t = Tone{}) : _normalize(n), _tone(t)
+    {
+    }
+
+    //! @brief Convert
+    inline value_type operator()(const Data& d) const
+    {
+        return Format::apply(_tone.apply(_normalize.apply(Source::apply(d))));
+    }
+
+    /*!
+      @brief Convert multiple data
+      @param[out] out Output
+      @param src Input
+      @param num Number of data
+     */
+    inline void operator()(value_type* out, const Data* src, const size_t num) const
+    {
+        for (size_t i = 0; i < num; ++i) {
+            out[i] = (*this)(src[i]);
+        }
+    }
+
+private:
+    Normalize _normalize;
+    Tone _tone;
+};
+
+}  // namespace pipeline
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_spc.cpp
+  @brief Streaming statistical process control (drift detection)
+*/
+#include "unit_color_spc.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace spc {
+
+// class Chart
+bool Chart::setBaseline(const float target, const float sigma)
+{
+    if (!std::isfinite(target) || !std::isfinite(sigma) || sigma <= 0.0f) {
+        return false;
+    }
+    _target = target;
+    _sigma  = sigma;
+    _armed  = true;
+    acknowledge();
+    return true;
+}
+
+void Chart::reset()
+{
+    _armed = false;
+    _alarm = 0;
+    _count = 0;
+    _mean = _m2 = 0.0f;
+    _cusum_hi = _cusum_lo = _ewma = 0.0f;
+    _decay                        = 1.0f;
+}
+
+void Chart::acknowledge()
+{
+    _alarm    = 0;
+    _count    = 0;
+    _cusum_hi = _cusum_lo = 0.0f;
+    _ewma                 = _target;
+    _decay                = 1.0f;
+}
+
+uint8_t Chart::push(const float x)
+{
+    if (!std::isfinite(x)) {
+        return _alarm;
+    }
+
+    if (!_armed) {
+        // Learn the baseline
+        ++_count;
+        const float delta = x - _mean;
+        _mean += delta / _count;
+        _m2 += delta * (x - _mean);
+        if (_count >= std::max<uint16_t>(_cfg.baseline, 2)) {
+            const float sd = std::sqrt(_m2 / (_count - 1));
+            setBaseline(_mean, std::max(sd, std::max(std::fabs(_mean) * _cfg.min_relative_sigma, 1e-6f)));
+        }
+        return _alarm;
+    }
+
+    ++_count;
+    const float z = (x - _target) / _sigma;
+
+    // CUSUM
+    _cusum_hi = std::max(0.0f, _cusum_hi + z - _cfg.k);
+    _cusum_lo = std::max(0.0f, _cusum_lo - z - _cfg.k);
+    if (_cusum_hi > _cfg.h) {
+        _alarm |= ALARM_CUSUM_HIGH;
+    }
+    if (_cusum_lo > _cfg.h) {
+        _alarm |= ALARM_CUSUM_LOW;
+    }
+
+    // EWMA with the exact (time-varying) limit
+    const float w = 1.0f - _cfg.lambda;
+    _ewma         = _cfg.lambda * x + w * _ewma;
+    _decay *= w * w;
+    const float limit = _cfg.L * _sigma * std::sqrt(_cfg.lambda / (2.0f - _cfg.lambda) * (1.0f - _decay));
+    if (_ewma > _target + limit) {
+        _alarm |= ALARM_EWMA_HIGH;
+    }
+    if (_ewma < _target - limit) {
+        _alarm |= ALARM_EWMA_LOW;
+    }
+    return _alarm;
+}
+
+// class Monitor
+uint8_t Monitor::push(const Data& d, const DerivedConstants& k)
+{
+    const uint32_t sum = static_cast<uint32_t>(d.R16()) + d.G16() + d.B16();
+    // Masked channels read as zero (See also UnitTCS3472x::config_t::channels)
+    if (d.channels != CHANNEL_ALL || !sum || d.C16() >= calculateSaturation(d.atime)) {
+        ++_ignored;
+        return alarm();
+    }
+    _lux.push(calculateLux(d, k));
+    _r.push(static_cast<float>(d.R16()) / sum);
+    _g.push(static_cast<float>(d.G16()) / sum);
+    return alarm();
+}
+
+void Monitor::reset()
+{
+    _lux.reset();
+    _r.reset();
+    _g.reset();
+    _ignored = 0;
+}
+
+void Monitor::acknowledge()
+{
+    _lux.acknowledge();
+    _r.acknowledge();
+    _g.acknowledge();
+}
+
+}  // namespace spc
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
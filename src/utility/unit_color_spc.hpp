@@ -0,0 +1,259 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_spc.hpp
+  @brief Streaming statistical process control (drift detection)
+  @details Two-sided CUSUM and EWMA control charts on Lux and rg chromaticity, O(1) per sample with constant memory.
+  The in-control target and sigma are learned from the first samples (or given),
+  and alarms latch until acknowledged, so slow drift (light source aging, lens fouling) is caught
+  before it exceeds the tolerance.
+  @code
+  spc::Monitor monitor{};
+  unit.setDriftMonitor(&monitor);  // Fed from update()
+  ...
+  if (monitor.alarmed()) {
+      // monitor.lux().driftSigma(), ... Recalibrate and then monitor.acknowledge()
+  }
+  @endcode
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_SPC_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_SPC_HPP
+
+#include "unit_color_utility.hpp"
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace spc
+  @brief Statistical process control
+ */
+namespace spc {
+
+///@name Alarm flags
+///@{
+constexpr uint8_t ALARM_CUSUM_HIGH{0x01};  //!< CUSUM detected the upward shift
+constexpr uint8_t ALARM_CUSUM_LOW{0x02};   //!< CUSUM detected the downward shift
+constexpr uint8_t ALARM_EWMA_HIGH{0x04};   //!< EWMA exceeded the upper control limit
+constexpr uint8_t ALARM_EWMA_LOW{0x08};    //!< EWMA exceeded the lower control limit
+///@}
+
+/*!
+  @struct ChartConfig
+  @brief Chart settings
+  @details k and h are in units of sigma. Defaults detect a 1 sigma shift in about 10 samples
+  with an in-control average run length around 500 samples
+ */
+struct ChartConfig {
+    //! CUSUM reference value (half of the shift to detect)
+    float k{0.5f};
+    //! CUSUM decision interval
+    float h{5.0f};
+    //! EWMA smoothing factor (0 < lambda <= 1)
+    float lambda{0.1f};
+    //! EWMA control limit width (in sigma of the EWMA statistic)
+    float L{2.8f};
+    //! Number of samples to learn the target and sigma (2 or more)
+    uint16_t baseline{32};
+    //! Minimum sigma relative to the target (steady quantized input has zero sample sigma)
+    float min_relative_sigma{0.001f};
+};
+
+/*!
+  @class Chart
+  @brief CUSUM and EWMA charts of a scalar
+ */
+class Chart {
+public:
+    explicit Chart(const ChartConfig& cfg = ChartConfig{}) : _cfg{cfg}
+    {
+    }
+
+    //! @brief Gets the settings
+    inline const ChartConfig& config() const
+    {
+        return _cfg;
+    }
+    /*!
+      @brief Set the in-control target and sigma (skips the learning)
+      @param target Target value
+      @param sigma Standard deviation of the in-control process (> 0)
+      @return True if successful
+     */
+    bool setBaseline(const float target, const float sigma);
+    //! @brief Discard the baseline and the statistics, and learn again
+    void reset();
+    //! @brief Restart the charts on the current baseline and clear the alarm
+    void acknowledge();
+
+    /*!
+      @brief Push the sample
+      @param x Value (Non-finite is ignored)
+      @return Alarm flags
+     */
+    uint8_t push(const float x);
+
+    //! @brief Baseline is established?
+    inline bool armed() const
+    {
+        return _armed;
+    }
+    //! @brief Latched alarm flags
+    inline uint8_t alarm() const
+    {
+        return _alarm;
+    }
+    //! @brief Any alarm?
+    inline bool alarmed() const
+    {
+        return _alarm != 0;
+    }
+    //! @brief In-control target
+    inline float target() const
+    {
+        return _target;
+    }
+    //! @brief In-control sigma
+    inline float sigma() const
+    {
+        return _sigma;
+    }
+    //! @brief EWMA statistic
+    inline float ewma() const
+    {
+        return _ewma;
+    }
+    //! @brief Drift magnitude (EWMA - target)
+    inline float drift() const
+    {
+        return _armed ? _ewma - _target : 0.0f;
+    }
+    //! @brief Drift magnitude in units of sigma
+    inline float driftSigma() const
+    {
+        return _armed ? (_ewma - _target) / _sigma : 0.0f;
+    }
+    //! @brief Upper CUSUM (in units of sigma)
+    inline float cusumHigh() const
+    {
+        return _cusum_hi;
+    }
+    //! @brief Lower CUSUM (in units of sigma)
+    inline float cusumLow() const
+    {
+        return _cusum_lo;
+    }
+    //! @brief Samples since armed or acknowledged
+    inline uint32_t count() const
+    {
+        return _count;
+    }
+
+private:
+    ChartConfig _cfg{};
+    bool _armed{};
+    uint8_t _alarm{};
+    float _target{}, _sigma{};
+    float _cusum_hi{}, _cusum_lo{}, _ewma{};
+    float _decay{1.0f};  // (1 - lambda)^(2 * count) for the exact EWMA limit
+    uint32_t _count{};
+    // Baseline learning (Welford)
+    float _mean{}, _m2{};
+};
+
+/*!
+  @class Monitor
+  @brief Drift monitor of Lux and rg chromaticity
+  @details Chromaticity is r = R / (R + G + B), g = G / (R + G + B), independent of the gain/ATIME.
+  Saturated and dark samples are ignored
+ */
+class Monitor {
+public:
+    /*!
+      @param lux Settings of the Lux chart
+      @param chroma Settings of the chromaticity charts
+     */
+    explicit Monitor(const ChartConfig& lux = ChartConfig{}, const ChartConfig& chroma = ChartConfig{})
+        : _lux{lux}, _r{chroma}, _g{chroma}
+    {
+    }
+
+    /*!
+      @brief Push the sample
+      @param d Measurement data
+      @param k Derived constants of the settings of the data
+      @return Alarm flags of all the charts (OR)
+      @note Saturated, dark and partial (Data::channels is not CHANNEL_ALL) samples are ignored
+     */
+    uint8_t push(const Data& d, const DerivedConstants& k);
+    //! @brief Discard the baselines and learn again
+    void reset();
+    //! @brief Restart the charts on the current baselines and clear the alarms
+    void acknowledge();
+
+    //! @brief All the charts are armed?
+    inline bool armed() const
+    {
+        return _lux.armed() && _r.armed() && _g.armed();
+    }
+    //! @brief Latched alarm flags of all the charts (OR)
+    inline uint8_t alarm() const
+    {
+        return _lux.alarm() | _r.alarm() | _g.alarm();
+    }
+    //! @brief Any alarm?
+    inline bool alarmed() const
+    {
+        return alarm() != 0;
+    }
+    //! @brief Chart of Lux
+    inline const Chart& lux() const
+    {
+        return _lux;
+    }
+    //! @brief Chart of r chromaticity
+    inline const Chart& chromaR() const
+    {
+        return _r;
+    }
+    //! @brief Chart of g chromaticity
+    inline const Chart& chromaG() const
+    {
+        return _g;
+    }
+    //! @brief Chart of Lux (e.g. setBaseline())
+    inline Chart& lux()
+    {
+        return _lux;
+    }
+    //! @brief Chart of r chromaticity
+    inline Chart& chromaR()
+    {
+        return _r;
+    }
+    //! @brief Chart of g chromaticity
+    inline Chart& chromaG()
+    {
+        return _g;
+    }
+    //! @brief Number of ignored samples (saturated, dark or not all the channels populated)
+    inline uint32_t ignored() const
+    {
+        return _ignored;
+    }
+
+private:
+    Chart _lux{}, _r{}, _g{};
+    uint32_t _ignored{};
+};
+
+}  // namespace spc
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
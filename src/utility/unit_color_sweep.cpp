@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_sweep.cpp
+  @brief Exposure sweep characterization
+*/
+#include "unit_color_sweep.hpp"
+#include <M5Utility.hpp>
+#include <algorithm>
+
+namespace {
+inline uint16_t saturate16(const float v)
+{
+    return static_cast<uint16_t>(std::fmin(std::fmax(std::round(v), 0.0f), 65535.0f));
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace sweep {
+
+bool summarize(Entry& e, const Data* samples, const size_t num, const uint32_t elapsed_us, const uint32_t bus_bytes)
+{
+    if (!samples || num < 2) {
+        return false;
+    }
+    // Welford
+    float mean{}, m2{};
+    uint16_t maximum{};
+    for (size_t i = 0; i < num; ++i) {
+        const uint16_t c  = samples[i].C16();
+        const float delta = c - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (c - mean);
+        maximum = std::max(maximum, c);
+    }
+    const uint16_t sat = calculateSaturation(samples[0].atime);
+
+    e.gain   = samples[0].gain;
+    e.atime  = samples[0].atime;
+    e.mean   = saturate16(mean);
+    e.noise  = saturate16(std::sqrt(m2 / (num - 1)) * 16.0f);
+    e.margin = (maximum < sat) ? sat - maximum : 0;
+    e.period = saturate16(elapsed_us / (num * 100.0f));
+    e.bus    = saturate16(static_cast<float>(bus_bytes) / num);
+    return true;
+}
+
+const Entry* select(const Entry* table, const size_t num, const float max_relative_noise, const uint16_t min_margin)
+{
+    const Entry* best{};
+    for (size_t i = 0; table && i < num; ++i) {
+        const Entry& e = table[i];
+        if (e.margin < min_margin || !(e.relativeNoise() <= max_relative_noise)) {
+            continue;
+        }
+        if (!best || e.period < best->period ||
+            (e.period == best->period && e.relativeNoise() < best->relativeNoise())) {
+            best = &e;
+        }
+    }
+    return best;
+}
+
+// class UnitSensor
+bool UnitSensor::measure(Data* out, const size_t num, const Exposure& e)
+{
+    // Same exposure in chunks, to keep the exposure array on the stack
+    Exposure exp[8];
+    std::fill(std::begin(exp), std::end(exp), e);
+    for (size_t i = 0; i < num; i += 8) {
+        if (!_unit.measureSingleshotSequence(out + i, exp, std::min<size_t>(8, num - i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t UnitSensor::now_us() const
+{
+    return static_cast<uint32_t>(m5::utility::micros());
+}
+
+uint32_t UnitSensor::bus_bytes() const
+{
+    return _unit.statistics().bytes;
+}
+
+}  // namespace sweep
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
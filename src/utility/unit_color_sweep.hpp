@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_sweep.hpp
+  @brief Exposure sweep characterization
+  @details Sweeps all gains and a set of ATIME steps against a fixed target, and builds a compact table of
+  mean, noise, saturation margin, achieved sample period and bus cost for each setting.
+  The table is POD and can be stored (e.g. NVS, constexpr array) and loaded by the application
+  to pick the fastest setting meeting a noise requirement with select().
+  The sweep is a template on the sensor, so it runs on the device (UnitSensor) and on any sensor model with
+  the same measure(), now_us() and bus_bytes() (e.g. the simulator of the tests).
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_SWEEP_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_SWEEP_HPP
+
+#include "unit_color_utility.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace sweep
+  @brief Exposure sweep characterization
+ */
+namespace sweep {
+
+constexpr size_t MAX_SAMPLES{32};  //!< Maximum number of samples per setting
+constexpr size_t NUMBER_OF_GAINS{4};
+
+/*!
+  @struct Entry
+  @brief Characterization result of a setting (12 bytes)
+  @details Statistics are of the clear channel
+ */
+struct Entry {
+    Gain gain{};        //!< Gain
+    uint8_t atime{};    //!< ATIME raw value
+    uint16_t mean{};    //!< Mean
+    uint16_t noise{};   //!< Standard deviation in Q4 (x16, saturated)
+    uint16_t margin{};  //!< Saturation value - maximum (0 if saturated)
+    uint16_t period{};  //!< Achieved sample period (x100us)
+    uint16_t bus{};     //!< Bus bytes per sample
+
+    //! @brief Relative noise (stddev / mean)
+    inline float relativeNoise() const
+    {
+        return mean ? (noise / 16.0f) / mean : INFINITY;
+    }
+    //! @brief Achieved sample rate (Hz)
+    inline float rate() const
+    {
+        return period ? 10000.0f / period : 0.0f;
+    }
+};
+static_assert(sizeof(Entry) == 12, "Entry must be compact");
+
+/*!
+  @brief Summarize the samples of a setting
+  @param[out] e Entry (gain/ATIME are taken from the first sample)
+  @param samples Samples
+  @param num Number of samples
+  @param elapsed_us Time spent for the samples
+  @param bus_bytes Bus bytes spent for the samples
+  @return True if successful
+ */
+bool summarize(Entry& e, const Data* samples, const size_t num, const uint32_t elapsed_us, const uint32_t bus_bytes);
+
+/*!
+  @brief Run the sweep
+  @tparam Sensor Type that has the following
+  - bool measure(Data* out, size_t num, const Exposure& e) : num samples with the exposure
+  - uint32_t now_us() : Current time (us)
+  - uint32_t bus_bytes() : Cumulative bus bytes
+  @param sensor Sensor
+  @param atimes ATIME raw values to sweep
+  @param num_atimes Number of atimes
+  @param samples Number of samples per setting (2 - MAX_SAMPLES)
+  @param[out] out Table (NUMBER_OF_GAINS * num_atimes elements, gain major)
+  @param out_len Number of elements of out
+  @return Number of entries written, 0 on error
+ */
+template <class Sensor>
+size_t run(Sensor& sensor, const uint8_t* atimes, const size_t num_atimes, const uint8_t samples, Entry* out,
+           const size_t out_len)
+{
+    if (!atimes || !out || samples < 2 || samples > MAX_SAMPLES || out_len < NUMBER_OF_GAINS * num_atimes) {
+        return 0;
+    }
+    Data buf[MAX_SAMPLES]{};
+    size_t cnt{};
+    for (uint8_t g = 0; g < NUMBER_OF_GAINS; ++g) {
+        for (size_t i = 0; i < num_atimes; ++i) {
+            const Exposure exp{static_cast<Gain>(g), atimes[i]};
+            // Settle on the new setting first, so that the entry reflects the steady state
+            if (!sensor.measure(buf, 1, exp)) {
+                return 0;
+            }
+            const uint32_t t0 = sensor.now_us();
+            const uint32_t b0 = sensor.bus_bytes();
+            if (!sensor.measure(buf, samples, exp) ||
+                !summarize(out[cnt], buf, samples, sensor.now_us() - t0, sensor.bus_bytes() - b0)) {
+                return 0;
+            }
+            ++cnt;
+        }
+    }
+    return cnt;
+}
+
+/*!
+  @brief Select the fastest setting meeting the requirement
+  @param table Table
+  @param num Number of entries
+  @param max_relative_noise Maximum relative noise (stddev / mean)
+  @param min_margin Minimum saturation margin
+  @return Pointer to the entry, nullptr if none meets
+  @note Ties in the period are resolved by the lower noise
+ */
+const Entry* select(const Entry* table, const size_t num, const float max_relative_noise,
+                    const uint16_t min_margin = 1);
+
+/*!
+  @class UnitSensor
+  @brief Sensor adapter of UnitTCS3472x for run()
+  @details Uses measureSingleshotSequence(), so periodic measurement must be stopped.
+  Bus cost is taken from the statistics of the unit
+ */
+class UnitSensor {
+public:
+    explicit UnitSensor(UnitTCS3472x& unit) : _unit{unit}
+    {
+    }
+
+    bool measure(Data* out, const size_t num, const Exposure& e);
+    uint32_t now_us() const;
+    uint32_t bus_bytes() const;
+
+private:
+    UnitTCS3472x& _unit;
+};
+
+}  // namespace sweep
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
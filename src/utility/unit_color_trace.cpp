@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_trace.cpp
+  @brief Compile-time trace hooks for the driver
+*/
+#include "unit_color_trace.hpp"
+#if defined(M5_UNIT_COLOR_ENABLE_TRACE)
+#include <M5Utility.hpp>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace trace {
+
+Ring<M5_UNIT_COLOR_TRACE_SIZE>& ring()
+{
+    static Ring<M5_UNIT_COLOR_TRACE_SIZE> r{};
+    return r;
+}
+
+void emit(const Id id, const Phase ph, const uint16_t a0, const uint32_t a1)
+{
+    ring().emit(static_cast<uint32_t>(m5::utility::micros()), id, ph, a0, a1);
+}
+
+}  // namespace trace
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
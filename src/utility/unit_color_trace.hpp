@@ -0,0 +1,185 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_trace.hpp
+  @brief Compile-time trace hooks for the driver
+  @details Trace points emit compact binary events into a lock-free ring only if M5_UNIT_COLOR_ENABLE_TRACE is
+  defined. Otherwise the macros expand to nothing and their arguments are not evaluated.
+  The ring can be converted into Chrome trace format by tools/trace_to_chrome.py
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_TRACE_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_TRACE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(M5_UNIT_COLOR_TRACE_SIZE)
+#define M5_UNIT_COLOR_TRACE_SIZE (256)  //!< Number of events held in the ring (power of 2)
+#endif
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace trace
+  @brief Binary event tracing
+ */
+namespace trace {
+
+/*!
+  @enum Id
+  @brief Trace point
+  @note Keep in sync with EVENT_NAMES in tools/trace_to_chrome.py
+ */
+enum class Id : uint8_t {
+    Update,           //!< update()
+    IsDataReady,      //!< is_data_ready() a0:ready
+    ReadMeasurement,  //!< read_measurement() a0:first register a1:length
+    ReadRegister,     //!< Register read a0:register a1:length
+    WriteRegister,    //!< Register write a0:register a1:length
+    Retry,            //!< Transaction retry a0:attempt
+    StartPeriodic,    //!< start_periodic_measurement()
+    StopPeriodic,     //!< stop_periodic_measurement()
+    Singleshot,       //!< measureSingleshot() a0:gain a1:atime
+    Sequence,         //!< measureSingleshotSequence() a1:number of shots
+    Synchronize,      //!< synchronize()
+    TriggerStart,     //!< Start of the externally triggered integration
+    TriggerRead,      //!< Result read of the externally triggered measurement
+};
+
+/*!
+  @enum Phase
+  @brief Event phase (Same as Chrome trace "ph")
+ */
+enum class Phase : uint8_t {
+    Begin   = 'B',  //!< Duration begin
+    End     = 'E',  //!< Duration end
+    Instant = 'i',  //!< Instant
+};
+
+/*!
+  @struct Event
+  @brief Binary trace event (12 bytes, little endian on the target)
+ */
+struct Event {
+    uint32_t timestamp;  //!< Timestamp (us)
+    uint8_t id;          //!< Id
+    uint8_t phase;       //!< Phase
+    uint16_t a0;         //!< Argument 0
+    uint32_t a1;         //!< Argument 1
+};
+
+/*!
+  @class Ring
+  @brief Lock-free event ring
+  @tparam N Number of events (power of 2)
+  @details Producers reserve a slot by an atomic increment, so emit() is safe from any task.
+  The oldest events are overwritten
+ */
+template <size_t N>
+class Ring {
+    static_assert(N && !(N & (N - 1)), "N must be power of 2");
+
+public:
+    //! @brief Emit the event
+    inline void emit(const uint32_t ts, const Id id, const Phase ph, const uint16_t a0 = 0, const uint32_t a1 = 0)
+    {
+        const uint32_t idx = _head.fetch_add(1, std::memory_order_relaxed);
+        Event& e           = _events[idx & (N - 1)];
+        e.timestamp        = ts;
+        e.id               = static_cast<uint8_t>(id);
+        e.phase            = static_cast<uint8_t>(ph);
+        e.a0               = a0;
+        e.a1               = a1;
+    }
+    //! @brief Number of events emitted so far (including overwritten)
+    inline uint32_t emitted() const
+    {
+        return _head.load(std::memory_order_acquire);
+    }
+    //! @brief Discard all events
+    inline void clear()
+    {
+        _head.store(0, std::memory_order_release);
+    }
+    /*!
+      @brief Copy the held events from the oldest
+      @param[out] out Buffer
+      @param len Buffer length
+      @return Number of events copied
+      @note Events emitted while copying may be torn
+     */
+    size_t snapshot(Event* out, const size_t len) const
+    {
+        const uint32_t head = emitted();
+        const uint32_t num  = head < N ? head : N;
+        const size_t cnt    = num < len ? num : len;
+        for (size_t i = 0; i < cnt; ++i) {
+            out[i] = _events[(head - cnt + i) & (N - 1)];
+        }
+        return cnt;
+    }
+
+private:
+    Event _events[N]{};
+    std::atomic<uint32_t> _head{};
+};
+
+#if defined(M5_UNIT_COLOR_ENABLE_TRACE)
+//! @brief Gets the ring used by the trace points
+Ring<M5_UNIT_COLOR_TRACE_SIZE>& ring();
+
+//! @brief Emit the event with the current time
+void emit(const Id id, const Phase ph, const uint16_t a0 = 0, const uint32_t a1 = 0);
+
+/*!
+  @class Scope
+  @brief Emit Begin on construction and End on destruction
+ */
+class Scope {
+public:
+    Scope(const Id id, const uint16_t a0 = 0, const uint32_t a1 = 0) : _id{id}
+    {
+        emit(id, Phase::Begin, a0, a1);
+    }
+    ~Scope()
+    {
+        emit(_id, Phase::End);
+    }
+
+private:
+    Id _id{};
+};
+#endif
+
+}  // namespace trace
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+
+#if defined(M5_UNIT_COLOR_ENABLE_TRACE)
+#define M5_UNIT_COLOR_TRACE_CAT_IMPL(a, b) a##b
+#define M5_UNIT_COLOR_TRACE_CAT(a, b)      M5_UNIT_COLOR_TRACE_CAT_IMPL(a, b)
+//! @brief Instant event
+#define M5_UNIT_COLOR_TRACE(id, ...)                                                                      \
+    m5::unit::tcs3472x::trace::emit(m5::unit::tcs3472x::trace::Id::id,                                   \
+                                    m5::unit::tcs3472x::trace::Phase::Instant, ##__VA_ARGS__)
+//! @brief Duration event of the enclosing scope
+#define M5_UNIT_COLOR_TRACE_SCOPE(id, ...)                                                                \
+    m5::unit::tcs3472x::trace::Scope M5_UNIT_COLOR_TRACE_CAT(_trace_scope_, __LINE__)(                   \
+        m5::unit::tcs3472x::trace::Id::id, ##__VA_ARGS__)
+#else
+#define M5_UNIT_COLOR_TRACE(id, ...)       \
+    do {                                   \
+    } while (0)
+#define M5_UNIT_COLOR_TRACE_SCOPE(id, ...) \
+    do {                                   \
+    } while (0)
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_uncertainty.cpp
+  @brief Per-sample uncertainty estimate
+*/
+#include "unit_color_uncertainty.hpp"
+#include <M5Utility.hpp>
+#include <limits>
+
+namespace {
+constexpr float quantization{1.0f / 12.0f};
+
+// Mean and unbiased variance of the clear channel, false if the settings are mixed or saturated
+bool clear_statistics(float& mean, float& var, const m5::unit::tcs3472x::Data* s, const size_t num)
+{
+    using namespace m5::unit::tcs3472x;
+    if (!s || num < 2) {
+        return false;
+    }
+    const uint16_t sat = calculateSaturation(s[0].atime);
+    float m{}, m2{};
+    for (size_t i = 0; i < num; ++i) {
+        if (s[i].gain != s[0].gain || s[i].atime != s[0].atime || s[i].C16() >= sat) {
+            return false;
+        }
+        const float delta = s[i].C16() - m;
+        m += delta / (i + 1);
+        m2 += delta * (s[i].C16() - m);
+    }
+    mean = m;
+    var  = m2 / (num - 1);
+    return true;
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace uncertainty {
+
+float NoiseModel::variance(const uint16_t counts, const Gain gc, const uint16_t saturation) const
+{
+    if (counts >= saturation) {
+        return std::numeric_limits<float>::infinity();
+    }
+    const auto g = m5::stl::to_underlying(gc) & 0x03;
+    return shot * gains[g] * counts + read[g] * read[g] + quantization;
+}
+
+Variances variances(const Data& d, const NoiseModel& model)
+{
+    const uint16_t sat = calculateSaturation(d.atime);
+    Variances v{};
+    v.c = model.variance(d.C16(), d.gain, sat);
+    v.r = model.variance(d.R16(), d.gain, sat);
+    v.g = model.variance(d.G16(), d.gain, sat);
+    v.b = model.variance(d.B16(), d.gain, sat);
+    return v;
+}
+
+float snr(const Data& d, const NoiseModel& model)
+{
+    const float v = model.variance(d.C16(), d.gain, calculateSaturation(d.atime));
+    return std::isfinite(v) ? d.C16() / std::sqrt(v) : 0.0f;
+}
+
+Estimate estimateLux(const Data& d, const DerivedConstants& k, const NoiseModel& model, const float coefR,
+                     const float coefG, const float coefB)
+{
+    // G' = coefR * (R - IR) + coefG * (G - IR) + coefB * (B - IR), IR = (R + G + B - C) / 2 is linear in R,G,B,C
+    const float wr = (coefR - coefG - coefB) * 0.5f;
+    const float wg = (-coefR + coefG - coefB) * 0.5f;
+    const float wb = (-coefR - coefG + coefB) * 0.5f;
+    const float wc = (coefR + coefG + coefB) * 0.5f;
+
+    NoiseModel m = model;
+    m.gains      = k.gains;  // Same gains as the value
+    const auto v = variances(d, m);
+    Estimate e{};
+    e.value = calculateLux(d, k, coefR, coefG, coefB);
+    e.sigma = std::sqrt(wr * wr * v.r + wg * wg * v.g + wb * wb * v.b + wc * wc * v.c) * inverseCPL(d, k);
+    return e;
+}
+
+Estimate estimateColorTemperature(const Data& d, const NoiseModel& model, const float coefCT, const float offsetCT)
+{
+    Estimate e{};
+    e.value = calculateColorTemperature(d, coefCT, offsetCT);
+    if (!std::isfinite(e.value)) {
+        e.sigma = std::numeric_limits<float>::infinity();
+        return e;
+    }
+    // R' = (R - G - B + C) / 2, B' = (-R - G + B + C) / 2 share all channels
+    const auto v      = variances(d, model);
+    const float ir    = (d.R16() + d.G16() + d.B16() - d.C16()) * 0.5f;
+    const float rp    = d.R16() - ir;
+    const float bp    = d.B16() - ir;
+    const float q     = bp / rp;
+    const float var_p = (v.r + v.g + v.b + v.c) * 0.25f;  // Same for R' and B'
+    const float cov   = (-v.r + v.g - v.b + v.c) * 0.25f;
+    const float var_q = (var_p - 2.0f * q * cov + q * q * var_p) / (rp * rp);
+    e.sigma           = std::fabs(coefCT) * std::sqrt(std::fmax(var_q, 0.0f));
+    return e;
+}
+
+std::array<Estimate, 3> estimateRGB(const Data& d, const NoiseModel& model)
+{
+    std::array<Estimate, 3> rgb{};
+    const auto v         = variances(d, model);
+    const float c        = d.C16();
+    const float vc       = v.c;
+    const float ch[3][2] = {{static_cast<float>(d.R16()), v.r},
+                            {static_cast<float>(d.G16()), v.g},
+                            {static_cast<float>(d.B16()), v.b}};
+    const uint8_t value[3] = {d.R8(), d.G8(), d.B8()};
+    for (uint_fast8_t i = 0; i < 3; ++i) {
+        rgb[i].value = value[i];
+        // x / c * 255
+        rgb[i].sigma = (c > 0.0f) ? 255.0f / c * std::sqrt(ch[i][1] + ch[i][0] * ch[i][0] * vc / (c * c))
+                                  : std::numeric_limits<float>::infinity();
+    }
+    return rgb;
+}
+
+bool calibrateReadNoise(NoiseModel& model, const Data* dark, const size_t num)
+{
+    float mean{}, var{};
+    if (!clear_statistics(mean, var, dark, num)) {
+        return false;
+    }
+    const auto g  = m5::stl::to_underlying(dark[0].gain) & 0x03;
+    const float r = var - model.shot * model.gains[g] * mean - quantization;
+    model.read[g] = std::sqrt(std::fmax(r, 0.0f));
+    return true;
+}
+
+bool calibrateShotNoise(NoiseModel& model, const Data* samples, const size_t num)
+{
+    float mean{}, var{};
+    if (!clear_statistics(mean, var, samples, num) || mean <= 0.0f) {
+        return false;
+    }
+    const auto g     = m5::stl::to_underlying(samples[0].gain) & 0x03;
+    const float shot = (var - model.read[g] * model.read[g] - quantization) / (model.gains[g] * mean);
+    if (shot <= 0.0f) {
+        return false;
+    }
+    model.shot = shot;
+    return true;
+}
+
+}  // namespace uncertainty
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
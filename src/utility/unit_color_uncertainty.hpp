@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*!
+  @file unit_color_uncertainty.hpp
+  @brief Per-sample uncertainty estimate
+  @details Variance of each channel is modeled from the counts, gain and ATIME as
+  shot (photon) noise plus a read-noise floor calibratable per gain:
+  var(N) = shot * gain * N + read[gain]^2 + 1/12 (quantization)
+  It is propagated to Lux, color temperature and the RGB normalizations (first order, channels independent),
+  so downstream code can weight or reject samples without extra measurements.
+  Saturated channels have infinite uncertainty.
+*/
+#ifndef M5_UNIT_COLOR_UTILITY_UNIT_COLOR_UNCERTAINTY_HPP
+#define M5_UNIT_COLOR_UTILITY_UNIT_COLOR_UNCERTAINTY_HPP
+
+#include "unit_color_utility.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+
+/*!
+  @namespace uncertainty
+  @brief Per-sample uncertainty estimate
+ */
+namespace uncertainty {
+
+/*!
+  @struct NoiseModel
+  @brief Noise model of the sensor
+  @details Defaults are conservative. Use calibrateReadNoise() and calibrateShotNoise() for the device
+ */
+struct NoiseModel {
+    //! Counts per photo-electron at x1 gain (variance = shot * gain factor * counts)
+    float shot{1.0f};
+    //! Read noise floor (stddev counts) for each gain (x1, x4, x16, x60)
+    std::array<float, 4> read{{1.0f, 1.5f, 3.0f, 8.0f}};
+    //! Gain factors (See also UnitTCS3472x::gainTable())
+    GainTable gains{NOMINAL_GAINS};
+
+    /*!
+      @brief Variance of the counts
+      @param counts Raw value
+      @param gc Gain
+      @param saturation Saturation value (See also calculateSaturation())
+      @return Variance, infinity if saturated
+     */
+    float variance(const uint16_t counts, const Gain gc, const uint16_t saturation = 0xFFFF) const;
+};
+
+/*!
+  @struct Estimate
+  @brief Value and its standard uncertainty
+ */
+struct Estimate {
+    float value{};  //!< Value
+    float sigma{};  //!< Standard uncertainty (1 sigma)
+
+    //! @brief Signal to noise ratio (0 if not available)
+    inline float snr() const
+    {
+        return (sigma > 0.0f && std::isfinite(sigma)) ? std::fabs(value) / sigma : 0.0f;
+    }
+    //! @brief Relative uncertainty (sigma / |value|)
+    inline float relative() const
+    {
+        return (value != 0.0f) ? sigma / std::fabs(value) : INFINITY;
+    }
+    //! @brief Usable? (Finite value and uncertainty)
+    inline bool valid() const
+    {
+        return std::isfinite(value) && std::isfinite(sigma);
+    }
+    //! @brief Weight for the inverse variance weighted mean (0 if not usable)
+    inline float weight() const
+    {
+        return (valid() && sigma > 0.0f) ? 1.0f / (sigma * sigma) : 0.0f;
+    }
+};
+
+/*!
+  @struct Variances
+  @brief Variance of each channel
+ */
+struct Variances {
+    float c{}, r{}, g{}, b{};
+};
+
+/*!
+  @brief Variance of each channel of the sample
+  @param d Measurement data (Gain/ATIME of the data are used)
+  @param model Noise model
+ */
+Variances variances(const Data& d, const NoiseModel& model = NoiseModel{});
+
+/*!
+  @brief SNR of the clear channel
+  @param d Measurement data
+  @param model Noise model
+ */
+float snr(const Data& d, const NoiseModel& model = NoiseModel{});
+
+/*!
+  @brief Lux with uncertainty
+  @param d Measurement data
+  @param k Derived constants (See also calculateLux(const Data&, const DerivedConstants&))
+  @param model Noise model
+  @param coefR Coefficient for the R channel
+  @param coefG Coefficient for the G channel
+  @param coefB Coefficient for the B channel
+  @note The gain factors of k are used instead of those of the model
+ */
+Estimate estimateLux(const Data& d, const DerivedConstants& k, const NoiseModel& model = NoiseModel{},
+                     const float coefR = R_Coef, const float coefG = G_Coef, const float coefB = B_Coef);
+
+/*!
+  @brief Color temperature with uncertainty
+  @param d Measurement data
+  @param model Noise model
+  @param coefCT Coefficient for the color temperature
+  @param offsetCT Offset for the color temperature
+  @note The covariance of IR-compensated R and B (sharing the IR estimate) is taken into account
+ */
+Estimate estimateColorTemperature(const Data& d, const NoiseModel& model = NoiseModel{},
+                                  const float coefCT = CT_Coef, const float offsetCT = CT_Offset);
+
+/*!
+  @brief Normalized RGB (Same scale as Data::R8/G8/B8, 0 - 255) with uncertainty
+  @param d Measurement data
+  @param model Noise model
+  @return R, G, B
+ */
+std::array<Estimate, 3> estimateRGB(const Data& d, const NoiseModel& model = NoiseModel{});
+
+/*!
+  @brief Calibrate the read noise floor from dark samples
+  @param[in,out] model Noise model
+  @param dark Samples with the sensor covered (same gain)
+  @param num Number of samples (2 or more)
+  @return True if successful
+  @details Uses the clear channel. Shot noise of the dark counts is subtracted
+ */
+bool calibrateReadNoise(NoiseModel& model, const Data* dark, const size_t num);
+
+/*!
+  @brief Calibrate the shot noise scale from samples of a steady target
+  @param[in,out] model Noise model (read noise of the gain should be calibrated first)
+  @param samples Samples of a steady, unsaturated target (same gain/ATIME)
+  @param num Number of samples (2 or more)
+  @return True if successful
+  @details Uses the clear channel: shot = (var - read^2) / (gain factor * mean)
+ */
+bool calibrateShotNoise(NoiseModel& model, const Data* samples, const size_t num);
+
+}  // namespace uncertainty
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
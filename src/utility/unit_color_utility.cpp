@@ -11,9 +11,6 @@
 #include <M5Utility.hpp>
 #include <limits>
 
-namespace {
-constexpr float gain_table[4] = {1.0f, 4.0f, 16.0f, 60.0f};
-}
 
 namespace m5 {
 namespace unit {
@@ -87,12 +84,73 @@ float calculateCRATIO(const uint16_t rawR, const uint16_t rawG, const uint16_t r
     return std::fmax(std::fmin(ir / rawC, 1.0f), 0.0f);
 }
 
-float calculateCPL(const float atime_ms, const Gain gc, const float dgf)
+float calculateCPL(const float atime_ms, const Gain gc, const float dgf, const GainTable& gains)
 {
-    return (dgf > 0.0f) ? atime_ms * gain_table[m5::stl::to_underlying(gc)] / dgf
+    return (dgf > 0.0f) ? atime_ms * gains[m5::stl::to_underlying(gc) & 0x03] / dgf
                         : std::numeric_limits<float>::quiet_NaN();
 }
 
+DerivedConstants calculateDerivedConstants(const uint8_t atime, const Gain gc, const float wtime_ms, const float dgf,
+                                           const GainTable& gains)
+{
+    DerivedConstants k{};
+    k.gains       = gains;
+    k.atime       = atime;
+    k.gain        = gc;
+    k.atime_ms    = atime_to_ms(atime);
+    k.interval_ms = k.atime_ms + wtime_ms;
+    k.saturation  = calculateSaturation(atime);
+    k.cpl         = calculateCPL(k.atime_ms, gc, dgf, gains);
+    k.inv_cpl     = (k.cpl > 0.0f) ? 1.0f / k.cpl : 0.0f;
+    k.max_lux     = 65535.0f * k.inv_cpl / 3.0f;
+    return k;
+}
+
+bool calculateGainTable(GainTable& out, const Data* seq, const size_t num, const uint16_t min_counts)
+{
+    if (!seq || num < 2) {
+        return false;
+    }
+    // Sum of the ratios (higher / lower) of each adjacent pair, for steps up and down
+    float sum[3][2]{};
+    uint16_t cnt[3][2]{};
+    const uint16_t sat = calculateSaturation(seq[0].atime);
+    for (size_t i = 1; i < num; ++i) {
+        const Data& a = seq[i - 1];
+        const Data& b = seq[i];
+        const int ga  = m5::stl::to_underlying(a.gain) & 0x03;
+        const int gb  = m5::stl::to_underlying(b.gain) & 0x03;
+        if (a.atime != b.atime || (ga - gb != 1 && gb - ga != 1)) {
+            continue;
+        }
+        const bool up     = gb > ga;
+        const Data& lower = up ? a : b;
+        const Data& upper = up ? b : a;
+        if (lower.C16() < min_counts || upper.C16() >= sat) {
+            continue;
+        }
+        const int pair = up ? ga : gb;
+        sum[pair][up] += static_cast<float>(upper.C16()) / lower.C16();
+        ++cnt[pair][up];
+    }
+
+    GainTable t{};
+    t[0] = 1.0f;
+    for (uint_fast8_t p = 0; p < 3; ++p) {
+        float ratio{};
+        if (cnt[p][0] && cnt[p][1]) {
+            ratio = (sum[p][0] / cnt[p][0] + sum[p][1] / cnt[p][1]) * 0.5f;
+        } else if (cnt[p][0] || cnt[p][1]) {
+            ratio = (sum[p][0] + sum[p][1]) / (cnt[p][0] + cnt[p][1]);
+        } else {
+            return false;
+        }
+        t[p + 1] = t[p] * ratio;
+    }
+    out = t;
+    return true;
+}
+
 }  // namespace tcs3472x
 }  // namespace unit
 }  // namespace m5
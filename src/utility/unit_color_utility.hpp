@@ -14,6 +14,7 @@
 #include <cmath>
 #include <tuple>
 #include <cassert>
+#include <limits>
 
 namespace m5 {
 namespace unit {
@@ -198,20 +199,94 @@ float calculateCRATIO(const uint16_t rawR, const uint16_t rawG, const uint16_t r
   @param atime_ms integration time(ms)
   @param gc Gain
   @param dgf Device and Glass Factor
+  @param gains Gain factors (See also calculateGainTable())
   @return CPL
 */
-float calculateCPL(const float atime_ms, const Gain gc, const float dgf = DGF);
+float calculateCPL(const float atime_ms, const Gain gc, const float dgf = DGF, const GainTable& gains = NOMINAL_GAINS);
 
 /*!
   @brief Calculate maximum Lux
   @param atime_ms integration time(ms)
   @param gc Gain
   @param dgf Device and Glass Factor
+  @param gains Gain factors
   @return Lux(lx)
  */
-inline float calculateMaxLux(const float atime_ms, const Gain gc, const float dgf = DGF)
+inline float calculateMaxLux(const float atime_ms, const Gain gc, const float dgf = DGF,
+                             const GainTable& gains = NOMINAL_GAINS)
 {
-    return 65535.0f / (3.0f * calculateCPL(atime_ms, gc, dgf));
+    return 65535.0f / (3.0f * calculateCPL(atime_ms, gc, dgf, gains));
+}
+
+/*!
+  @brief Calculate the derived constants
+  @param atime ATIME raw value
+  @param gc Gain
+  @param wtime_ms Wait time(ms)
+  @param dgf Device and Glass Factor
+  @param gains Gain factors
+  @return DerivedConstants
+ */
+DerivedConstants calculateDerivedConstants(const uint8_t atime, const Gain gc, const float wtime_ms = 0.0f,
+                                           const float dgf = DGF, const GainTable& gains = NOMINAL_GAINS);
+
+/*!
+  @brief Calculate the measured gain table from a gain sequence against a stable source
+  @param[out] out Gain factors (x1 is kept as 1.0, others are the products of the adjacent ratios)
+  @param seq Measured data of the same ATIME with the gains switched between adjacent ones
+  (e.g. x1,x4,x16,x60,x16,x4,x1)
+  @param num Number of data
+  @param min_counts Minimum clear value of the lower gain to be used
+  @return True if all adjacent ratios are measured
+  @details Ratios of the steps up and down are averaged, so that a linear drift of the source cancels out.
+  Saturated data are not used
+ */
+bool calculateGainTable(GainTable& out, const Data* seq, const size_t num, const uint16_t min_counts = 100);
+
+/*!
+  @brief 1 / CPL for the data
+  @param d Measurement data
+  @param k Derived constants
+  @return 1 / CPL of the settings of the data, using the gain factors of the constants
+ */
+inline float inverseCPL(const Data& d, const DerivedConstants& k)
+{
+    return (d.atime == k.atime && d.gain == k.gain) ? k.inv_cpl
+                                                    : 1.0f / calculateCPL(atime_to_ms(d.atime), d.gain, DGF, k.gains);
+}
+
+/*!
+  @brief Calculate Lux using the derived constants
+  @param d Measurement data
+  @param k Derived constants
+  @param coefR Coefficient for the R channel
+  @param coefG Coefficient for the G channel
+  @param coefB Coefficient for the B channel
+  @return Lux (lx)
+  @note If the settings of the data differ from the constants (e.g. after saturation recovery),
+  CPL is calculated from the settings of the data and the gain factors of the constants
+ */
+inline float calculateLux(const Data& d, const DerivedConstants& k, const float coefR = R_Coef,
+                          const float coefG = G_Coef, const float coefB = B_Coef)
+{
+    const float ir = (d.R16() + d.G16() + d.B16() - d.C16()) * 0.5f;  // Same as calculateLux
+    const float g2 = coefR * (d.R16() - ir) + coefG * (d.G16() - ir) + coefB * (d.B16() - ir);
+    const float lux = g2 * inverseCPL(d, k);
+    return (lux > 0.0f) ? lux : 0.0f;
+}
+
+/*!
+  @brief Calculate color temperature(degrees Kelvin)
+  @param d Measurement data
+  @param coefCT Coefficient for the color temperature
+  @param offsetCT Offset for the color temperature
+  @return Color temperature(degrees Kelvin), NaN if not available
+ */
+inline float calculateColorTemperature(const Data& d, const float coefCT = CT_Coef, const float offsetCT = CT_Offset)
+{
+    const float ir = (d.R16() + d.G16() + d.B16() - d.C16()) * 0.5f;
+    const float rp = d.R16() - ir;
+    return (rp > 0.0f) ? coefCT * (d.B16() - ir) / rp + offsetCT : std::numeric_limits<float>::quiet_NaN();
 }
 
 ///@cond
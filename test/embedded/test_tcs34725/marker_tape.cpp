@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Simulated marker tape for marker::Decoder (test only, not a part of the library)
+*/
+#include "marker_tape.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace marker {
+
+Tape::Tape(const Reference* palette, const size_t num_palette, const Reference& background, const uint8_t* symbols,
+           const size_t num, const float mark_mm, const float gap_mm, const float spot_mm, const float leader_mm)
+    : _palette{palette},
+      _num_palette{num_palette},
+      _background(background),
+      _symbols{symbols},
+      _num{num},
+      _mark{mark_mm},
+      _gap{gap_mm},
+      _spot{spot_mm},
+      _leader{leader_mm}
+{
+}
+
+float Tape::length() const
+{
+    return _leader * 2 + _num * _mark + (_num ? _num - 1 : 0) * _gap;
+}
+
+const Chroma& Tape::chroma_at(const float mm) const
+{
+    const float pos = mm - _leader;
+    if (pos < 0.0f) {
+        return _background.chroma;
+    }
+    const size_t idx = static_cast<size_t>(pos / (_mark + _gap));
+    if (idx >= _num || pos - idx * (_mark + _gap) >= _mark) {
+        return _background.chroma;
+    }
+    for (size_t i = 0; i < _num_palette; ++i) {
+        if (_palette[i].symbol == _symbols[idx]) {
+            return _palette[i].chroma;
+        }
+    }
+    return _background.chroma;
+}
+
+float Tape::noise()
+{
+    // Sum of 4 uniforms (approximately Gaussian, stddev 1)
+    float sum{};
+    for (uint_fast8_t i = 0; i < 4; ++i) {
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        sum += (_seed >> 8) * (1.0f / 16777216.0f);
+    }
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+Data Tape::sample(const float from_mm, const float to_mm, const uint16_t clear)
+{
+    // Average over the spot moving during the integration
+    constexpr uint_fast8_t points{8};
+    const float begin = std::min(from_mm, to_mm) - _spot * 0.5f;
+    const float width = std::fabs(to_mm - from_mm) + _spot;
+    float r{}, g{}, b{};
+    for (uint_fast8_t i = 0; i < points; ++i) {
+        const auto& c = chroma_at(begin + width * (i + 0.5f) / points);
+        r += c.r;
+        g += c.g;
+        b += c.b;
+    }
+    const float scale = clear / (256.0f * points);
+    const float v[4]  = {static_cast<float>(clear), r * scale, g * scale, b * scale};
+
+    Data d{};
+    for (uint_fast8_t ch = 0; ch < 4; ++ch) {
+        const float n   = v[ch] + std::sqrt(v[ch]) * noise();
+        const auto  raw = static_cast<uint16_t>(std::fmin(std::fmax(std::round(n), 0.0f), 65535.0f));
+        d.raw[ch * 2]     = raw & 0xFF;
+        d.raw[ch * 2 + 1] = raw >> 8;
+    }
+    d.atime = 0xFF;
+    d.gain  = Gain::Controlx1;
+    return d;
+}
+
+}  // namespace marker
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
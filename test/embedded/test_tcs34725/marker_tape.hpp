@@ -0,0 +1,71 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Simulated marker tape for marker::Decoder (test only, not a part of the library)
+*/
+#ifndef M5_UNIT_COLOR_TEST_MARKER_TAPE_HPP
+#define M5_UNIT_COLOR_TEST_MARKER_TAPE_HPP
+
+#include <utility/unit_color_marker.hpp>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace marker {
+
+/*!
+  @class Tape
+  @brief Simulated marker tape for the tests
+  @details Marks of mark_mm separated by gap_mm of the background, observed through a spot of spot_mm.
+  A sample averages the tape moving during the integration, with shot noise. Deterministic for the seed
+ */
+class Tape {
+public:
+    /*!
+      @param palette References
+      @param num_palette Number of references
+      @param background Reference of the tape base
+      @param symbols Symbols on the tape
+      @param num Number of symbols
+      @param mark_mm Length of the mark
+      @param gap_mm Length of the background between marks
+      @param spot_mm Diameter of the sensor spot
+      @param leader_mm Background before the first and after the last mark
+     */
+    Tape(const Reference* palette, const size_t num_palette, const Reference& background, const uint8_t* symbols,
+         const size_t num, const float mark_mm = 5.0f, const float gap_mm = 3.0f, const float spot_mm = 2.0f,
+         const float leader_mm = 30.0f);
+
+    //! @brief Total length (mm)
+    float length() const;
+    /*!
+      @brief Sample the tape
+      @param from_mm Position at the start of the integration
+      @param to_mm Position at the end of the integration
+      @param clear Clear counts of the white
+      @return Data (x1 gain, ATIME 0xFF)
+     */
+    Data sample(const float from_mm, const float to_mm, const uint16_t clear = 2000);
+
+protected:
+    const Chroma& chroma_at(const float mm) const;
+    float noise();
+
+private:
+    const Reference* _palette{};
+    size_t _num_palette{};
+    Reference _background{};
+    const uint8_t* _symbols{};
+    size_t _num{};
+    float _mark{}, _gap{}, _spot{}, _leader{};
+    uint32_t _seed{1};
+};
+
+}  // namespace marker
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
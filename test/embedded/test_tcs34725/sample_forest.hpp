@@ -0,0 +1,100 @@
+/*
+ * Generated by tools/color_model_export.py. Do not edit.
+ */
+#ifndef M5_UNIT_COLOR_MODEL_SAMPLE_FOREST_HPP
+#define M5_UNIT_COLOR_MODEL_SAMPLE_FOREST_HPP
+
+#include <utility/unit_color_inference.hpp>
+
+namespace color_model {
+
+// Classes: 0:matte, 1:glossy
+constexpr size_t sample_forest_classes{2};
+
+constexpr m5::unit::tcs3472x::inference::TreeNode sample_forest_nodes[] = {
+    {7, -13, 1, 2},
+    {255, 0, 0, 0},
+    {6, -98, 3, 4},
+    {255, 0, 1, 0},
+    {255, 0, 0, 0},
+    {1, -52, 6, 9},
+    {7, 0, 7, 8},
+    {255, 0, 0, 0},
+    {255, 0, 1, 0},
+    {255, 0, 1, 0},
+    {6, -116, 11, 12},
+    {255, 0, 1, 0},
+    {5, -26, 13, 14},
+    {255, 0, 0, 0},
+    {255, 0, 1, 0},
+};
+
+constexpr uint16_t sample_forest_roots[] = {
+    0, 5, 10,
+};
+
+constexpr m5::unit::tcs3472x::inference::DecisionForest<8, 2> sample_forest{
+    sample_forest_nodes, sample_forest_roots, 3, 3, 15};
+static_assert(sample_forest.valid(), "Malformed model");
+
+// Reference samples {C, R, G, B, ATIME, GAIN}, and their features, scores and classes (bit-exact)
+constexpr uint16_t sample_forest_samples[][6] = {
+    {0, 0, 0, 0, 0, 1},
+    {65535, 65535, 65535, 65535, 0, 1},
+    {4000, 1000, 2000, 1500, 0, 1},
+    {48815, 4660, 22136, 39612, 0, 1},
+    {12000, 7000, 3000, 2500, 0, 1},
+    {11000, 2600, 6500, 2700, 0, 1},
+    {9800, 2100, 3000, 5400, 0, 1},
+    {700, 410, 190, 160, 192, 3},
+    {650, 170, 380, 150, 192, 3},
+    {720, 160, 210, 420, 192, 3},
+    {30000, 16000, 9000, 8000, 128, 0},
+    {31000, 8500, 17000, 8200, 128, 0},
+    {29000, 7900, 9100, 15500, 128, 0},
+    {1500, 520, 510, 530, 255, 2},
+    {20000, 15000, 15000, 15000, 64, 1},
+    {100, 90, 5, 5, 0, 0},
+};
+constexpr int8_t sample_forest_features[][8] = {
+    {-128, -128, -128, -128, -128, -128, -128, -128},
+    {127, 127, 127, -128, -128, -128, 127, -128},
+    {-64, 0, -32, -77, -9, -43, -112, -70},
+    {-104, -12, 79, -128, -43, 69, -82, -128},
+    {21, -64, -75, 19, -69, -79, -123, -62},
+    {-68, 23, -66, -75, 19, -73, -119, -54},
+    {-74, -50, 13, -81, -57, 8, -119, -78},
+    {21, -59, -70, 17, -67, -79, -118, -108},
+    {-62, 21, -69, -69, 17, -77, -119, -101},
+    {-72, -54, 21, -82, -63, 15, -116, -128},
+    {8, -52, -60, 2, -61, -70, -116, -28},
+    {-58, 12, -61, -67, 7, -69, -117, -19},
+    {-59, -48, 8, -71, -59, 1, -113, -40},
+    {-40, -41, -38, -43, -45, -41, -123, -38},
+    {64, 64, 64, -43, -43, -43, 32, -63},
+    {102, -116, -116, 102, -116, -116, -128, -104},
+};
+constexpr uint16_t sample_forest_scores[][2] = {
+    {2, 1},
+    {2, 1},
+    {2, 1},
+    {1, 2},
+    {2, 1},
+    {1, 2},
+    {1, 2},
+    {2, 1},
+    {1, 2},
+    {2, 1},
+    {2, 1},
+    {1, 2},
+    {1, 2},
+    {1, 2},
+    {2, 1},
+    {2, 1},
+};
+constexpr uint8_t sample_forest_expected[] = {
+    0, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 1, 1, 0, 0,
+};
+
+}  // namespace color_model
+#endif
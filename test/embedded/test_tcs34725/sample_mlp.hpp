@@ -0,0 +1,103 @@
+/*
+ * Generated by tools/color_model_export.py. Do not edit.
+ */
+#ifndef M5_UNIT_COLOR_MODEL_SAMPLE_MLP_HPP
+#define M5_UNIT_COLOR_MODEL_SAMPLE_MLP_HPP
+
+#include <utility/unit_color_inference.hpp>
+
+namespace color_model {
+
+// Classes: 0:red, 1:green, 2:blue
+constexpr size_t sample_mlp_classes{3};
+
+constexpr int8_t sample_mlp_w1[] = {
+    0, 0, 0, 127, -32, -32, 0, 0,
+    0, 0, 0, -32, 127, -32, 0, 0,
+    0, 0, 0, -32, -32, 127, 0, 0,
+    64, -16, -16, 0, 0, 0, -16, 0,
+    -16, 64, -16, 0, 0, 0, -16, 0,
+    -16, -16, 64, 0, 0, 0, -16, 0,
+};
+
+constexpr int32_t sample_mlp_b1[] = {
+    4000, 4000, 4000, 2861, 2861, 2861,
+};
+
+constexpr int8_t sample_mlp_w2[] = {
+    127, -42, -42, 85, -25, -25,
+    -42, 127, -42, -25, 85, -25,
+    -42, -42, 127, -25, -25, 85,
+};
+
+constexpr int32_t sample_mlp_b2[] = {
+    0, 179, -179,
+};
+
+constexpr m5::unit::tcs3472x::inference::QuantizedMLP<8, 6, 3> sample_mlp{
+    sample_mlp_w1, sample_mlp_b1, 21845, 22, sample_mlp_w2, sample_mlp_b2};
+
+static_assert(sizeof(sample_mlp_w1) == 48 && sizeof(sample_mlp_b1) / sizeof(int32_t) == 6, "Hidden layer size");
+static_assert(sizeof(sample_mlp_w2) == 18 && sizeof(sample_mlp_b2) / sizeof(int32_t) == 3, "Output layer size");
+
+// Reference samples {C, R, G, B, ATIME, GAIN}, and their features, scores and classes (bit-exact)
+constexpr uint16_t sample_mlp_samples[][6] = {
+    {0, 0, 0, 0, 0, 1},
+    {65535, 65535, 65535, 65535, 0, 1},
+    {4000, 1000, 2000, 1500, 0, 1},
+    {48815, 4660, 22136, 39612, 0, 1},
+    {12000, 7000, 3000, 2500, 0, 1},
+    {11000, 2600, 6500, 2700, 0, 1},
+    {9800, 2100, 3000, 5400, 0, 1},
+    {700, 410, 190, 160, 192, 3},
+    {650, 170, 380, 150, 192, 3},
+    {720, 160, 210, 420, 192, 3},
+    {30000, 16000, 9000, 8000, 128, 0},
+    {31000, 8500, 17000, 8200, 128, 0},
+    {29000, 7900, 9100, 15500, 128, 0},
+    {1500, 520, 510, 530, 255, 2},
+    {20000, 15000, 15000, 15000, 64, 1},
+    {100, 90, 5, 5, 0, 0},
+};
+constexpr int8_t sample_mlp_features[][8] = {
+    {-128, -128, -128, -128, -128, -128, -128, -128},
+    {127, 127, 127, -128, -128, -128, 127, -128},
+    {-64, 0, -32, -77, -9, -43, -112, -70},
+    {-104, -12, 79, -128, -43, 69, -82, -128},
+    {21, -64, -75, 19, -69, -79, -123, -62},
+    {-68, 23, -66, -75, 19, -73, -119, -54},
+    {-74, -50, 13, -81, -57, 8, -119, -78},
+    {21, -59, -70, 17, -67, -79, -118, -108},
+    {-62, 21, -69, -69, 17, -77, -119, -101},
+    {-72, -54, 21, -82, -63, 15, -116, -128},
+    {8, -52, -60, 2, -61, -70, -116, -28},
+    {-58, 12, -61, -67, 7, -69, -117, -19},
+    {-59, -48, 8, -71, -59, 1, -113, -40},
+    {-40, -41, -38, -43, -45, -41, -123, -38},
+    {64, 64, 64, -43, -43, -43, 32, -63},
+    {102, -116, -116, 102, -116, -116, -128, -104},
+};
+constexpr int32_t sample_mlp_scores[][3] = {
+    {140, 319, -39},
+    {875, 1054, 696},
+    {-2529, 6425, -95},
+    {-6024, -3307, 16232},
+    {10806, -2777, -3575},
+    {-3201, 10960, -3270},
+    {-3103, -1824, 8959},
+    {10332, -2583, -3381},
+    {-2872, 10621, -3381},
+    {-3380, -2321, 10026},
+    {8233, -1774, -2572},
+    {-2426, 9165, -2715},
+    {-2351, -1622, 7817},
+    {948, 789, 1048},
+    {1106, 1285, 927},
+    {22844, -7130, -7488},
+};
+constexpr uint8_t sample_mlp_expected[] = {
+    1, 1, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 2, 1, 0,
+};
+
+}  // namespace color_model
+#endif
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Simulated sensor for sweep::run() (test only, not a part of the library)
+*/
+#include "sweep_simulator.hpp"
+#include <M5Utility.hpp>
+#include <algorithm>
+
+namespace {
+constexpr float gain_table[4] = {1.0f, 4.0f, 16.0f, 60.0f};
+
+inline uint16_t saturate16(const float v)
+{
+    return static_cast<uint16_t>(std::fmin(std::fmax(std::round(v), 0.0f), 65535.0f));
+}
+
+}  // namespace
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace sweep {
+
+bool Simulator::measure(Data* out, const size_t num, const Exposure& e)
+{
+    if (!out || !num) {
+        return false;
+    }
+    const uint32_t changed = (e.gain != _current.gain) + (e.atime != _current.atime);
+    _current               = e;
+    _bus_bytes += changed * SETTING_BYTES;
+    _now_us += changed * SETTING_BYTES * BUS_US_PER_BYTE;
+
+    const float atime_ms = atime_to_ms(e.atime);
+    const float gain     = gain_table[m5::stl::to_underlying(e.gain)];
+    const float scale    = atime_ms * gain;
+    const uint16_t sat   = calculateSaturation(e.atime);
+
+    for (size_t i = 0; i < num; ++i) {
+        out[i] = Data{};
+        for (uint_fast8_t ch = 0; ch < 4; ++ch) {
+            const float expected   = _rate[ch] * scale;
+            // Photo-electrons are amplified by the gain, so the shot noise variance is gain * counts
+            const float v          = expected + std::sqrt(expected * gain) * gaussian() + _read_noise * gaussian();
+            const uint16_t raw     = std::min(saturate16(v), sat);
+            out[i].raw[ch * 2]     = raw & 0xFF;
+            out[i].raw[ch * 2 + 1] = raw >> 8;
+        }
+        out[i].gain  = e.gain;
+        out[i].atime = e.atime;
+        _bus_bytes += SAMPLE_BYTES;
+        _now_us += static_cast<uint32_t>(atime_ms * 1000.0f) + SAMPLE_BYTES * BUS_US_PER_BYTE;
+    }
+    return true;
+}
+
+float Simulator::gaussian()
+{
+    // Box-Muller on xorshift32
+    auto next = [this]() {
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        return (_seed >> 8) * (1.0f / 16777216.0f);
+    };
+    const float u1 = std::fmax(next(), 1.0f / 16777216.0f);
+    const float u2 = next();
+    return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+}
+
+}  // namespace sweep
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Simulated sensor for sweep::run() (test only, not a part of the library)
+*/
+#ifndef M5_UNIT_COLOR_TEST_SWEEP_SIMULATOR_HPP
+#define M5_UNIT_COLOR_TEST_SWEEP_SIMULATOR_HPP
+
+#include <utility/unit_color_sweep.hpp>
+
+namespace m5 {
+namespace unit {
+namespace tcs3472x {
+namespace sweep {
+
+/*!
+  @class Simulator
+  @brief Simulated sensor for the tests
+  @details Shot noise (Gaussian approximation of Poisson) and read noise on a fixed target,
+  with analog/ripple saturation, integration timing and bus cost modeled on the driver.
+  Deterministic for the seed
+ */
+class Simulator {
+public:
+    /*!
+      @param c Clear counts per ms at x1 gain
+      @param r Red counts per ms at x1 gain
+      @param g Green counts per ms at x1 gain
+      @param b Blue counts per ms at x1 gain
+      @param read_noise Read noise (stddev counts)
+      @param seed Seed of the noise
+     */
+    Simulator(const float c, const float r, const float g, const float b, const float read_noise = 1.0f,
+              const uint32_t seed = 1)
+        : _rate{c, r, g, b}, _read_noise{read_noise}, _seed{seed ? seed : 1}
+    {
+    }
+
+    bool measure(Data* out, const size_t num, const Exposure& e);
+    inline uint32_t now_us() const
+    {
+        return _now_us;
+    }
+    inline uint32_t bus_bytes() const
+    {
+        return _bus_bytes;
+    }
+
+    ///@name Cost model
+    ///@{
+    static constexpr uint32_t BUS_US_PER_BYTE{90};          //!< 100kHz I2C (address + data + ACK)
+    static constexpr uint32_t SETTING_BYTES{2};             //!< Per changed register
+    static constexpr uint32_t SAMPLE_BYTES{2 + 2 + 2 + 9};  //!< ENABLE idle/run, STATUS, result burst
+    ///@}
+
+protected:
+    float gaussian();
+
+private:
+    float _rate[4]{};
+    float _read_noise{};
+    uint32_t _seed{};
+    uint32_t _now_us{}, _bus_bytes{};
+    Exposure _current{};
+};
+
+}  // namespace sweep
+}  // namespace tcs3472x
+}  // namespace unit
+}  // namespace m5
+#endif
@@ -14,8 +14,27 @@
 #include <googletest/test_helper.hpp>
 #include <unit/unit_TCS3472x.hpp>
 #include <utility/unit_color_utility.hpp>
+#include <utility/unit_color_inference.hpp>
+#include <utility/unit_color_trace.hpp>
+#include <utility/unit_color_pipeline.hpp>
+#include <utility/unit_color_sweep.hpp>
+#include <utility/unit_color_uncertainty.hpp>
+#include <utility/unit_color_marker.hpp>
+#include <utility/unit_color_spc.hpp>
+#include <utility/unit_color_calibrator.hpp>
+#include <utility/unit_color_hotswap.hpp>
+#include <utility/unit_color_memo.hpp>
+#include <utility/unit_color_crosscore.hpp>
+#include <utility/unit_color_array.hpp>
+#include <unit/unit_TCS3472x_register.hpp>
+#include "sample_mlp.hpp"
+#include "sample_forest.hpp"
+#include "sweep_simulator.hpp"
+#include "marker_tape.hpp"
 #include <esp_random.h>
 #include <cmath>
+#include <vector>
+#include <random>
 
 using namespace m5::unit::googletest;
 using namespace m5::unit;
@@ -452,11 +471,559 @@ TEST_F(TestTCS34725, Singleshot)
         uint32_t cnt{2};
         while (cnt--) {
             EXPECT_TRUE(unit->measureSingleshot(d, gc, at[idx]));
+            EXPECT_EQ(d.gain, gc);
+            EXPECT_EQ(d.atime, ms_to_atime(at[idx]));
+            EXPECT_FALSE(d.hasFlag(Flag::SaturationRecovered));
             // M5_LOGW("GC:%u %.2f [%u]:(%x,%x,%x,%x) %x", gc, at[idx], cnt, d.R16(), d.G16(), d.B16(), d.C16(),
             //         d.RGB565());
         }
         ++idx;
     }
+
+    // Saturation recovery
+    unit->saturationRecovery(true);
+    EXPECT_TRUE(unit->saturationRecovery());
+    EXPECT_TRUE(unit->measureSingleshot(d, Gain::Controlx60, 614.4f));
+    if (d.hasFlag(Flag::SaturationRecovered)) {
+        EXPECT_EQ(d.gain, Gain::Controlx16);
+        Gain g{};
+        EXPECT_TRUE(unit->readGain(g));
+        EXPECT_EQ(g, Gain::Controlx16);
+    } else {
+        EXPECT_LT(d.C16(), calculateSaturation(614.4f));
+    }
+    unit->saturationRecovery(false);
+}
+
+TEST_F(TestTCS34725, SingleshotSequence)
+{
+    SCOPED_TRACE(ustr);
+
+    std::array<Data, 4> out{};
+    const std::array<Exposure, 4> bracket{{
+        {Gain::Controlx1, ms_to_atime(24.f)},
+        {Gain::Controlx4, ms_to_atime(24.f)},
+        {Gain::Controlx16, ms_to_atime(50.f)},
+        {Gain::Controlx60, ms_to_atime(50.f)},
+    }};
+
+    EXPECT_TRUE(unit->inPeriodic());
+    EXPECT_FALSE(unit->measureSingleshotSequence(out, bracket));
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+
+    auto start_at = m5::utility::millis();
+    EXPECT_TRUE(unit->measureSingleshotSequence(out, bracket));
+    auto elapsed = m5::utility::millis() - start_at;
+    M5_LOGI("Bracket:%lu ms", (unsigned long)elapsed);
+    // Sum of the integration times + PON + bus
+    EXPECT_LE(elapsed, 24 + 24 + 50 + 50 + 3 + 20);
+
+    for (size_t i = 0; i < out.size(); ++i) {
+        EXPECT_EQ(out[i].gain, bracket[i].gain) << i;
+        EXPECT_EQ(out[i].atime, bracket[i].atime) << i;
+    }
+    // Higher gain, same ATIME => larger counts
+    EXPECT_LE(out[0].C16(), out[1].C16());
+    EXPECT_LE(out[2].C16(), out[3].C16());
+
+    // Last exposure remains
+    Gain gc{};
+    uint8_t at{};
+    EXPECT_TRUE(unit->readGain(gc));
+    EXPECT_TRUE(unit->readAtime(at));
+    EXPECT_EQ(gc, bracket[3].gain);
+    EXPECT_EQ(at, bracket[3].atime);
+}
+
+TEST_F(TestTCS34725, DerivedConstants)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    EXPECT_TRUE(unit->writeGain(Gain::Controlx16));
+    EXPECT_TRUE(unit->writeAtime(24.f));
+    EXPECT_TRUE(unit->writeWtime(2.4f));
+
+    auto& k = unit->derived();
+    EXPECT_EQ(k.gain, Gain::Controlx16);
+    EXPECT_EQ(k.atime, ms_to_atime(24.f));
+    EXPECT_FLOAT_EQ(k.atime_ms, 24.f);
+    EXPECT_FLOAT_EQ(k.interval_ms, 24.f + 2.4f);
+    EXPECT_EQ(k.saturation, calculateSaturation(k.atime));
+    EXPECT_FLOAT_EQ(k.cpl, calculateCPL(24.f, Gain::Controlx16));
+
+    // Follows the setting changes
+    EXPECT_TRUE(unit->writeGain(Gain::Controlx1));
+    EXPECT_EQ(k.gain, Gain::Controlx1);
+    EXPECT_FLOAT_EQ(k.cpl, calculateCPL(24.f, Gain::Controlx1));
+}
+
+TEST_F(TestTCS34725, Resilience)
+{
+    SCOPED_TRACE(ustr);
+
+    unit->resetStatistics();
+    auto& s = unit->statistics();
+    EXPECT_EQ(s.errors, 0U);
+    EXPECT_EQ(s.retries, 0U);
+    EXPECT_EQ(s.missed, 0U);
+    EXPECT_EQ(s.recoveries, 0U);
+
+    // Matches the shadow
+    EXPECT_TRUE(unit->synchronize());
+    EXPECT_EQ(s.recoveries, 0U);
+
+    constexpr uint8_t CMD{0x80};  // Command bit
+    const uint8_t atime = unit->derived().atime;
+    uint8_t v{};
+
+    // ATIME changed behind the driver is restored
+    EXPECT_TRUE(unit->writeRegister8(CMD | command::ATIME_REG, static_cast<uint8_t>(atime ^ 0x10)));
+    EXPECT_TRUE(unit->synchronize());
+    EXPECT_EQ(s.recoveries, 1U);
+    EXPECT_TRUE(unit->readRegister8(CMD | command::ATIME_REG, v, 0));
+    EXPECT_EQ(v, atime);
+
+    // Power-on defaults behind the driver (reset) restore the whole configuration
+    EXPECT_TRUE(unit->writeRegister8(CMD | command::ENABLE_REG, 0x00));
+    EXPECT_TRUE(unit->writeRegister8(CMD | command::ATIME_REG, 0xFF));
+    EXPECT_TRUE(unit->synchronize());
+    EXPECT_EQ(s.recoveries, 2U);
+    EXPECT_TRUE(unit->readRegister8(CMD | command::ENABLE_REG, v, 0));
+    EXPECT_EQ(v & 0x03, 0x03);  // PON, AEN
+    EXPECT_TRUE(unit->readRegister8(CMD | command::ATIME_REG, v, 0));
+    EXPECT_EQ(v, atime);
+    EXPECT_TRUE(unit->inPeriodic());
+
+    // Periodic measurement continues after synchronize
+    uint32_t cnt{3};
+    auto timeout_at = m5::utility::millis() + 10 * 1000;
+    while (cnt && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        if (unit->updated()) {
+            --cnt;
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(cnt, 0U);
+    EXPECT_EQ(s.errors, 0U);
+}
+
+TEST_F(TestTCS34725, Sweep)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    unit->resetStatistics();
+
+    const uint8_t atimes[] = {ms_to_atime(2.4f), ms_to_atime(24.f)};
+    sweep::Entry table[sweep::NUMBER_OF_GAINS * 2]{};
+    sweep::UnitSensor sensor{*unit};
+    EXPECT_EQ(sweep::run(sensor, atimes, 2, 4, table, 8), 8U);
+
+    for (auto&& e : table) {
+        M5_LOGI("G:%u A:%02X mean:%u noise:%u/16 margin:%u rate:%.1f bus:%u", m5::stl::to_underlying(e.gain), e.atime,
+                e.mean, e.noise, e.margin, e.rate(), e.bus);
+        EXPECT_GT(e.period, 0U);
+        EXPECT_GT(e.bus, 0U);
+    }
+    EXPECT_GT(unit->statistics().bytes, 0U);
+    EXPECT_EQ(unit->statistics().errors, 0U);
+    // Longer ATIME, lower rate
+    EXPECT_GT(table[0].rate(), table[1].rate());
+}
+
+TEST_F(TestTCS34725, ExternalTrigger)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_FALSE(unit->startTriggerMode(Gain::Controlx4, ms_to_atime(24.f)));  // In periodic
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    EXPECT_TRUE(unit->startTriggerMode(Gain::Controlx4, ms_to_atime(24.f)));
+    EXPECT_TRUE(unit->inTriggerMode());
+    EXPECT_FALSE(unit->startPeriodicMeasurement());
+    Data d{};
+    EXPECT_FALSE(unit->measureSingleshot(d));
+
+    unit->resetTriggerStatistics();
+    constexpr uint32_t count{5};
+    for (uint32_t i = 0; i < count; ++i) {
+        unit->notifyTrigger(m5::utility::micros());
+        unit->notifyTrigger(m5::utility::micros());  // Dropped
+        auto timeout_at = m5::utility::millis() + 1000;
+        while (unit->availableTriggered() <= i && m5::utility::millis() <= timeout_at) {
+            unit->update();
+        }
+        EXPECT_EQ(unit->availableTriggered(), i + 1);
+    }
+
+    TriggerResult r{};
+    uint32_t cnt{};
+    while (unit->popTriggered(r)) {
+        EXPECT_EQ(r.data.gain, Gain::Controlx4);
+        EXPECT_EQ(r.data.atime, ms_to_atime(24.f));
+        EXPECT_LE(r.dispatch_us, r.latency_us);
+        EXPECT_LE(r.latency_us, unit->triggerLatencyBound());
+        ++cnt;
+    }
+    EXPECT_EQ(cnt, count);
+
+    auto s = unit->triggerStatistics();
+    M5_LOGI("Latency min:%u max:%u avg:%u bound:%u", s.min_us, s.max_us, s.average(), unit->triggerLatencyBound());
+    EXPECT_EQ(s.measured, count);
+    EXPECT_EQ(s.dropped, count);
+    EXPECT_EQ(s.failed, 0U);
+    EXPECT_EQ(s.over_bound, 0U);
+    // At least RGBC init and ATIME
+    EXPECT_GE(s.min_us, 2400U + 24000U);
+
+    EXPECT_TRUE(unit->stopTriggerMode());
+    EXPECT_FALSE(unit->inTriggerMode());
+
+    // Interrupt settings of the user survive the mode using the interrupt
+    Persistence pers{};
+    bool aien{};
+    EXPECT_TRUE(unit->writePersistence(Persistence::Cycle5));
+    EXPECT_TRUE(unit->writeInterrupt(true));
+    EXPECT_TRUE(unit->startTriggerMode(Gain::Controlx4, ms_to_atime(24.f), true));
+    EXPECT_TRUE(unit->readPersistence(pers));
+    EXPECT_EQ(pers, Persistence::Every);
+    EXPECT_TRUE(unit->stopTriggerMode());
+    EXPECT_TRUE(unit->readPersistence(pers));
+    EXPECT_TRUE(unit->readInterrupt(aien));
+    EXPECT_EQ(pers, Persistence::Cycle5);
+    EXPECT_TRUE(aien);
+
+    EXPECT_TRUE(unit->writeInterrupt(false));
+    EXPECT_TRUE(unit->writePersistence(Persistence::Every));
+}
+
+TEST_F(TestTCS34725, Streams)
+{
+    SCOPED_TRACE(ustr);
+
+    unit->clearStreams();
+    const int8_t raw  = unit->addStream(1, Aggregation::Last);
+    const int8_t mean = unit->addStream(4, Aggregation::Mean);
+    const int8_t max  = unit->addStream(8, Aggregation::Max);
+    EXPECT_EQ(raw, 0);
+    EXPECT_EQ(mean, 1);
+    EXPECT_EQ(max, 2);
+    EXPECT_EQ(unit->addStream(0, Aggregation::Mean), -1);
+    EXPECT_EQ(unit->addStream(2, Aggregation::Min), 3);
+    EXPECT_EQ(unit->addStream(2, Aggregation::Min), -1);  // Full
+
+    uint32_t cnt{8};
+    auto timeout_at = m5::utility::millis() + 10 * 1000;
+    while (cnt && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        if (unit->updated()) {
+            --cnt;
+            // Full rate stream follows every measurement
+            EXPECT_TRUE(unit->streamUpdated(raw));
+            EXPECT_EQ(unit->streamData(raw).C16(), unit->latest().C16());
+        } else {
+            EXPECT_FALSE(unit->streamUpdated(raw));
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(cnt, 0U);
+    EXPECT_EQ(unit->streamCount(raw), 8U);
+    EXPECT_EQ(unit->streamCount(mean), 2U);
+    EXPECT_EQ(unit->streamCount(max), 1U);
+    EXPECT_GE(unit->streamData(max).C16(), unit->streamData(mean).C16());
+
+    unit->clearStreams();
+    EXPECT_EQ(unit->streamCount(raw), 0U);
+}
+
+TEST_F(TestTCS34725, GainTable)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_FALSE(unit->setGainTable(GainTable{{1.0f, 4.0f, 3.0f, 60.0f}}));  // Not increasing
+    EXPECT_FALSE(unit->setGainTable(GainTable{{0.0f, 4.0f, 16.0f, 60.0f}}));
+
+    GainTable gt{};
+    EXPECT_FALSE(unit->calibrateGainTable(gt));  // In periodic
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    EXPECT_FALSE(unit->calibrateGainTable(gt, 0xF6, 0));
+
+    // Depends on the ambient light (about 100 - 1000 counts at x1 with the default ATIME)
+    if (!unit->calibrateGainTable(gt)) {
+        GTEST_SKIP() << "The source is too dark or too bright for the default ATIME";
+    }
+    M5_LOGI("Gains: %f %f %f %f", gt[0], gt[1], gt[2], gt[3]);
+    for (size_t i = 0; i < gt.size(); ++i) {
+        EXPECT_NEAR(gt[i], NOMINAL_GAINS[i], NOMINAL_GAINS[i] * 0.2f) << i;
+    }
+    const float cpl = unit->derived().cpl;
+    EXPECT_TRUE(unit->setGainTable(gt));
+    EXPECT_EQ(unit->gainTable()[3], gt[3]);
+    EXPECT_FLOAT_EQ(unit->derived().cpl, calculateCPL(unit->derived().atime_ms, unit->derived().gain, DGF, gt));
+    EXPECT_TRUE(unit->setGainTable(NOMINAL_GAINS));
+    EXPECT_FLOAT_EQ(unit->derived().cpl, cpl);
+}
+
+TEST_F(TestTCS34725, DriftMonitor)
+{
+    SCOPED_TRACE(ustr);
+
+    spc::ChartConfig cfg{};
+    cfg.baseline = 4;
+    spc::Monitor monitor(cfg, cfg);
+    unit->setDriftMonitor(&monitor);
+    EXPECT_EQ(unit->driftMonitor(), &monitor);
+
+    uint32_t cnt{8};
+    auto timeout_at = m5::utility::millis() + 10 * 1000;
+    while (cnt && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        if (unit->updated()) {
+            --cnt;
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(cnt, 0U);
+    // Learned from the first 4, monitored the rest (unless saturated)
+    if (!monitor.ignored()) {
+        EXPECT_TRUE(monitor.armed());
+        EXPECT_EQ(monitor.lux().count(), 4U);
+        EXPECT_EQ(monitor.chromaR().count(), 4U);
+        EXPECT_GT(monitor.chromaR().target(), 0.0f);
+        EXPECT_LT(monitor.chromaR().target(), 1.0f);
+    }
+
+    unit->setDriftMonitor(nullptr);
+    const auto total = monitor.lux().count() + monitor.ignored();
+    cnt              = 2;
+    timeout_at       = m5::utility::millis() + 10 * 1000;
+    while (cnt && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        if (unit->updated()) {
+            --cnt;
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(monitor.lux().count() + monitor.ignored(), total);
+
+    // Clear only measurements are ignored, not monitored as drift
+    monitor.acknowledge();
+    unit->setDriftMonitor(&monitor);
+    unit->channelMask(m5::stl::to_underlying(Channel::Clear));
+    const auto monitored = monitor.lux().count();
+    const auto ignored   = monitor.ignored();
+    cnt                  = 4;
+    timeout_at           = m5::utility::millis() + 10 * 1000;
+    while (cnt && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        if (unit->updated()) {
+            --cnt;
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(cnt, 0U);
+    EXPECT_EQ(monitor.lux().count(), monitored);
+    EXPECT_EQ(monitor.ignored(), ignored + 4);
+    EXPECT_FALSE(monitor.alarmed());
+
+    unit->channelMask(CHANNEL_ALL);
+    unit->setDriftMonitor(nullptr);
+}
+
+TEST_F(TestTCS34725, SleepResume)
+{
+    SCOPED_TRACE(ustr);
+
+    RetainedState state{};
+    EXPECT_FALSE(state.valid());
+    EXPECT_FALSE(unit->resumeFrom(state));
+
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    EXPECT_FALSE(unit->prepareSleep(state, 100, 5000, Persistence::Cycle5));  // Not in periodic
+    EXPECT_TRUE(unit->startPeriodicMeasurement(Gain::Controlx16, 24.f, 2.4f));
+    EXPECT_TRUE(unit->prepareSleep(state, 100, 5000, Persistence::Cycle5));
+    EXPECT_TRUE(state.valid());
+
+    uint16_t low{}, high{};
+    Persistence pers{};
+    bool aien{};
+    EXPECT_TRUE(unit->readInterruptThreshold(low, high));
+    EXPECT_TRUE(unit->readPersistence(pers));
+    EXPECT_TRUE(unit->readInterrupt(aien));
+    EXPECT_EQ(low, 100U);
+    EXPECT_EQ(high, 5000U);
+    EXPECT_EQ(pers, Persistence::Cycle5);
+    EXPECT_TRUE(aien);
+
+    // Corrupted state is rejected
+    auto bad = state;
+    bad.shadow[0] ^= 0x01;
+    EXPECT_FALSE(unit->resumeFrom(bad));
+
+    // begin() resumes without any bus access
+    EXPECT_TRUE(unit->resumeFrom(state));
+    const auto tx = unit->statistics().transactions;
+    EXPECT_TRUE(unit->begin());
+    EXPECT_TRUE(unit->resumed());
+    EXPECT_TRUE(unit->inPeriodic());
+    EXPECT_EQ(unit->statistics().transactions, tx);
+    EXPECT_EQ(unit->derived().gain, Gain::Controlx16);
+    EXPECT_EQ(unit->derived().atime, ms_to_atime(24.f));
+
+    // First sample in a single read
+    m5::utility::delay(30);
+    unit->update();
+    EXPECT_TRUE(unit->updated());
+    EXPECT_EQ(unit->statistics().transactions, tx + 1);
+    EXPECT_EQ(unit->latest().gain, Gain::Controlx16);
+
+    // Power lost during the sleep
+    constexpr uint8_t CMD{0x80};  // Command bit
+    EXPECT_TRUE(unit->resumeFrom(state));
+    EXPECT_TRUE(unit->begin());
+    EXPECT_TRUE(unit->resumed());
+    EXPECT_TRUE(unit->writeRegister8(CMD | command::ENABLE_REG, 0x00));
+    const auto recoveries = unit->statistics().recoveries;
+    auto timeout_at       = m5::utility::millis() + 1000;
+    do {
+        m5::utility::delay(1);
+        unit->update();
+    } while (!unit->updated() && m5::utility::millis() <= timeout_at);
+    EXPECT_TRUE(unit->updated());
+    EXPECT_GT(unit->statistics().recoveries, recoveries);
+    EXPECT_EQ(unit->latest().gain, Gain::Controlx16);
+    uint8_t enable{};
+    EXPECT_TRUE(unit->readRegister8(CMD | command::ENABLE_REG, enable, 0));
+    EXPECT_EQ(enable, state.shadow[command::ENABLE_REG]);
+
+    EXPECT_TRUE(unit->writeInterrupt(false));
+    EXPECT_TRUE(unit->clearInterrupt());
+}
+
+TEST_F(TestTCS34725, CrossCore)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_TRUE(unit->inPeriodic());
+
+    // Acquisition on the core of the bus, heavy processing on the other
+    crosscore::Acquisition<16> acq{*unit};
+    auto heavy = [](const Data& d) {
+        m5::utility::delay(5);
+        return calculateLux(d.R16(), d.G16(), d.B16(), d.C16(), atime_to_ms(d.atime), d.gain);
+    };
+    crosscore::Stage<Data, decltype(heavy), 16> stage{acq.output(), heavy, 4};
+
+    crosscore::Task acqTask{}, procTask{};
+    const int core = xPortGetCoreID();
+    EXPECT_TRUE(acqTask.start(acq, "acq", core));
+    EXPECT_TRUE(procTask.start(stage, "proc", core ^ 1));
+    EXPECT_TRUE(acqTask.running());
+    EXPECT_FALSE(acqTask.start(acq, "acq", core));
+
+    uint32_t received{};
+    auto timeout_at = m5::utility::millis() + 1000;
+    while (m5::utility::millis() <= timeout_at) {
+        float lux{};
+        while (stage.output().pop(lux)) {
+            ++received;
+        }
+        m5::utility::delay(10);
+    }
+    acqTask.stop();
+    procTask.stop();
+    EXPECT_FALSE(acqTask.running());
+    float lux{};
+    while (stage.output().pop(lux)) {
+        ++received;
+    }
+
+    const auto& am = acq.metrics();
+    const auto& sm = stage.metrics();
+    M5_LOGI("Acquisition: %u samples, max %u us, dropped %u", am.items, am.max_us, am.dropped);
+    M5_LOGI("Stage: %u items/%u batches, avg %.1f us, max backlog %u", sm.items, sm.batches, sm.averageUs(),
+            sm.max_backlog);
+    EXPECT_GT(am.items, 0U);
+    // Processing cost is not in the acquisition
+    EXPECT_LT(am.max_us, 5000U);
+    EXPECT_EQ(am.items, sm.items + acq.output().size());
+    EXPECT_EQ(received, sm.items);
+}
+
+TEST_F(TestTCS34725, SensorArray)
+{
+    SCOPED_TRACE(ustr);
+
+    soa::SensorArray<4> sensors{};
+    EXPECT_TRUE(sensors.add(*unit));
+    EXPECT_EQ(sensors.size(), 1U);
+    EXPECT_FALSE(sensors.setMatrix(1, soa::IDENTITY));
+
+    uint32_t updated{};
+    auto timeout_at = m5::utility::millis() + 10 * 1000;
+    while (!updated && m5::utility::millis() <= timeout_at) {
+        unit->update();
+        updated = sensors.collect();
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(updated, 1U);
+    EXPECT_EQ(sensors.present(), 1U);
+    sensors.process();
+    EXPECT_EQ(sensors.rawC()[0], unit->latest().C16());
+    EXPECT_FLOAT_EQ(sensors.lux()[0], calculateLux(unit->latest(), unit->derived()));
+    EXPECT_EQ(sensors.classes()[0], soa::UNKNOWN);  // No palette
+    EXPECT_EQ(sensors.frames(), 1U);
+}
+
+TEST_F(TestTCS34725, ChannelMask)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+
+    Data d{};
+    // Clear only
+    unit->channelMask(m5::stl::to_underlying(Channel::Clear));
+    EXPECT_EQ(unit->channelMask(), m5::stl::to_underlying(Channel::Clear));
+    EXPECT_TRUE(unit->measureSingleshot(d, Gain::Controlx4, 24.f));
+    EXPECT_TRUE(d.hasFlag(Flag::Partial));
+    EXPECT_EQ(d.channels, m5::stl::to_underlying(Channel::Clear));
+    EXPECT_EQ(d.R16(), 0);
+    EXPECT_EQ(d.G16(), 0);
+    EXPECT_EQ(d.B16(), 0);
+
+    // Full read first, then reuse d: unread channels, flags and the IR cache must not be left over
+    unit->channelMask(CHANNEL_ALL);
+    EXPECT_TRUE(unit->measureSingleshot(d));
+    EXPECT_FALSE(d.hasFlag(Flag::Partial));
+    d.flags |= m5::stl::to_underlying(Flag::SaturationRecovered);
+    (void)d.IR();  // Fill the cache
+    unit->channelMask(m5::stl::to_underlying(Channel::Clear));
+    EXPECT_TRUE(unit->measureSingleshot(d));
+    EXPECT_TRUE(d.hasFlag(Flag::Partial));
+    EXPECT_FALSE(d.hasFlag(Flag::SaturationRecovered));
+    EXPECT_EQ(d.R16(), 0);
+    EXPECT_EQ(d.G16(), 0);
+    EXPECT_EQ(d.B16(), 0);
+    EXPECT_EQ(d.IR(), -static_cast<int32_t>(d.C16()) / 2);
+
+    // Clear and Green => C,R,G are read
+    unit->channelMask(Channel::Clear | Channel::Green);
+    EXPECT_TRUE(unit->measureSingleshot(d));
+    EXPECT_TRUE(d.hasFlag(Flag::Partial));
+    EXPECT_EQ(d.channels, Channel::Clear | Channel::Red | Channel::Green);
+    EXPECT_EQ(d.B16(), 0);
+
+    // Clear and Blue => all
+    unit->channelMask(Channel::Clear | Channel::Blue);
+    EXPECT_TRUE(unit->measureSingleshot(d));
+    EXPECT_FALSE(d.hasFlag(Flag::Partial));
+    EXPECT_EQ(d.channels, CHANNEL_ALL);
+
+    // 0 means all
+    unit->channelMask(0);
+    EXPECT_EQ(unit->channelMask(), CHANNEL_ALL);
 }
 
 TEST_F(TestTCS34725, Status)
@@ -513,6 +1080,106 @@ TEST_F(TestTCS34725NoPeriodic, BeginWithoutPeriodic)
     EXPECT_TRUE(unit->measureSingleshot(d));
 }
 
+// ============================================================
+// Test with bus faults
+// ============================================================
+
+namespace {
+// Unit that can be moved to an absent address, so that every transaction fails
+class FaultyTCS34725 : public UnitTCS34725 {
+public:
+    static constexpr uint8_t ABSENT_ADDRESS{0x08};
+
+    bool detach(const bool absent)
+    {
+        return changeAddress(absent ? ABSENT_ADDRESS : DEFAULT_ADDRESS);
+    }
+};
+}  // namespace
+
+class TestTCS34725Fault : public I2CComponentTestBase<FaultyTCS34725> {
+protected:
+    static constexpr uint32_t MAX_BACKOFF{32};
+
+    virtual FaultyTCS34725* get_instance() override
+    {
+        auto ptr         = new FaultyTCS34725();
+        auto ccfg        = ptr->component_config();
+        ccfg.stored_size = STORED_SIZE;
+        ptr->component_config(ccfg);
+
+        auto cfg        = ptr->config();
+        cfg.max_backoff = MAX_BACKOFF;
+        ptr->config(cfg);
+        return ptr;
+    }
+};
+
+TEST_F(TestTCS34725Fault, BusError)
+{
+    SCOPED_TRACE(ustr);
+
+    EXPECT_TRUE(unit->stopPeriodicMeasurement());
+    EXPECT_TRUE(unit->startPeriodicMeasurement(Gain::Controlx4, 24.f, 2.4f));
+    auto timeout_at = m5::utility::millis() + 1000;
+    do {
+        unit->update();
+        m5::utility::delay(1);
+    } while (!unit->updated() && m5::utility::millis() <= timeout_at);
+    ASSERT_TRUE(unit->updated());
+
+    unit->resetStatistics();
+    auto& s = unit->statistics();
+    ASSERT_TRUE(unit->detach(true));
+
+    // A failed transaction is retried, then counted as an error
+    Gain gain{};
+    EXPECT_FALSE(unit->readGain(gain));
+    EXPECT_EQ(s.retries, unit->config().retries);
+    EXPECT_EQ(s.errors, 1U);
+
+    // update() misses and backs off 2^n ms (up to max_backoff) between the attempts
+    unit->resetStatistics();
+    std::vector<uint32_t> missed_at{};
+    uint32_t missed{}, calls{};
+    auto start_at = m5::utility::millis();
+    while (m5::utility::millis() - start_at < 400) {
+        unit->update();
+        EXPECT_FALSE(unit->updated());
+        ++calls;
+        if (s.missed != missed) {
+            missed = s.missed;
+            missed_at.push_back(m5::utility::millis());
+        }
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(s.errors, s.missed);
+    EXPECT_EQ(s.retries, unit->config().retries);  // Only the first one (the others are synchronize())
+    EXPECT_LT(s.missed * 4, calls);
+    ASSERT_GE(missed_at.size(), 8U);
+    for (size_t i = 1; i < missed_at.size(); ++i) {
+        const uint32_t gap = missed_at[i] - missed_at[i - 1];
+        EXPECT_GE(gap, std::min<uint32_t>(1U << i, MAX_BACKOFF)) << "miss=" << i;
+        EXPECT_LE(gap, MAX_BACKOFF + 20) << "miss=" << i;
+    }
+
+    // Back on the bus, the measurement resumes and the misses stop
+    ASSERT_TRUE(unit->detach(false));
+    timeout_at = m5::utility::millis() + 1000;
+    do {
+        unit->update();
+        m5::utility::delay(1);
+    } while (!unit->updated() && m5::utility::millis() <= timeout_at);
+    EXPECT_TRUE(unit->updated());
+    missed = s.missed;
+    for (int i = 0; i < 100; ++i) {
+        unit->update();
+        m5::utility::delay(1);
+    }
+    EXPECT_EQ(s.missed, missed);
+    EXPECT_EQ(s.recoveries, 0U);  // Registers were not touched
+}
+
 // ============================================================
 // Pure computation tests (no hardware required)
 // ============================================================
@@ -605,6 +1272,14 @@ TEST(DataStruct, ColorConversions)
     EXPECT_EQ(Data::swap888(0x12, 0x34, 0x56), 0x00563412U);
 }
 
+TEST(DataStruct, Flags)
+{
+    Data d{};
+    EXPECT_FALSE(d.hasFlag(Flag::SaturationRecovered));
+    d.flags |= m5::stl::to_underlying(Flag::SaturationRecovered);
+    EXPECT_TRUE(d.hasFlag(Flag::SaturationRecovered));
+}
+
 TEST(DataStruct, ZeroClear)
 {
     // When C=0, R8/G8/B8 should return 0 (avoid division by zero)
@@ -686,6 +1361,39 @@ TEST(Utility, CalculateColorTemperature)
     EXPECT_TRUE(std::isnan(ct_nan));
 }
 
+TEST(Utility, DerivedConstants)
+{
+    for (uint32_t a = 0; a < 256; a += 5) {
+        for (uint8_t g = 0; g < 4; ++g) {
+            const uint8_t atime = static_cast<uint8_t>(a);
+            const Gain gc       = static_cast<Gain>(g);
+            auto k              = calculateDerivedConstants(atime, gc, 12.0f);
+            EXPECT_FLOAT_EQ(k.atime_ms, atime_to_ms(atime));
+            EXPECT_FLOAT_EQ(k.interval_ms, atime_to_ms(atime) + 12.0f);
+            EXPECT_EQ(k.saturation, calculateSaturation(atime));
+            EXPECT_FLOAT_EQ(k.cpl, calculateCPL(k.atime_ms, gc));
+            EXPECT_FLOAT_EQ(k.inv_cpl * k.cpl, 1.0f);
+            EXPECT_NEAR(k.max_lux, calculateMaxLux(k.atime_ms, gc), k.max_lux * 1e-5f);
+
+            auto d  = make_data(4000, 1000, 2000, 1500);
+            d.atime = atime;
+            d.gain  = gc;
+            EXPECT_NEAR(calculateLux(d, k), calculateLux(1000, 2000, 1500, 4000, k.atime_ms, gc),
+                        calculateLux(d, k) * 1e-5f);
+        }
+    }
+
+    // Settings of the data differ from the constants
+    auto k  = calculateDerivedConstants(0xF6, Gain::Controlx16);
+    auto d  = make_data(4000, 1000, 2000, 1500);
+    d.atime = 0xF6;
+    d.gain  = Gain::Controlx4;
+    EXPECT_FLOAT_EQ(calculateLux(d, k), calculateLux(1000, 2000, 1500, 4000, atime_to_ms(0xF6), Gain::Controlx4));
+
+    EXPECT_FLOAT_EQ(calculateColorTemperature(d), calculateColorTemperature(1000, 2000, 1500, 4000));
+    EXPECT_TRUE(std::isnan(calculateColorTemperature(make_data(500, 100, 1000, 1000))));
+}
+
 TEST(Utility, CalculateCRATIO)
 {
     // CRATIO = IR / C, clamped [0, 1]
@@ -789,3 +1497,1183 @@ TEST(Utility, GammaTable)
     EXPECT_EQ(table_25[255], 255);
     EXPECT_LT(table_25[128], table_22[128]);
 }
+
+// Inference (expected values are generated by tools/color_model_export.py)
+
+TEST(Inference, Log2Q3)
+{
+    using namespace m5::unit::tcs3472x::inference;
+    EXPECT_EQ(log2_q3(0), 0);
+    EXPECT_EQ(log2_q3(1), 0);
+    EXPECT_EQ(log2_q3(2), 8);
+    EXPECT_EQ(log2_q3(3), 12);
+    EXPECT_EQ(log2_q3(1024), 80);
+    EXPECT_EQ(log2_q3(1536), 84);
+}
+
+TEST(Inference, Features)
+{
+    using namespace m5::unit::tcs3472x::inference;
+    // R=1000, G=2000, B=1500, C=4000 => IR=250
+    auto f = extractFeatures(make_data(4000, 1000, 2000, 1500), 0, Gain::Controlx4);
+    EXPECT_EQ(f[m5::stl::to_underlying(Feature::RatioR)], (1000 * 256) / 4000 - 128);
+    EXPECT_EQ(f[m5::stl::to_underlying(Feature::RatioGnoIR)], (1750 * 256) / 3750 - 128);
+    EXPECT_EQ(f[m5::stl::to_underlying(Feature::CRATIO)], (250 * 256) / 4000 - 128);
+
+    // All zero
+    f = extractFeatures(Data{}, 0, Gain::Controlx1);
+    for (auto&& v : f) {
+        EXPECT_EQ(v, -128);
+    }
+}
+
+TEST(Inference, BitExactMLP)
+{
+    using namespace color_model;
+    constexpr size_t num = sizeof(sample_mlp_samples) / sizeof(sample_mlp_samples[0]);
+    for (size_t i = 0; i < num; ++i) {
+        auto& s = sample_mlp_samples[i];
+        auto f  = inference::extractFeatures(make_data(s[0], s[1], s[2], s[3]), s[4], static_cast<Gain>(s[5]));
+        for (size_t k = 0; k < f.size(); ++k) {
+            EXPECT_EQ(f[k], sample_mlp_features[i][k]) << "index=" << i << " feature=" << k;
+        }
+        std::array<int32_t, sample_mlp_classes> scores{};
+        sample_mlp.evaluate(f, scores);
+        for (size_t k = 0; k < scores.size(); ++k) {
+            EXPECT_EQ(scores[k], sample_mlp_scores[i][k]) << "index=" << i << " class=" << k;
+        }
+        EXPECT_EQ(sample_mlp.classify(f), sample_mlp_expected[i]) << "index=" << i;
+    }
+}
+
+TEST(Inference, BitExactForest)
+{
+    using namespace color_model;
+    constexpr size_t num = sizeof(sample_forest_samples) / sizeof(sample_forest_samples[0]);
+    for (size_t i = 0; i < num; ++i) {
+        auto& s = sample_forest_samples[i];
+        auto f  = inference::extractFeatures(make_data(s[0], s[1], s[2], s[3]), s[4], static_cast<Gain>(s[5]));
+        for (size_t k = 0; k < f.size(); ++k) {
+            EXPECT_EQ(f[k], sample_forest_features[i][k]) << "index=" << i << " feature=" << k;
+        }
+        std::array<uint16_t, sample_forest_classes> votes{};
+        sample_forest.evaluate(f, votes);
+        for (size_t k = 0; k < votes.size(); ++k) {
+            EXPECT_EQ(votes[k], sample_forest_scores[i][k]) << "index=" << i << " class=" << k;
+        }
+        EXPECT_EQ(sample_forest.classify(f), sample_forest_expected[i]) << "index=" << i;
+    }
+}
+
+TEST(Inference, MalformedForest)
+{
+    using inference::TreeNode;
+    static constexpr TreeNode good[] = {{0, 0, 1, 2}, {TreeNode::LEAF, 0, 0, 0}, {TreeNode::LEAF, 0, 1, 0}};
+    static constexpr uint16_t root[] = {0};
+    constexpr inference::DecisionForest<8, 2> ok{good, root, 1, 2, 3};
+    static_assert(ok.valid(), "Must be valid");
+
+    static constexpr TreeNode bad_feature[] = {{8, 0, 1, 2}, {TreeNode::LEAF, 0, 0, 0}, {TreeNode::LEAF, 0, 1, 0}};
+    static constexpr TreeNode bad_child[]   = {{0, 0, 1, 3}, {TreeNode::LEAF, 0, 0, 0}, {TreeNode::LEAF, 0, 1, 0}};
+    static constexpr TreeNode bad_class[]   = {{0, 0, 1, 2}, {TreeNode::LEAF, 0, 0, 0}, {TreeNode::LEAF, 0, 2, 0}};
+    static constexpr uint16_t bad_root[]    = {3};
+    constexpr inference::DecisionForest<8, 2> f0{bad_feature, root, 1, 2, 3};
+    constexpr inference::DecisionForest<8, 2> f1{bad_child, root, 1, 2, 3};
+    constexpr inference::DecisionForest<8, 2> f2{bad_class, root, 1, 2, 3};
+    constexpr inference::DecisionForest<8, 2> f3{good, bad_root, 1, 2, 3};
+    static_assert(!f0.valid() && !f1.valid() && !f2.valid() && !f3.valid(), "Must be invalid");
+
+    // Never reads out of bounds, the tree ends without vote
+    inference::Features x{};
+    x.fill(127);  // Go to right
+    std::array<uint16_t, 2> votes{};
+    for (auto&& f : {f0, f1, f2, f3}) {
+        f.evaluate(x, votes);
+        EXPECT_EQ(votes[0], 0U);
+        EXPECT_EQ(votes[1], 0U);
+    }
+    ok.evaluate(x, votes);
+    EXPECT_EQ(votes[1], 1U);
+}
+
+TEST(Trace, Ring)
+{
+    trace::Ring<8> ring;
+    trace::Event ev[16]{};
+    EXPECT_EQ(ring.snapshot(ev, 16), 0U);
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        ring.emit(i * 10, trace::Id::ReadRegister, trace::Phase::Begin, i, i * 2);
+    }
+    EXPECT_EQ(ring.emitted(), 5U);
+    EXPECT_EQ(ring.snapshot(ev, 16), 5U);
+    EXPECT_EQ(ev[0].timestamp, 0U);
+    EXPECT_EQ(ev[4].timestamp, 40U);
+    EXPECT_EQ(ev[4].id, m5::stl::to_underlying(trace::Id::ReadRegister));
+    EXPECT_EQ(ev[4].phase, 'B');
+    EXPECT_EQ(ev[4].a0, 4U);
+    EXPECT_EQ(ev[4].a1, 8U);
+
+    // Overwrite the oldest
+    for (uint32_t i = 5; i < 20; ++i) {
+        ring.emit(i * 10, trace::Id::Update, trace::Phase::Instant);
+    }
+    EXPECT_EQ(ring.snapshot(ev, 16), 8U);
+    EXPECT_EQ(ev[0].timestamp, 120U);
+    EXPECT_EQ(ev[7].timestamp, 190U);
+
+    // Newest only if the buffer is short
+    EXPECT_EQ(ring.snapshot(ev, 2), 2U);
+    EXPECT_EQ(ev[0].timestamp, 180U);
+    EXPECT_EQ(ev[1].timestamp, 190U);
+
+    ring.clear();
+    EXPECT_EQ(ring.snapshot(ev, 16), 0U);
+}
+
+TEST(Pipeline, Equivalence)
+{
+    using namespace pipeline;
+    const Calibration calib{0x0075, 0x0AFE, 0x00A1, 0x15A6, 0x00AF, 0x194D};
+    const auto gt = make_gamma_table(2.5f);
+
+    Pipeline<Raw, ClearRatio, Linear, RGB565> p565;
+    Pipeline<Raw, ClearRatio, Linear, RGB888> p888;
+    Pipeline<NoIR, ClearRatio, Linear, RGB565> pnoIR;
+    Pipeline<NoIR, Calibrate, Linear, RGB565> pcalib{Calibrate{calib}};
+    Pipeline<NoIR, Calibrate, Gamma, RGB565> pgamma{Calibrate{calib}, Gamma{gt}};
+    static_assert(!std::is_constructible<Calibrate, Calibration>::value, "Temporary calibration is rejected");
+    static_assert(!std::is_constructible<Gamma, std::array<uint8_t, 256>>::value, "Temporary table is rejected");
+
+    for (uint32_t i = 0; i < 1024; ++i) {
+        auto d = make_data(esp_random() & 0xFFFF, esp_random() & 0xFFFF, esp_random() & 0x3FFF, esp_random() & 0x3FFF);
+        EXPECT_EQ(p565(d), d.RGB565());
+        EXPECT_EQ(p888(d), d.RGB888());
+        EXPECT_EQ(pnoIR(d), d.RGBnoIR565());
+        EXPECT_EQ(pcalib(d), Data::color565(calib.R8(d), calib.G8(d), calib.B8(d)));
+        EXPECT_EQ(pgamma(d), Data::color565(gt[calib.R8(d)], gt[calib.G8(d)], gt[calib.B8(d)]));
+    }
+
+    // Benchmark against the hand-written calls
+    constexpr uint32_t num{256};
+    std::vector<Data> src(num);
+    for (auto& d : src) {
+        d = make_data(esp_random() & 0xFFFF, esp_random() & 0x3FFF, esp_random() & 0x3FFF, esp_random() & 0x3FFF);
+    }
+    std::vector<uint16_t> out(num);
+    auto start = m5::utility::micros();
+    for (uint32_t i = 0; i < num; ++i) {
+        const auto& d = src[i];
+        out[i]        = Data::color565(gt[calib.R8(d)], gt[calib.G8(d)], gt[calib.B8(d)]);
+    }
+    auto hand = m5::utility::micros() - start;
+    start     = m5::utility::micros();
+    pgamma(out.data(), src.data(), num);
+    auto composed = m5::utility::micros() - start;
+    M5_LOGI("Hand-written:%lu us Pipeline:%lu us (%u samples)", (unsigned long)hand, (unsigned long)composed, num);
+}
+
+TEST(Register, Fields)
+{
+    using namespace command;
+    static_assert(ENABLE::address == 0x00 && CONTROL::address == 0x0F, "Address");
+    static_assert(ENABLE::AIEN::mask == 0x10 && CONTROL::AGAIN::mask == 0x03 && PERS::APERS::mask == 0x0F, "Mask");
+    static_assert(ATIME::reset == 0xFF && ATIME::VALUE::mask == 0xFF, "Full width");
+
+    // Multi-field update folds into a constant
+    using Run = Compose<FieldValue<ENABLE::PON, 1>, FieldValue<ENABLE::AEN, 1>, FieldValue<ENABLE::WEN, 1>,
+                        FieldValue<ENABLE::AIEN, 0>>;
+    static_assert(Run::update().complete(), "All writable bits");
+    static_assert(Run::update().apply(0xFF) == 0x0B && Run::update().apply(0x00) == 0x0B, "Constant");
+
+    // Partial update keeps other fields and clears reserved bits
+    constexpr auto stop = ENABLE::AEN::value<0>() | ENABLE::PON::value<1>();
+    static_assert(!stop.complete(), "Partial");
+    EXPECT_EQ(stop.apply(0x1B), 0x19);
+    EXPECT_EQ(stop.apply(0xE0), 0x01);
+    // Right side wins
+    EXPECT_EQ((ENABLE::PON::value<1>() | ENABLE::PON::value<0>()).apply(0x01), 0x00);
+
+    // Runtime value is truncated to the width
+    EXPECT_EQ(CONTROL::AGAIN::set(0x07).apply(0x00), 0x03);
+    EXPECT_EQ(CONFIG::WLONG::set(true).apply(0x00), 0x02);
+    EXPECT_EQ(CONFIG::WLONG::set(false).apply(0x02), 0x00);
+
+    EXPECT_EQ(STATUS::AVALID::get(0x11), 1U);
+    EXPECT_EQ(STATUS::AINT::get(0x11), 1U);
+    EXPECT_EQ(STATUS::AINT::get(0x01), 0U);
+    EXPECT_EQ(PERS::APERS::get(0xA5), 0x05);
+}
+
+TEST(Sweep, Simulator)
+{
+    // Fixed target
+    sweep::Simulator sim(2.0f, 0.8f, 0.7f, 0.5f);
+    const uint8_t atimes[] = {0xFF, 0xF6, 0xD5, 0xC0, 0x00};
+    constexpr size_t num{sweep::NUMBER_OF_GAINS * 5};
+    sweep::Entry table[num]{};
+
+    EXPECT_EQ(sweep::run(sim, atimes, 5, 1, table, num), 0U);       // Too few samples
+    EXPECT_EQ(sweep::run(sim, atimes, 5, 16, table, num - 1), 0U);  // Too small table
+    ASSERT_EQ(sweep::run(sim, atimes, 5, 16, table, num), num);
+
+    for (size_t g = 0; g < sweep::NUMBER_OF_GAINS; ++g) {
+        for (size_t i = 0; i < 5; ++i) {
+            const auto& e = table[g * 5 + i];
+            EXPECT_EQ(m5::stl::to_underlying(e.gain), g);
+            EXPECT_EQ(e.atime, atimes[i]);
+            EXPECT_EQ(e.bus, static_cast<uint16_t>(sweep::Simulator::SAMPLE_BYTES));
+            if (i) {
+                // Longer integration, more counts and lower rate
+                const auto& prev = table[g * 5 + i - 1];
+                EXPECT_GT(e.mean, prev.mean) << g << "," << i;
+                EXPECT_GT(e.period, prev.period) << g << "," << i;
+            }
+        }
+    }
+    // Saturated
+    EXPECT_EQ(table[num - 1].mean, 0xFFFF);
+    EXPECT_EQ(table[num - 1].margin, 0U);
+
+    // Fastest meeting the requirement
+    const auto* e = sweep::select(table, num, 0.02f);
+    ASSERT_NE(e, nullptr);
+    EXPECT_LE(e->relativeNoise(), 0.02f);
+    EXPECT_GT(e->margin, 0U);
+    for (auto&& o : table) {
+        if (o.margin && o.relativeNoise() <= 0.02f) {
+            EXPECT_GE(o.period, e->period);
+        }
+    }
+    // Saturated entry is never selected
+    EXPECT_EQ(sweep::select(table, num, 0.001f), nullptr);
+    EXPECT_EQ(sweep::select(nullptr, num, 1.0f), nullptr);
+}
+
+TEST(Stream, Decimator)
+{
+    const uint16_t values[] = {10, 20, 30, 41, 5, 65535, 65535, 65535};
+    Decimator mean(4, Aggregation::Mean), min(4, Aggregation::Min), max(4, Aggregation::Max);
+    Decimator last(1, Aggregation::Last), disabled{};
+
+    uint32_t outputs{};
+    for (auto&& v : values) {
+        auto d  = make_data(v, v / 2, v / 3, v / 4);
+        d.atime = 0xF6;
+        d.gain  = Gain::Controlx4;
+        EXPECT_TRUE(last.push(d));
+        EXPECT_EQ(last.output().C16(), v);
+        EXPECT_FALSE(disabled.push(d));
+        outputs += mean.push(d);
+        min.push(d);
+        max.push(d);
+    }
+    EXPECT_EQ(outputs, 2U);
+    EXPECT_EQ(mean.count(), 2U);
+    EXPECT_EQ(last.count(), 8U);
+    EXPECT_EQ(disabled.count(), 0U);
+
+    // Second window: 5, 65535 x3 (rounded)
+    EXPECT_EQ(mean.output().C16(), 49153U);
+    EXPECT_EQ(min.output().C16(), 5U);
+    EXPECT_EQ(max.output().C16(), 65535U);
+    EXPECT_EQ(max.output().R16(), 65535U / 2);
+    EXPECT_EQ(mean.output().atime, 0xF6);
+    EXPECT_EQ(mean.output().gain, Gain::Controlx4);
+
+    // Window restarts on the settings change
+    auto a = make_data(100, 0, 0, 0);
+    auto b = make_data(300, 0, 0, 0);
+    b.gain = Gain::Controlx16;
+    Decimator pair(2, Aggregation::Mean);
+    EXPECT_FALSE(pair.push(a));
+    EXPECT_FALSE(pair.push(b));
+    EXPECT_TRUE(pair.push(b));
+    EXPECT_EQ(pair.output().C16(), 300U);
+    EXPECT_EQ(pair.output().gain, Gain::Controlx16);
+}
+
+TEST(Uncertainty, Propagation)
+{
+    using namespace uncertainty;
+    NoiseModel model{};
+    model.read = {{1.0f, 1.0f, 1.0f, 1.0f}};
+
+    // Expected values of the simulated target (counts per ms at x1 * ATIME * gain)
+    const Exposure exp{Gain::Controlx4, 0xF6};
+    constexpr uint16_t scale{24 * 4};
+    auto mean    = make_data(20 * scale, 9 * scale, 8 * scale, 5 * scale);
+    mean.gain    = exp.gain;
+    mean.atime   = exp.atime;
+    const auto k = calculateDerivedConstants(exp.atime, exp.gain);
+
+    const auto lux = estimateLux(mean, k, model);
+    const auto cct = estimateColorTemperature(mean, model);
+    const auto rgb = estimateRGB(mean, model);
+    EXPECT_TRUE(lux.valid());
+    EXPECT_TRUE(cct.valid());
+    EXPECT_FLOAT_EQ(lux.value, calculateLux(mean, k));
+    EXPECT_EQ(rgb[0].value, mean.R8());
+    EXPECT_NEAR(snr(mean, model), std::sqrt(20.0f * scale / 4), 0.1f);  // var = gain * counts
+
+    // Measured gain factors are used for the shot noise
+    const GainTable measured{{1.0f, 3.9f, 15.2f, 58.0f}};
+    NoiseModel mg = model;
+    mg.gains      = measured;
+    EXPECT_FLOAT_EQ(mg.variance(1000, Gain::Controlx60), 58.0f * 1000 + 1.0f + 1.0f / 12);
+    EXPECT_FLOAT_EQ(model.variance(1000, Gain::Controlx60), 60.0f * 1000 + 1.0f + 1.0f / 12);
+    const auto km = calculateDerivedConstants(exp.atime, exp.gain, 0.0f, DGF, measured);
+    EXPECT_FLOAT_EQ(estimateLux(mean, km, model).sigma, estimateLux(mean, km, mg).sigma);
+    EXPECT_NE(estimateLux(mean, km, model).sigma, estimateLux(mean, k, mg).sigma);
+
+    // Empirical spread of the simulated sensor (shot noise scale 1, read noise 1)
+    constexpr size_t num{1024};
+    std::vector<Data> v(num);
+    sweep::Simulator sim(20.f, 9.f, 8.f, 5.f, 1.0f, 7);
+    ASSERT_TRUE(sim.measure(v.data(), num, exp));
+    auto stddev = [&v](float (*f)(const Data&)) {
+        double s{}, s2{};
+        for (auto&& d : v) {
+            const double x = f(d);
+            s += x;
+            s2 += x * x;
+        }
+        return std::sqrt(s2 / v.size() - (s / v.size()) * (s / v.size()));
+    };
+    const double lux_sd =
+        stddev([](const Data& d) { return calculateLux(d, calculateDerivedConstants(d.atime, d.gain)); });
+    const double cct_sd = stddev([](const Data& d) { return calculateColorTemperature(d); });
+    const double r_sd   = stddev([](const Data& d) { return d.R16() * 255.0f / d.C16(); });
+    EXPECT_NEAR(lux.sigma, lux_sd, lux_sd * 0.15);
+    EXPECT_NEAR(cct.sigma, cct_sd, cct_sd * 0.15);
+    EXPECT_NEAR(rgb[0].sigma, r_sd, r_sd * 0.15);
+
+    // Calibration recovers the shot noise scale
+    NoiseModel cal{};
+    cal.read = model.read;
+    cal.shot = 3.0f;
+    EXPECT_TRUE(calibrateShotNoise(cal, v.data(), num));
+    EXPECT_NEAR(cal.shot, 1.0f, 0.15f);
+    EXPECT_FALSE(calibrateShotNoise(cal, v.data(), 1));
+
+    // Saturated sample is rejected
+    auto sat  = make_data(0xFFFF, 100, 100, 100);
+    sat.atime = 0x00;
+    EXPECT_FALSE(estimateLux(sat, k, model).valid());
+    EXPECT_EQ(estimateLux(sat, k, model).weight(), 0.0f);
+    EXPECT_EQ(snr(sat, model), 0.0f);
+}
+
+TEST(Utility, GainTable)
+{
+    // Deviated gains and a linearly drifting source
+    const GainTable actual{{1.0f, 3.9f, 15.2f, 58.0f}};
+    const Gain order[6] = {Gain::Controlx1,  Gain::Controlx4,  Gain::Controlx16,
+                           Gain::Controlx60, Gain::Controlx16, Gain::Controlx4};
+    Data seq[13]{};
+    for (size_t i = 0; i < 13; ++i) {
+        const Gain gc    = order[i % 6];
+        const float base = 1000.0f * (1.0f + 0.002f * i);  // x60 does not saturate
+        seq[i]           = make_data(std::round(base * actual[m5::stl::to_underlying(gc)]), 0, 0, 0);
+        seq[i].gain      = gc;
+        seq[i].atime     = 0xC0;
+    }
+
+    GainTable gt{};
+    EXPECT_TRUE(calculateGainTable(gt, seq, 13));
+    EXPECT_FLOAT_EQ(gt[0], 1.0f);
+    for (size_t i = 1; i < gt.size(); ++i) {
+        EXPECT_NEAR(gt[i], actual[i], actual[i] * 0.001f) << i;
+    }
+
+    // Readings are continuous across the gain switch with the measured table
+    const auto k1  = calculateDerivedConstants(0xC0, Gain::Controlx4, 0.0f, DGF, gt);
+    const auto k2  = calculateDerivedConstants(0xC0, Gain::Controlx16, 0.0f, DGF, gt);
+    auto d1        = make_data(3900, 1500, 1400, 900);
+    d1.gain        = Gain::Controlx4;
+    d1.atime       = 0xC0;
+    auto d2        = make_data(15200, 5846, 5456, 3508);
+    d2.gain        = Gain::Controlx16;
+    d2.atime       = 0xC0;
+    const float l1 = calculateLux(d1, k1);
+    EXPECT_NEAR(calculateLux(d2, k2), l1, l1 * 0.001f);
+    // Data of the other settings uses the table of the constants
+    EXPECT_NEAR(calculateLux(d2, k1), l1, l1 * 0.001f);
+    // Nominal table has a step
+    EXPECT_GT(std::fabs(calculateLux(d2, calculateDerivedConstants(0xC0, Gain::Controlx16)) - l1), l1 * 0.02f);
+
+    // Too dark / saturated / no adjacent pairs
+    Data dark[13]{};
+    for (size_t i = 0; i < 13; ++i) {
+        dark[i]     = seq[i];
+        dark[i].raw = make_data(10, 0, 0, 0).raw;
+    }
+    EXPECT_FALSE(calculateGainTable(gt, dark, 13));
+    EXPECT_FALSE(calculateGainTable(gt, seq, 1));
+    EXPECT_FALSE(calculateGainTable(gt, seq, 3));  // x1,x4,x16 only
+}
+
+TEST(Marker, Decoder)
+{
+    // Clear 256 makes the chromaticity equal to the channel
+    const marker::Reference palette[] = {{'A', {100, 100, 50}}, {'B', {100, 100, 80}}, {'W', {90, 85, 80}}};
+    marker::Config cfg{};
+    cfg.background = 'W';
+    cfg.gap_ms     = 50;
+    marker::Decoder dec(palette, 3, cfg);
+    const auto white = make_data(256, 90, 85, 80);
+    uint32_t ms{};
+
+    uint16_t dist{};
+    EXPECT_EQ(dec.classify(marker::chroma(make_data(256, 100, 100, 52)), dist), 'A');
+    EXPECT_EQ(dist, 2U);
+    EXPECT_EQ(dec.classify(marker::chroma(make_data(256, 200, 10, 10)), dist), marker::UNKNOWN);
+
+    // Single sample is rejected by the minimum dwell
+    EXPECT_FALSE(dec.push(white, ms += 10));
+    EXPECT_FALSE(dec.push(white, ms += 10));
+    EXPECT_EQ(dec.current(), 'W');
+    EXPECT_FALSE(dec.push(make_data(256, 100, 100, 50), ms += 10));
+    EXPECT_EQ(dec.current(), 'W');
+    EXPECT_FALSE(dec.push(white, ms += 10));
+
+    // A from 50 ms, B is kept A by the hysteresis and then confirmed at 100 ms
+    for (auto&& b : {50, 50, 66, 66, 50, 75, 75, 75}) {
+        EXPECT_FALSE(dec.push(make_data(256, 100, 100, b), ms += 10));
+    }
+    EXPECT_EQ(dec.current(), 'B');
+    // Dark sample is UNKNOWN (background)
+    EXPECT_FALSE(dec.push(make_data(8, 4, 4, 4), ms += 10));
+    EXPECT_FALSE(dec.push(make_data(8, 4, 4, 4), ms += 10));
+    EXPECT_EQ(dec.current(), marker::UNKNOWN);
+
+    // Gap ends the sequence
+    bool emitted{};
+    for (int i = 0; i < 6; ++i) {
+        emitted |= dec.push(white, ms += 10);
+    }
+    EXPECT_TRUE(emitted);
+    ASSERT_EQ(dec.available(), 1U);
+    marker::Sequence seq{};
+    EXPECT_TRUE(dec.pop(seq));
+    EXPECT_FALSE(dec.pop(seq));
+    EXPECT_FALSE(seq.overflow);
+    ASSERT_EQ(seq.length, 2U);
+    EXPECT_EQ(seq.symbols[0], 'A');
+    EXPECT_EQ(seq.symbols[1], 'B');
+    EXPECT_EQ(seq.durations_ms[0], 50U);
+    EXPECT_EQ(seq.durations_ms[1], 30U);
+    EXPECT_EQ(seq.start_ms, 50U);
+    EXPECT_EQ(seq.end_ms, 130U);
+
+    // Overflow and flush
+    for (size_t i = 0; i < marker::MAX_SEQUENCE_LENGTH + 2; ++i) {
+        const auto d = make_data(256, 100, 100, (i & 1) ? 80 : 50);
+        dec.push(d, ms += 10);
+        dec.push(d, ms += 10);
+    }
+    EXPECT_TRUE(dec.flush(ms));
+    EXPECT_TRUE(dec.pop(seq));
+    EXPECT_EQ(seq.length, static_cast<uint8_t>(marker::MAX_SEQUENCE_LENGTH));
+    EXPECT_TRUE(seq.overflow);
+
+    // Queue full discards the oldest
+    dec.reset();
+    for (size_t i = 0; i < marker::SEQUENCE_QUEUE_SIZE + 1; ++i) {
+        dec.push(make_data(256, 100, 100, 50), ms += 10);
+        dec.push(make_data(256, 100, 100, 50), ms += 10);
+        dec.flush(ms);
+    }
+    EXPECT_EQ(dec.available(), marker::SEQUENCE_QUEUE_SIZE);
+    EXPECT_EQ(dec.dropped(), 1U);
+}
+
+TEST(Marker, Tape)
+{
+    const marker::Reference palette[] = {
+        {'W', {90, 85, 80}}, {'R', {170, 45, 40}}, {'G', {50, 150, 60}}, {'B', {40, 70, 150}}, {'Y', {120, 110, 25}}};
+    const uint8_t code[] = {'R', 'G', 'B', 'Y', 'R', 'R', 'B', 'G'};
+    marker::Config cfg{};
+    cfg.background = 'W';
+
+    // Sample period 2.4ms (ATIME 0xFF), 5mm marks with 3mm gaps
+    constexpr float period_ms{2.4f};
+    for (auto&& speed : {25.0f, 50.0f, 100.0f, 200.0f, 400.0f, 800.0f}) {
+        SCOPED_TRACE(speed);
+        marker::Tape tape(palette, 5, palette[0], code, sizeof(code));
+        std::vector<Data> samples{};
+        const float step = speed * period_ms / 1000.0f;
+        for (float x = 0.0f; x + step < tape.length(); x += step) {
+            samples.push_back(tape.sample(x, x + step));
+        }
+
+        // Twice the gap between the marks ends the sequence
+        cfg.gap_ms = static_cast<uint32_t>(2 * 3.0f * 1000.0f / speed);
+        marker::Decoder dec(palette, 5, cfg);
+        const auto start = m5::utility::micros();
+        for (size_t i = 0; i < samples.size(); ++i) {
+            dec.push(samples[i], static_cast<uint32_t>(i * period_ms));
+        }
+        dec.flush(static_cast<uint32_t>(samples.size() * period_ms));
+        const auto elapsed = m5::utility::micros() - start;
+        M5_LOGI("%.0f mm/s: %u samples %.2f us/sample", speed, (unsigned)samples.size(),
+                (float)elapsed / samples.size());
+
+        marker::Sequence seq{};
+        ASSERT_TRUE(dec.pop(seq));
+        // The gap must last the minimum dwell to separate the marks
+        const float gap_samples = 3.0f / step;
+        if (gap_samples < cfg.min_dwell + 1) {
+            EXPECT_LT(seq.length, sizeof(code));
+            continue;
+        }
+        EXPECT_EQ(dec.available(), 0U);
+        ASSERT_EQ(seq.length, sizeof(code));
+        const float mark_ms = 5.0f / speed * 1000.0f;
+        for (size_t i = 0; i < sizeof(code); ++i) {
+            EXPECT_EQ(seq.symbols[i], code[i]) << i;
+            EXPECT_NEAR(seq.durations_ms[i], mark_ms, mark_ms * 0.3f + period_ms * 2) << i;
+        }
+    }
+}
+
+TEST(SPC, Chart)
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 2.0f);
+
+    spc::Chart chart{};
+    EXPECT_FALSE(chart.setBaseline(100.0f, 0.0f));
+    EXPECT_FALSE(chart.armed());
+
+    // Learn the baseline
+    for (uint16_t i = 0; i < chart.config().baseline; ++i) {
+        EXPECT_EQ(chart.push(100.0f + noise(rng)), 0U);
+    }
+    EXPECT_TRUE(chart.armed());
+    EXPECT_NEAR(chart.target(), 100.0f, 1.5f);
+    EXPECT_NEAR(chart.sigma(), 2.0f, 0.8f);
+    EXPECT_EQ(chart.push(NAN), 0U);  // Ignored
+    EXPECT_EQ(chart.count(), 0U);
+
+    // In control
+    EXPECT_TRUE(chart.setBaseline(100.0f, 2.0f));
+    for (int i = 0; i < 100; ++i) {
+        chart.push(100.0f + noise(rng));
+    }
+    EXPECT_FALSE(chart.alarmed());
+    EXPECT_LT(std::fabs(chart.driftSigma()), 1.0f);
+
+    // +1 sigma drift is detected by both charts within a few dozens of samples
+    int detected{-1};
+    for (int i = 0; i < 100; ++i) {
+        if (chart.push(102.0f + noise(rng)) && detected < 0) {
+            detected = i;
+        }
+    }
+    EXPECT_GE(detected, 0);
+    EXPECT_LT(detected, 40);
+    EXPECT_EQ(chart.alarm(), spc::ALARM_CUSUM_HIGH | spc::ALARM_EWMA_HIGH);
+    EXPECT_NEAR(chart.driftSigma(), 1.0f, 0.5f);
+    EXPECT_NEAR(chart.drift(), 2.0f, 1.0f);
+
+    // Latched until acknowledged
+    chart.push(100.0f);
+    EXPECT_TRUE(chart.alarmed());
+    chart.acknowledge();
+    EXPECT_FALSE(chart.alarmed());
+    EXPECT_FLOAT_EQ(chart.ewma(), 100.0f);
+
+    // Downward
+    for (int i = 0; i < 100; ++i) {
+        chart.push(97.0f + noise(rng));
+    }
+    EXPECT_TRUE(chart.alarm() & spc::ALARM_CUSUM_LOW);
+    EXPECT_TRUE(chart.alarm() & spc::ALARM_EWMA_LOW);
+    EXPECT_FALSE(chart.alarm() & (spc::ALARM_CUSUM_HIGH | spc::ALARM_EWMA_HIGH));
+
+    chart.reset();
+    EXPECT_FALSE(chart.armed());
+    EXPECT_FALSE(chart.alarmed());
+}
+
+TEST(SPC, Monitor)
+{
+    spc::ChartConfig cfg{};
+    cfg.baseline = 8;
+    spc::Monitor monitor(cfg, cfg);
+    const auto k = calculateDerivedConstants(0xC0, Gain::Controlx4);
+
+    auto sample = [](const uint16_t c, const float red) {
+        auto d  = make_data(c, c * red, c * 0.35f, c * 0.25f);
+        d.atime = 0xC0;
+        d.gain  = Gain::Controlx4;
+        return d;
+    };
+    for (uint16_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(monitor.push(sample(5000 + (i & 1) * 20, 0.4f), k), 0U);
+    }
+    EXPECT_TRUE(monitor.armed());
+    EXPECT_NEAR(monitor.chromaR().target(), 0.4f, 0.001f);
+
+    // Saturated and dark are ignored
+    monitor.push(sample(k.saturation, 0.4f), k);
+    monitor.push(make_data(0, 0, 0, 0), k);
+    EXPECT_EQ(monitor.ignored(), 2U);
+    EXPECT_EQ(monitor.lux().count(), 0U);
+
+    // Channel masks (C only, C and R) are ignored, not drift
+    for (uint16_t i = 0; i < 20; ++i) {
+        auto d     = sample(5010, 0.4f);
+        d.channels = m5::stl::to_underlying(Channel::Clear);
+        d.raw[2] = d.raw[3] = d.raw[4] = d.raw[5] = d.raw[6] = d.raw[7] = 0;
+        EXPECT_EQ(monitor.push(d, k), 0U);
+        d          = sample(5010, 0.4f);
+        d.channels = Channel::Clear | Channel::Red;
+        d.raw[4] = d.raw[5] = d.raw[6] = d.raw[7] = 0;
+        EXPECT_EQ(monitor.push(d, k), 0U);
+    }
+    EXPECT_EQ(monitor.ignored(), 42U);
+    EXPECT_EQ(monitor.lux().count(), 0U);
+    EXPECT_FALSE(monitor.alarmed());
+
+    // Chromaticity drift at the same brightness
+    for (uint16_t i = 0; i < 20; ++i) {
+        monitor.push(sample(5010, 0.45f), k);
+    }
+    EXPECT_TRUE(monitor.chromaR().alarm() & spc::ALARM_CUSUM_HIGH);
+    EXPECT_TRUE(monitor.chromaG().alarm() & spc::ALARM_CUSUM_LOW);
+    EXPECT_GT(monitor.chromaR().drift(), 0.0f);
+    EXPECT_TRUE(monitor.alarmed());
+
+    monitor.acknowledge();
+    EXPECT_FALSE(monitor.alarmed());
+    EXPECT_TRUE(monitor.armed());
+    monitor.reset();
+    EXPECT_FALSE(monitor.armed());
+}
+
+TEST(Calibrator, Reference)
+{
+    // Clear = R + G + B makes IR zero, so NoIR values are the raw values
+    auto sample = [](const uint16_t r, const uint16_t g, const uint16_t b) {
+        auto d  = make_data(r + g + b, r, g, b);
+        d.atime = 0xC0;
+        d.gain  = Gain::Controlx4;
+        return d;
+    };
+    calibrator::Config cfg{};
+    cfg.reference_samples = 4;
+    cfg.smoothing         = 0.5f;
+    calibrator::Online online(Calibration{100, 1000, 100, 1000, 100, 1000}, cfg);
+    pipeline::Calibrate stage{online.calibration()};
+
+    // Production samples do not change the calibration without the extreme tracking
+    EXPECT_FALSE(online.push(sample(500, 500, 500)));
+    // White reference reading
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(online.push(sample(2000, 1800, 1600), calibrator::Reference::White));
+    }
+    EXPECT_TRUE(online.push(sample(2000, 1800, 1600), calibrator::Reference::White));
+    EXPECT_EQ(online.generation(), 1U);
+    const auto& c = online.calibration();
+    EXPECT_EQ(c.blackR, 100U);
+    EXPECT_EQ(c.whiteR, 1500U);
+    EXPECT_EQ(c.whiteG, 1400U);
+    EXPECT_EQ(c.whiteB, 1300U);
+    // Consumers follow the publication
+    EXPECT_EQ(stage.apply(pipeline::Channels{800, 0, 0, 0}).r, 128U);  // 198 with the initial range
+
+    // Interrupted reading is discarded
+    EXPECT_FALSE(online.push(sample(9000, 9000, 9000), calibrator::Reference::White));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(online.push(sample(300, 300, 300), calibrator::Reference::Black));
+    }
+    EXPECT_TRUE(online.push(sample(300, 300, 300), calibrator::Reference::Black));
+    EXPECT_EQ(c.blackR, 200U);
+    EXPECT_EQ(c.blackB, 200U);
+    EXPECT_EQ(c.whiteR, 1500U);
+
+    // Settings change restarts the reading, and publishes the range rescaled to the new settings
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(online.push(sample(2000, 2000, 2000), calibrator::Reference::White));
+    }
+    auto other = sample(2000, 2000, 2000);
+    other.gain = Gain::Controlx16;
+    EXPECT_TRUE(online.push(other, calibrator::Reference::White));
+    EXPECT_EQ(online.generation(), 3U);
+    EXPECT_EQ(c.blackR, 800U);
+    EXPECT_EQ(c.whiteR, 6000U);
+
+    // Inverted range is rejected and the calibration is kept (back to x4 rescales again)
+    for (int i = 0; i < 4; ++i) {
+        online.push(sample(3000, 3000, 3000), calibrator::Reference::Black);
+    }
+    EXPECT_EQ(online.rejected(), 1U);
+    EXPECT_EQ(online.generation(), 4U);
+    EXPECT_EQ(c.blackR, 200U);
+    EXPECT_EQ(c.whiteR, 1500U);
+}
+
+TEST(Calibrator, Extremes)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint16_t> uniform(200, 3000);
+    auto sample = [](const uint16_t r, const uint16_t g, const uint16_t b) {
+        auto d  = make_data(r + g + b, r, g, b);
+        d.atime = 0xC0;
+        d.gain  = Gain::Controlx4;
+        return d;
+    };
+
+    calibrator::Config cfg{};
+    cfg.track_extremes = true;
+    calibrator::Online online(Calibration{100, 1000, 100, 1000, 100, 1000}, cfg);
+
+    // Production samples spread over black to white with rare outliers
+    uint32_t published{};
+    for (uint32_t i = 0; i < 4000; ++i) {
+        const uint16_t v = (i % 100 == 99) ? 20000 : uniform(rng);
+        published += online.push(sample(v, v, v));
+    }
+    EXPECT_EQ(published, 4000U / cfg.extremes_interval);
+    EXPECT_EQ(online.generation(), published);
+
+    // 2% / 98% quantiles of the samples
+    const auto& c = online.calibration();
+    EXPECT_NEAR(c.blackR, 256, 60);
+    EXPECT_NEAR(c.whiteR, 2944 + 30, 150);
+    EXPECT_EQ(c.blackR, c.blackG);
+    EXPECT_EQ(c.whiteR, c.whiteB);
+
+    // Partial samples (channel mask) are ignored, masked channels read as zero
+    const auto before = c;
+    for (uint32_t i = 0; i < 4000; ++i) {
+        auto d     = sample(0, 0, 0);
+        d.raw[0]   = 0xFF;
+        d.raw[1]   = 0x0F;
+        d.channels = m5::stl::to_underlying(Channel::Clear);
+        d.flags    = m5::stl::to_underlying(Flag::Partial);
+        EXPECT_FALSE(online.push(d));
+    }
+    EXPECT_EQ(online.generation(), published);
+    EXPECT_EQ(c.blackR, before.blackR);
+    EXPECT_EQ(c.whiteR, before.whiteR);
+}
+
+TEST(Calibrator, SettingsChange)
+{
+    // Nominal and measured gain factors of the device
+    const GainTable tables[] = {NOMINAL_GAINS, GainTable{{1.0f, 3.9f, 15.2f, 58.0f}}};
+    for (auto&& gains : tables) {
+        SCOPED_TRACE(gains[3]);
+        // Same light (IR zero) under the settings
+        auto sample = [&gains](const uint16_t v, const uint8_t atime, const Gain gc) {
+            const float k = (256 - atime) * gains[m5::stl::to_underlying(gc)] / (64 * gains[1]);
+            const auto r  = static_cast<uint16_t>(v * k);
+            auto d        = make_data(r * 3, r, r, r);
+            d.atime       = atime;
+            d.gain        = gc;
+            return d;
+        };
+        calibrator::Online online(Calibration{100, 1000, 100, 1000, 100, 1000}, calibrator::Config{}, gains);
+        EXPECT_TRUE(online.gainTable() == gains);
+        const auto& c = online.calibration();
+
+        auto d = sample(550, 0xC0, Gain::Controlx4);
+        EXPECT_FALSE(online.push(d));  // The initial calibration is of x4 0xC0
+        const uint8_t expected = c.R8(d);
+        EXPECT_EQ(expected, 128U);
+
+        struct Setting {
+            uint8_t atime;
+            Gain gain;
+        };
+        constexpr Setting settings[] = {{0xC0, Gain::Controlx16},
+                                        {0xE0, Gain::Controlx16},
+                                        {0xE0, Gain::Controlx60},
+                                        {0xC0, Gain::Controlx1},
+                                        {0xC0, Gain::Controlx4}};
+        uint32_t generation = online.generation();
+        for (auto&& s : settings) {
+            d = sample(550, s.atime, s.gain);
+            EXPECT_TRUE(online.push(d)) << "atime=" << (int)s.atime << " gain=" << (int)s.gain;
+            EXPECT_EQ(online.generation(), ++generation);
+            EXPECT_NEAR(c.R8(d), expected, 1) << "atime=" << (int)s.atime << " gain=" << (int)s.gain;
+            EXPECT_FALSE(online.push(d));  // Same settings
+        }
+        // Back to the first settings, off only by the rounding of the non-integer ratios
+        const int tolerance = (gains == NOMINAL_GAINS) ? 0 : 2;
+        EXPECT_NEAR(c.blackR, 100, tolerance);
+        EXPECT_NEAR(c.whiteR, 1000, tolerance);
+    }
+
+    calibrator::Online online(Calibration{100, 1000, 100, 1000, 100, 1000});
+    EXPECT_TRUE(online.gainTable() == NOMINAL_GAINS);
+    EXPECT_FALSE(online.setGainTable(GainTable{{1.0f, 4.0f, 3.0f, 60.0f}}));
+    EXPECT_FALSE(online.setGainTable(GainTable{{0.0f, 4.0f, 16.0f, 60.0f}}));
+    EXPECT_TRUE(online.setGainTable(tables[1]));
+    EXPECT_TRUE(online.gainTable() == tables[1]);
+}
+
+TEST(HotSwap, Holder)
+{
+    hotswap::Holder<Calibration> holder{Calibration{100, 1000, 100, 1000, 100, 1000}};
+    const auto d = make_data(1650, 550, 550, 550);  // IR 0
+    EXPECT_EQ(holder.version(), 0U);
+    EXPECT_FALSE(holder.pinned());
+
+    {
+        auto snap = holder.read();
+        EXPECT_TRUE(holder.pinned());
+        EXPECT_EQ(snap->R8(d), 128U);
+
+        // Published while pinned, the snapshot keeps the old version
+        EXPECT_TRUE(holder.tryPublish(Calibration{0, 1100, 0, 1100, 0, 1100}));
+        EXPECT_EQ(holder.version(), 1U);
+        EXPECT_EQ(snap->whiteR, 1000U);
+        {
+            auto latest = holder.read();
+            EXPECT_EQ(latest->R8(d), 128U);
+            EXPECT_EQ(latest->whiteR, 1100U);
+            EXPECT_NE(latest.get(), snap.get());
+        }
+        // The slot of the old version is still pinned
+        EXPECT_FALSE(holder.tryPublish(Calibration{0, 2000, 0, 2000, 0, 2000}));
+        EXPECT_FALSE(holder.publish(Calibration{0, 2000, 0, 2000, 0, 2000}, 10));
+        EXPECT_EQ(holder.version(), 1U);
+        EXPECT_EQ(snap->whiteR, 1000U);
+    }
+    EXPECT_FALSE(holder.pinned());
+
+    // Released, publication succeeds
+    EXPECT_TRUE(holder.update([](Calibration& c) { c.whiteR = 2200; }));
+    EXPECT_EQ(holder.version(), 2U);
+    auto snap = holder.read();
+    EXPECT_EQ(snap->whiteR, 2200U);
+    EXPECT_EQ(snap->whiteG, 1100U);
+    EXPECT_EQ(snap->R8(d), 64U);
+
+    // Gamma table
+    hotswap::Holder<std::array<uint8_t, 256>> gamma{make_gamma_table(2.2f)};
+    EXPECT_TRUE(gamma.publish(make_gamma_table(1.0f)));
+    EXPECT_EQ((*gamma.read())[128], 128U);
+}
+
+TEST(HotSwap, CrossCore)
+{
+    // Version n is black n and white n + 1 on every channel, so a torn read shows up as different channels
+    hotswap::Holder<Calibration> holder{Calibration{0, 1, 0, 1, 0, 1}};
+    constexpr uint16_t LAST{60000};
+
+    struct Writer {
+        hotswap::Holder<Calibration>& holder;
+        uint16_t value;
+        size_t process()
+        {
+            const uint16_t v = value + 1;
+            const uint16_t w = v + 1;
+            if (value >= LAST || !holder.tryPublish(Calibration{v, w, v, w, v, w})) {
+                return 0;  // Pinned by a reader (or done), retry on the next call
+            }
+            value = v;
+            return 1;
+        }
+    };
+    struct Reader {
+        const hotswap::Holder<Calibration>& holder;
+        uint32_t reads, torn, backwards;
+        uint16_t last;
+        size_t process()
+        {
+            {
+                auto snap            = holder.read();
+                const Calibration& c = *snap;
+                const uint16_t v     = c.blackR;
+                const uint16_t w     = v + 1;
+                torn += !(c.whiteR == w && c.blackG == v && c.whiteG == w && c.blackB == v && c.whiteB == w);
+                backwards += (v < last);
+                last = v;
+            }
+            return (++reads & 0xFF) ? 1 : 0;  // Yield a tick now and then
+        }
+    };
+
+    Writer writer{holder, 0};
+    Reader readers[2]{{holder, 0, 0, 0, 0}, {holder, 0, 0, 0, 0}};
+    {
+        crosscore::Task readerTask[2]{}, writerTask{};
+        EXPECT_TRUE(readerTask[0].start(readers[0], "rd0", 0));
+        EXPECT_TRUE(readerTask[1].start(readers[1], "rd1", 0));
+        EXPECT_TRUE(writerTask.start(writer, "wr", 1));
+        m5::utility::delay(1000);
+        writerTask.stop();
+        readerTask[0].stop();
+        readerTask[1].stop();
+    }
+
+    M5_LOGI("Published:%u Reads:%u/%u", (unsigned)writer.value, (unsigned)readers[0].reads, (unsigned)readers[1].reads);
+    EXPECT_GT(writer.value, 100U);
+    EXPECT_EQ(holder.version(), writer.value);
+    EXPECT_FALSE(holder.pinned());
+    for (auto&& r : readers) {
+        EXPECT_GT(r.reads, 1000U);
+        EXPECT_EQ(r.torn, 0U);
+        EXPECT_EQ(r.backwards, 0U);
+    }
+}
+
+TEST(Memo, Cache)
+{
+    uint32_t calls{};
+    auto cct = memo::make_cache<64>([&calls](const Data& d) {
+        ++calls;
+        return calculateColorTemperature(d);
+    });
+    static_assert(std::is_same<decltype(cct)::value_type, float>::value, "Deduced from the computation");
+
+    // Static scene, +-1 count noise straddling the quantization steps of C and R (4001/4002, 1201/1202)
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> noise(0, 1);
+    for (int i = 0; i < 1000; ++i) {
+        auto d  = make_data(4001 + noise(rng), 1201 + noise(rng), 1500, 1000);
+        d.atime = 0xC0;
+        // Samples in the same quantization step share the result
+        EXPECT_NEAR(cct(d), calculateColorTemperature(d), 5.0f);
+    }
+    EXPECT_EQ(calls, 4U);  // One per combination of the steps, not one per scene
+    EXPECT_EQ(cct.hits() + cct.misses(), 1000U);
+    EXPECT_EQ(cct.misses(), calls);
+    EXPECT_GT(cct.hitRate(), 0.99f);
+
+    // Different settings are different keys
+    auto d  = make_data(4000, 1200, 1500, 1000);
+    d.atime = 0xC0;
+    cct(d);
+    const auto before = calls;
+    d.gain            = Gain::Controlx16;
+    cct(d);
+    EXPECT_EQ(calls, before + 1);
+    cct(d);
+    EXPECT_EQ(calls, before + 1);
+
+    // Invalidation
+    cct.invalidate();
+    cct(d);
+    EXPECT_EQ(calls, before + 2);
+    EXPECT_FALSE(cct.sync(0));
+    EXPECT_TRUE(cct.sync(1));
+    EXPECT_FALSE(cct.sync(1));
+    cct(d);
+    EXPECT_EQ(calls, before + 3);
+    cct.resetStatistics();
+    EXPECT_EQ(cct.hits(), 0U);
+    EXPECT_FLOAT_EQ(cct.hitRate(), 0.0f);
+
+    // Exact keys with many collisions always return the result of the sample
+    auto sum = memo::make_cache<8, 0>([](const Data& d) { return d.C16() + d.R16() + d.G16() + d.B16(); });
+    for (int i = 0; i < 1000; ++i) {
+        const auto v = make_data(rng() & 0x3F, rng() & 0x3, rng() & 0x3, 0);
+        EXPECT_EQ(sum(v), v.C16() + v.R16() + v.G16() + v.B16());
+    }
+    EXPECT_GT(sum.hits(), 0U);
+    EXPECT_GT(sum.misses(), 8U);
+
+    // Benchmark
+    std::vector<Data> src(256, make_data(4000, 1200, 1500, 1000));
+    float acc{};
+    auto start = m5::utility::micros();
+    for (auto&& s : src) {
+        acc += calculateColorTemperature(s);
+    }
+    auto direct = m5::utility::micros() - start;
+    start       = m5::utility::micros();
+    for (auto&& s : src) {
+        acc += cct(s);
+    }
+    auto cached = m5::utility::micros() - start;
+    M5_LOGI("Direct:%lu us Cached:%lu us (%u samples) %f", (unsigned long)direct, (unsigned long)cached,
+            (unsigned)src.size(), acc);
+}
+
+TEST(CrossCore, Ring)
+{
+    crosscore::Ring<uint32_t, 8> ring{};
+    EXPECT_EQ(ring.capacity(), 8U);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.space(), 8U);
+
+    uint32_t v{};
+    EXPECT_FALSE(ring.pop(v));
+    for (uint32_t i = 0; i < 8; ++i) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    EXPECT_FALSE(ring.push(8));
+    EXPECT_EQ(ring.size(), 8U);
+    EXPECT_EQ(ring.space(), 0U);
+
+    uint32_t buf[8]{};
+    EXPECT_EQ(ring.pop(buf, 5), 5U);
+    for (uint32_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(buf[i], i);
+    }
+
+    // Batch over the wrap
+    const uint32_t src[6]{100, 101, 102, 103, 104, 105};
+    EXPECT_EQ(ring.push(src, 6), 5U);
+    EXPECT_EQ(ring.size(), 8U);
+    EXPECT_EQ(ring.pop(buf, 8), 8U);
+    const uint32_t expected[8]{5, 6, 7, 100, 101, 102, 103, 104};
+    for (uint32_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(buf[i], expected[i]);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(CrossCore, Stage)
+{
+    crosscore::Ring<Data, 16> input{};
+    for (uint16_t i = 0; i < 12; ++i) {
+        EXPECT_TRUE(input.push(make_data(1000 + i, 100, 200, 300)));
+    }
+
+    // Conversion and classification, connected by the rings
+    auto clear = [](const Data& d) { return d.C16(); };
+    auto odd   = [](const uint16_t& c) { return (c & 1) != 0; };
+    crosscore::Stage<Data, decltype(clear), 8, 16> convert{input, clear, 4};
+    crosscore::Stage<uint16_t, decltype(odd), 4, 8> classify{convert.output(), odd, 8};
+    static_assert(std::is_same<decltype(convert)::value_type, uint16_t>::value, "Deduced from the processing");
+
+    EXPECT_EQ(convert.process(), 4U);
+    EXPECT_EQ(convert.metrics().backlog, 12U);
+    EXPECT_EQ(convert.process(), 4U);
+    // Back pressure, the output is full
+    EXPECT_EQ(convert.process(), 0U);
+    EXPECT_EQ(input.size(), 4U);
+    EXPECT_EQ(convert.metrics().batches, 2U);
+
+    // Batch is limited by the capacity of the output
+    EXPECT_EQ(classify.process(), 4U);
+    EXPECT_EQ(classify.process(), 0U);
+
+    bool b{};
+    uint16_t c{1000};
+    while (classify.output().pop(b)) {
+        EXPECT_EQ(b, (c++ & 1) != 0);
+    }
+    // Drain all
+    size_t total{};
+    while (convert.process() + classify.process()) {
+        while (classify.output().pop(b)) {
+            EXPECT_EQ(b, (c++ & 1) != 0);
+            ++total;
+        }
+    }
+    EXPECT_EQ(c, 1012U);
+    EXPECT_EQ(convert.metrics().items, 12U);
+    EXPECT_EQ(classify.metrics().items, 12U);
+    EXPECT_EQ(convert.metrics().max_backlog, 12U);
+    EXPECT_EQ(convert.metrics().dropped, 0U);
+    EXPECT_TRUE(input.empty());
+}
+
+TEST(SoA, SensorArray)
+{
+    constexpr soa::Chromaticity palette[] = {
+        {0.6f, 0.2f, 0.2f},
+        {0.2f, 0.6f, 0.2f},
+        {0.2f, 0.2f, 0.6f},
+    };
+    soa::SensorArray<16> sensors{};
+    sensors.setPalette(palette, 3, 0.05f);
+
+    // Reference of the scalar path
+    std::vector<Data> src{};
+    std::vector<DerivedConstants> ks{};
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < 12; ++i) {
+        // Colors of the palette with IR offset, and random ones
+        const uint16_t v = 1000 + (rng() & 0x3FF), ir = rng() & 0x7F;
+        const uint16_t base[3][3] = {{3, 1, 1}, {1, 3, 1}, {1, 1, 3}};
+        const auto& w   = base[i % 3];
+        const uint16_t r = (i < 9) ? v * w[0] / 5 + ir : rng() & 0xFFF;
+        const uint16_t g = (i < 9) ? v * w[1] / 5 + ir : rng() & 0xFFF;
+        const uint16_t b = (i < 9) ? v * w[2] / 5 + ir : rng() & 0xFFF;
+        auto d           = make_data(r + g + b - 2 * ir, r, g, b);
+        d.atime          = (i & 1) ? 0xC0 : 0x00;
+        d.gain           = gain_table[i & 3];
+        src.push_back(d);
+        ks.push_back(calculateDerivedConstants(d.atime, d.gain));
+        sensors.set(i, d, ks.back());
+    }
+    // Doubles red of sensor 3 (green class), then more red than green
+    const soa::Matrix red2{{2.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f}};
+    EXPECT_TRUE(sensors.setMatrix(3, red2));
+    EXPECT_FALSE(sensors.setMatrix(12, red2));
+    EXPECT_EQ(sensors.size(), 12U);
+    EXPECT_EQ(sensors.present(), 0x0FFFU);
+    EXPECT_EQ(sensors.saturated(), 0U);
+
+    sensors.process();
+    for (size_t i = 0; i < src.size(); ++i) {
+        SCOPED_TRACE(i);
+        const auto& d = src[i];
+        EXPECT_FLOAT_EQ(sensors.lux()[i], calculateLux(d, ks[i]));
+        const float ir = (d.R16() + d.G16() + d.B16() - d.C16()) * 0.5f;
+        const float r  = std::max(d.R16() - ir, 0.0f) * (i == 3 ? 2.0f : 1.0f);
+        EXPECT_FLOAT_EQ(sensors.red()[i], r);
+        EXPECT_FLOAT_EQ(sensors.green()[i], std::max(d.G16() - ir, 0.0f));
+        EXPECT_FLOAT_EQ(sensors.blue()[i], std::max(d.B16() - ir, 0.0f));
+        if (i < 9 && i != 3) {
+            EXPECT_EQ(sensors.classes()[i], i % 3);
+        }
+    }
+    EXPECT_EQ(sensors.classes()[3], soa::UNKNOWN);
+
+    // No sample and dark
+    sensors.clear(5);
+    sensors.set(6, make_data(0, 0, 0, 0), ks[6]);
+    // Saturated
+    auto sat  = make_data(0xFFFF, 0x8000, 0x8000, 0x8000);
+    sat.atime = 0xC0;
+    sensors.set(7, sat, calculateDerivedConstants(0xC0, Gain::Controlx1));
+    sensors.process();
+    EXPECT_EQ(sensors.present(), 0x0FDFU);
+    EXPECT_EQ(sensors.saturated(), 1U << 7);
+    EXPECT_EQ(sensors.classes()[5], soa::UNKNOWN);
+    EXPECT_EQ(sensors.classes()[6], soa::UNKNOWN);
+    EXPECT_FLOAT_EQ(sensors.lux()[5], 0.0f);
+    EXPECT_EQ(sensors.frames(), 2U);
+
+    // Units mixed with the samples set directly
+    {
+        soa::SensorArray<4> mixed{};
+        mixed.set(1, src[0], ks[0]);
+        EXPECT_EQ(mixed.size(), 2U);
+        EXPECT_EQ(mixed.collect(), 0U);  // No unit at 0 and 1
+        EXPECT_EQ(mixed.present(), 1U << 1);
+
+        UnitTCS34725 u[4];
+        EXPECT_TRUE(mixed.add(u[0]));  // Takes 0
+        EXPECT_EQ(mixed.size(), 2U);
+        EXPECT_TRUE(mixed.add(u[1]));  // Takes 1
+        EXPECT_TRUE(mixed.add(u[2]));
+        EXPECT_EQ(mixed.size(), 3U);
+        EXPECT_TRUE(mixed.add(u[3]));
+        EXPECT_FALSE(mixed.add(u[0]));  // Full
+        EXPECT_EQ(mixed.size(), 4U);
+        EXPECT_EQ(mixed.collect(), 0U);  // Units without any sample
+        EXPECT_EQ(mixed.present(), 0U);
+    }
+
+    // Benchmark
+    auto start = m5::utility::micros();
+    float acc{};
+    for (size_t i = 0; i < src.size(); ++i) {
+        acc += calculateLux(src[i], ks[i]) + calculateColorTemperature(src[i]);
+    }
+    auto scalar = m5::utility::micros() - start;
+    sensors.process();
+    M5_LOGI("Scalar:%lu us SoA frame:%u us (%u sensors) %f", (unsigned long)scalar, sensors.frameUs(),
+            (unsigned)sensors.size(), acc);
+}
@@ -0,0 +1,435 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+#
+# SPDX-License-Identifier: MIT
+r"""
+Columnar dataset of recorded m5::unit::tcs3472x::Data streams.
+
+Recordings (text or binary) are converted into a columnar, block-compressed
+file that can be memory-mapped. Each block holds up to --block-rows rows per
+column, with the min/max of every column in the footer, so range scans on the
+time or on any value skip the blocks that can not match without reading them.
+
+A sample is recorded as the 12 bytes of the measurement fields of Data, in
+this order: raw[8] (C/R/G/B little endian), atime, gain, flags and channels.
+The rest of Data (the IR cache, sizeof(Data) is 20) is not recorded.
+
+Record the stream as text, one sample per line made of "COLOR:", the unit id,
+millis() and the 24 hex digits of those 12 bytes, and nothing else:
+
+  const auto& d = unit.latest();
+  Serial.printf("COLOR:%u,%lu,", unit_id, (unsigned long)unit.updatedMillis());
+  for (auto v : d.raw) { Serial.printf("%02x", v); }
+  Serial.printf("%02x%02x%02x%02x\n", d.atime, (uint8_t)d.gain, d.flags, d.channels);
+
+or as binary, 17-byte packed records of uint32 millis, uint8 unit id and the
+12 bytes above. A binary file whose size is not a multiple of 17 is rejected.
+
+Usage:
+  color_dataset.py write serial.log [more.log ...] -o rec.ccol [--codec zlib|plain]
+  color_dataset.py write --binary rec.bin -o rec.ccol
+  color_dataset.py info rec.ccol
+  color_dataset.py scan rec.ccol --from 60000 --to 120000 --where c=100:4000 --where unit=2 > out.csv
+
+File layout (little endian):
+  header  "M5CCOL" u16 version, u32 block rows, u32 number of columns, then per column
+          u8 name length, name, u8 type code ("B", "H", "Q")
+  blocks  per block and column a chunk, 8-byte aligned
+          plain: the array as is (memoryview.cast() of the mapped file, no copy)
+          zlib:  byte-shuffled array (timestamp delta encoded) compressed by zlib
+  footer  per block u32 rows, then per column u64 offset, u32 stored size, u8 codec, i64 min, i64 max
+          u32 number of blocks, u64 footer offset, "M5CEND"
+"""
+
+import argparse
+import array
+import csv
+import mmap
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = b"M5CCOL"
+END_MAGIC = b"M5CEND"
+VERSION = 1
+
+# Name and array type code. Same order as the fields of the record
+COLUMNS = [
+    ("timestamp", "Q"),  # millis() unwrapped
+    ("unit", "B"),
+    ("c", "H"),
+    ("r", "H"),
+    ("g", "H"),
+    ("b", "H"),
+    ("atime", "B"),
+    ("gain", "B"),  # Gain (0:x1 1:x4 2:x16 3:x60)
+    ("flags", "B"),
+    ("channels", "B"),
+]
+COLUMN_INDEX = {name: i for i, (name, _) in enumerate(COLUMNS)}
+
+CODEC_PLAIN = 0
+CODEC_ZLIB = 1
+CODECS = {"plain": CODEC_PLAIN, "zlib": CODEC_ZLIB}
+
+DATA = struct.Struct("<4HBBBB")  # raw[8] as C/R/G/B, atime, gain, flags, channels (not sizeof(Data))
+RECORD = struct.Struct("<IB")  # millis, unit id (followed by DATA)
+FOOTER_BLOCK = struct.Struct("<I")
+FOOTER_CHUNK = struct.Struct("<QIBqq")
+TRAILER = struct.Struct("<IQ6s")
+LINE = re.compile(r"^COLOR:(\d+),(\d+),([0-9a-fA-F]{24})\r?$", re.MULTILINE)
+
+if sys.byteorder != "little":
+    raise SystemExit("Little endian host is required")
+
+
+# ---------------------------------------------------------------------------
+# Input
+def parse_text(text):
+    for m in LINE.finditer(text):
+        yield int(m.group(2)), int(m.group(1)), bytes.fromhex(m.group(3))
+
+
+def check_binary_size(length):
+    size = RECORD.size + DATA.size
+    if length % size:
+        raise ValueError("%u bytes is not a multiple of the %u-byte record" % (length, size))
+
+
+def parse_binary(data):
+    check_binary_size(len(data))
+    size = RECORD.size + DATA.size
+    return ((*RECORD.unpack_from(data, off), data[off + RECORD.size : off + size]) for off in range(0, len(data), size))
+
+
+def to_rows(records):
+    prev = {}
+    wrap = {}
+    for ms, uid, raw in records:
+        # millis() is 32-bit on the target, unwrapped per unit
+        if uid in prev and ms < prev[uid] and prev[uid] - ms > 0x80000000:
+            wrap[uid] = wrap.get(uid, 0) + (1 << 32)
+        prev[uid] = ms
+        c, r, g, b, atime, gain, flags, channels = DATA.unpack(raw)
+        yield (ms + wrap.get(uid, 0), uid, c, r, g, b, atime, gain, flags, channels)
+
+
+# ---------------------------------------------------------------------------
+# Chunk encoding
+def shuffle(raw, width):
+    # Byte planes compress far better than interleaved little endian values
+    if width == 1:
+        return raw
+    return b"".join(raw[i::width] for i in range(width))
+
+
+def unshuffle(data, width):
+    if width == 1:
+        return data
+    n = len(data) // width
+    out = bytearray(len(data))
+    for i in range(width):
+        out[i::width] = data[i * n : (i + 1) * n]
+    return bytes(out)
+
+
+def encode(values, code, codec, level):
+    if codec == CODEC_PLAIN:
+        return values.tobytes()
+    if code == "Q":
+        # Timestamps are monotonic in practice, deltas are small
+        deltas = array.array("Q", values)
+        for i in range(len(deltas) - 1, 0, -1):
+            deltas[i] = (values[i] - values[i - 1]) & 0xFFFFFFFFFFFFFFFF
+        values = deltas
+    return zlib.compress(shuffle(values.tobytes(), values.itemsize), level)
+
+
+def decode(data, code, codec, rows):
+    if codec == CODEC_PLAIN:
+        return data.cast(code) if isinstance(data, memoryview) else array.array(code, data)
+    out = array.array(code)
+    out.frombytes(unshuffle(zlib.decompress(data), out.itemsize))
+    if code == "Q":
+        for i in range(1, rows):
+            out[i] = (out[i] + out[i - 1]) & 0xFFFFFFFFFFFFFFFF
+    return out
+
+
+# ---------------------------------------------------------------------------
+# Writer
+class Writer:
+    """Streaming writer, rows are buffered up to a block"""
+
+    def __init__(self, path, block_rows=65536, codec="zlib", level=6):
+        if codec not in CODECS:
+            raise ValueError("Unknown codec %s" % codec)
+        self._f = open(path, "wb")
+        self._block_rows = block_rows
+        self._codec = CODECS[codec]
+        self._level = level
+        self._columns = [array.array(code) for _, code in COLUMNS]
+        self._blocks = []
+        self.rows = 0
+        header = bytearray(MAGIC + struct.pack("<HII", VERSION, block_rows, len(COLUMNS)))
+        for name, code in COLUMNS:
+            header += struct.pack("<B", len(name)) + name.encode() + code.encode()
+        self._f.write(header)
+        self._align()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    @property
+    def num_blocks(self):
+        return len(self._blocks)
+
+    def _align(self):
+        pad = -self._f.tell() % 8
+        if pad:
+            self._f.write(b"\0" * pad)
+
+    def append(self, row):
+        for col, v in zip(self._columns, row):
+            col.append(v)
+        if len(self._columns[0]) >= self._block_rows:
+            self.flush()
+
+    def flush(self):
+        rows = len(self._columns[0])
+        if not rows:
+            return
+        chunks = []
+        for (_, code), values in zip(COLUMNS, self._columns):
+            data = encode(values, code, self._codec, self._level)
+            offset = self._f.tell()
+            self._f.write(data)
+            self._align()
+            chunks.append((offset, len(data), self._codec, min(values), max(values)))
+        self._blocks.append((rows, chunks))
+        self.rows += rows
+        self._columns = [array.array(code) for _, code in COLUMNS]
+
+    def close(self):
+        if self._f.closed:
+            return
+        self.flush()
+        footer_at = self._f.tell()
+        for rows, chunks in self._blocks:
+            self._f.write(FOOTER_BLOCK.pack(rows))
+            for chunk in chunks:
+                self._f.write(FOOTER_CHUNK.pack(*chunk))
+        self._f.write(TRAILER.pack(len(self._blocks), footer_at, END_MAGIC))
+        self._f.close()
+
+
+# ---------------------------------------------------------------------------
+# Reader
+class Block:
+    def __init__(self, rows, chunks):
+        self.rows = rows
+        self.chunks = chunks  # (offset, size, codec, min, max) per column
+
+    def range(self, name):
+        _, _, _, lo, hi = self.chunks[COLUMN_INDEX[name]]
+        return lo, hi
+
+    def overlaps(self, name, lo, hi):
+        blo, bhi = self.range(name)
+        return (lo is None or bhi >= lo) and (hi is None or blo <= hi)
+
+
+class Reader:
+    """Memory-mapped reader. Plain chunks are returned as views of the mapping without copy"""
+
+    def __init__(self, path):
+        self._f = open(path, "rb")
+        self._mm = mmap.mmap(self._f.fileno(), 0, access=mmap.ACCESS_READ)
+        self._view = memoryview(self._mm)
+        if self._mm[: len(MAGIC)] != MAGIC:
+            raise ValueError("Not a color dataset")
+        version, self.block_rows, num = struct.unpack_from("<HII", self._mm, len(MAGIC))
+        if version != VERSION:
+            raise ValueError("Unsupported version %u" % version)
+        off = len(MAGIC) + 10
+        columns = []
+        for _ in range(num):
+            n = self._mm[off]
+            columns.append((self._mm[off + 1 : off + 1 + n].decode(), chr(self._mm[off + 1 + n])))
+            off += 2 + n
+        if columns != COLUMNS:
+            raise ValueError("Unsupported columns")
+
+        nblocks, footer_at, end = TRAILER.unpack_from(self._mm, len(self._mm) - TRAILER.size)
+        if end != END_MAGIC:
+            raise ValueError("Truncated file (not closed?)")
+        self.blocks = []
+        off = footer_at
+        for _ in range(nblocks):
+            (rows,) = FOOTER_BLOCK.unpack_from(self._mm, off)
+            off += FOOTER_BLOCK.size
+            chunks = []
+            for _ in COLUMNS:
+                chunks.append(FOOTER_CHUNK.unpack_from(self._mm, off))
+                off += FOOTER_CHUNK.size
+            self.blocks.append(Block(rows, chunks))
+        self.rows = sum(b.rows for b in self.blocks)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self._view.release()
+        self._mm.close()
+        self._f.close()
+
+    def column(self, block, name):
+        """
+        Values of the column in the block (memoryview for plain, array for zlib)
+        Views of plain chunks must be released (or deleted) before close()
+        """
+        i = COLUMN_INDEX[name]
+        offset, size, codec, _, _ = block.chunks[i]
+        data = self._view[offset : offset + size]
+        return decode(data if codec == CODEC_PLAIN else bytes(data), COLUMNS[i][1], codec, block.rows)
+
+    def scan(self, columns=None, ranges=None):
+        """
+        Yield (block, {name: values}) of the blocks that may match
+        ranges: {name: (lo, hi)}, inclusive, None for unbounded.
+        Blocks are skipped by the statistics only, filter the rows with select()
+        """
+        columns = columns or [name for name, _ in COLUMNS]
+        ranges = ranges or {}
+        for block in self.blocks:
+            if all(block.overlaps(name, lo, hi) for name, (lo, hi) in ranges.items()):
+                yield block, {name: self.column(block, name) for name in columns}
+
+    def select(self, columns=None, ranges=None):
+        """Yield the rows (tuples of columns) matching ranges"""
+        columns = columns or [name for name, _ in COLUMNS]
+        ranges = ranges or {}
+        need = list(columns) + [n for n in ranges if n not in columns]
+        for block, values in self.scan(need, ranges):
+            # Columns fully inside the range need no check
+            checks = [
+                (values[n], lo, hi)
+                for n, (lo, hi) in ranges.items()
+                if not ((lo is None or block.range(n)[0] >= lo) and (hi is None or block.range(n)[1] <= hi))
+            ]
+            out = [values[n] for n in columns]
+            for i in range(block.rows):
+                if all((lo is None or v[i] >= lo) and (hi is None or v[i] <= hi) for v, lo, hi in checks):
+                    yield tuple(c[i] for c in out)
+
+
+# ---------------------------------------------------------------------------
+# Commands
+def parse_range(s):
+    name, _, spec = s.partition("=")
+    if name not in COLUMN_INDEX:
+        raise argparse.ArgumentTypeError("Unknown column %s" % name)
+    lo, sep, hi = spec.partition(":")
+    if not sep:
+        hi = lo
+    return name, (int(lo, 0) if lo else None, int(hi, 0) if hi else None)
+
+
+def cmd_write(args):
+    if args.binary:
+        # Before the output is created
+        for path in args.input:
+            try:
+                check_binary_size(os.path.getsize(path))
+            except ValueError as e:
+                raise SystemExit("%s: %s" % (path, e))
+    with Writer(args.output, args.block_rows, args.codec, args.level) as w:
+        for path in args.input:
+            if args.binary:
+                with open(path, "rb") as f:
+                    records = parse_binary(f.read())
+            else:
+                with open(path, "r", errors="replace") as f:
+                    records = parse_text(f.read())
+            for row in to_rows(records):
+                w.append(row)
+    print("%u rows, %u blocks" % (w.rows, w.num_blocks), file=sys.stderr)
+    return 0
+
+
+def cmd_info(args):
+    with Reader(args.input) as r:
+        print("rows: %u blocks: %u block rows: %u" % (r.rows, len(r.blocks), r.block_rows))
+        for i, (name, code) in enumerate(COLUMNS):
+            stored = sum(b.chunks[i][1] for b in r.blocks)
+            raw = r.rows * array.array(code).itemsize
+            lo = min((b.chunks[i][3] for b in r.blocks), default=0)
+            hi = max((b.chunks[i][4] for b in r.blocks), default=0)
+            ratio = raw / stored if stored else 0.0
+            print("%-10s %s min:%-12d max:%-12d stored:%-10u ratio:%.1f" % (name, code, lo, hi, stored, ratio))
+    return 0
+
+
+def cmd_scan(args):
+    ranges = dict(args.where or [])
+    if args.t_from is not None or args.t_to is not None:
+        ranges["timestamp"] = (args.t_from, args.t_to)
+    columns = args.columns.split(",") if args.columns else None
+    for name in columns or []:
+        if name not in COLUMN_INDEX:
+            raise SystemExit("Unknown column %s" % name)
+    with Reader(args.input) as r:
+        out = csv.writer(sys.stdout)
+        out.writerow(columns or [name for name, _ in COLUMNS])
+        count = 0
+        for row in r.select(columns, ranges):
+            out.writerow(row)
+            count += 1
+        read = sum(1 for b in r.blocks if all(b.overlaps(n, lo, hi) for n, (lo, hi) in ranges.items()))
+        print("%u rows, %u/%u blocks read" % (count, read, len(r.blocks)), file=sys.stderr)
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="command", required=True)
+
+    w = sub.add_parser("write", help="Convert recordings into a dataset")
+    w.add_argument("input", nargs="+", help="Text logs (COLOR: lines) or binary dumps")
+    w.add_argument("--binary", action="store_true", help="Inputs are binary records")
+    w.add_argument("-o", "--output", required=True, help="Output dataset")
+    w.add_argument("--block-rows", type=int, default=65536, help="Rows per block (default: 65536)")
+    w.add_argument("--codec", choices=sorted(CODECS), default="zlib", help="Chunk codec (default: zlib)")
+    w.add_argument("--level", type=int, default=6, help="zlib level (default: 6)")
+    w.set_defaults(func=cmd_write)
+
+    i = sub.add_parser("info", help="Show the blocks and the column statistics")
+    i.add_argument("input", help="Dataset")
+    i.set_defaults(func=cmd_info)
+
+    s = sub.add_parser("scan", help="Output the matching rows as CSV")
+    s.add_argument("input", help="Dataset")
+    s.add_argument("--from", dest="t_from", type=int, help="Minimum timestamp (ms)")
+    s.add_argument("--to", dest="t_to", type=int, help="Maximum timestamp (ms)")
+    s.add_argument(
+        "--where", action="append", type=parse_range, help="Range of the column, name=lo:hi (inclusive) or name=v"
+    )
+    s.add_argument("--columns", help="Comma separated columns to output (default: all)")
+    s.set_defaults(func=cmd_scan)
+
+    args = ap.parse_args()
+    if getattr(args, "block_rows", 1) < 1:
+        ap.error("--block-rows must be positive")
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,398 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+#
+# SPDX-License-Identifier: MIT
+"""
+Export a color classification model to a C++ header for
+m5::unit::tcs3472x::inference (src/utility/unit_color_inference.hpp).
+
+The model is quantized to int8 and evaluated here with the same integer
+arithmetic as the device, so the expected classes written to the header
+are bit-exact references for the host/device test. The int8 features and
+the output scores (MLP logits or forest votes) of each sample are written
+as well, so the test checks every step, not only the argmax.
+Malformed models (feature or node index out of range) are rejected here,
+and the header static_asserts the array sizes and DecisionForest::valid().
+
+Usage:
+  color_model_export.py export model.json -o model.hpp [--namespace ns]
+  color_model_export.py export --sklearn model.pkl --samples raw.csv -o model.hpp
+  color_model_export.py features raw.csv > features.csv
+
+Model JSON:
+  {
+    "name": "sorter",
+    "classes": ["glossy", "matte"],
+    "type": "mlp",              # or "forest"
+    "mlp": {"w1": [[...8...], ...], "b1": [...], "w2": [[...H...], ...], "b2": [...]},
+    "forest": {"trees": [{"feature": "RatioR", "threshold": 0.31,
+                          "left": {"class": 0}, "right": {"class": 1}}]},
+    "samples": [[C, R, G, B, ATIME, GAIN_INDEX], ...]
+  }
+
+Inputs of the model are the real features (q + 128) / 256 where q is the
+int8 feature produced by extractFeatures(). Use the "features" command to
+produce training data with exactly that definition.
+"""
+
+import argparse
+import csv
+import json
+import math
+import pickle
+import sys
+
+FEATURES = ["RatioR", "RatioG", "RatioB", "RatioRnoIR", "RatioGnoIR", "RatioBnoIR", "CRATIO", "LogLux"]
+GAIN_TABLE = [1, 4, 16, 60]
+
+
+# ---------------------------------------------------------------------------
+# Feature extraction (mirror of extractFeatures)
+def _clamp16(v):
+    return max(min(v, 0xFFFF), 0)
+
+
+def _ratio_q8(v, c):
+    if c <= 0 or v <= 0:
+        return -128
+    return min((v << 8) // c, 255) - 128
+
+
+def _trunc_div2(v):
+    # C++ integer division (truncates toward zero)
+    return v // 2 if v >= 0 else -((-v) // 2)
+
+
+def log2_q3(v):
+    if v == 0:
+        return 0
+    p = v.bit_length() - 1
+    frac = ((v >> (p - 3)) if p >= 3 else (v << (3 - p))) & 0x07
+    return p * 8 + frac
+
+
+def extract_features(c, r, g, b, atime, gain):
+    ir = _trunc_div2(r + g + b - c)
+    rn, gn, bn, cn = _clamp16(r - ir), _clamp16(g - ir), _clamp16(b - ir), _clamp16(c - ir)
+    f = [
+        _ratio_q8(r, c),
+        _ratio_q8(g, c),
+        _ratio_q8(b, c),
+        _ratio_q8(rn, cn),
+        _ratio_q8(gn, cn),
+        _ratio_q8(bn, cn),
+        _ratio_q8(ir, c),
+    ]
+    g2 = 139 * (r - ir) + 1024 * (g - ir) - 455 * (b - ir)
+    lux = 0
+    if g2 > 0:
+        lux = (g2 * 3100) // (1024 * 24 * (256 - atime) * GAIN_TABLE[gain & 3])
+    f.append(log2_q3(lux + 1) - 128)
+    return f
+
+
+def real_features(q):
+    return [(v + 128) / 256.0 for v in q]
+
+
+# ---------------------------------------------------------------------------
+# MLP
+def _quantize_symmetric(values):
+    m = max((abs(v) for v in values), default=0.0)
+    scale = m / 127.0 if m > 0 else 1.0
+    return scale, [int(max(min(round(v / scale), 127), -127)) for v in values]
+
+
+def _multiplier_shift(real):
+    # real ~= multiplier / 2^shift, multiplier in [2^14, 2^15)
+    if real <= 0:
+        return 0, 0
+    shift = 0
+    while real * (1 << shift) < (1 << 14) and shift < 62:
+        shift += 1
+    while real * (1 << shift) >= (1 << 15) and shift > 0:
+        shift -= 1
+    return int(round(real * (1 << shift))), shift
+
+
+def quantize_mlp(mlp, samples):
+    w1, b1, w2, b2 = mlp["w1"], mlp["b1"], mlp["w2"], mlp["b2"]
+    n_in, n_hidden, n_out = len(w1[0]), len(w1), len(w2)
+    if n_in != len(FEATURES):
+        raise ValueError("MLP input must be %d features" % len(FEATURES))
+
+    s_w1, w1q_flat = _quantize_symmetric([v for row in w1 for v in row])
+    w1q = [w1q_flat[j * n_in:(j + 1) * n_in] for j in range(n_hidden)]
+    s_acc1 = s_w1 / 256.0
+    # Fold input zero point (+128) into the bias
+    b1q = [int(round(b1[j] / s_acc1)) + 128 * sum(w1q[j]) for j in range(n_hidden)]
+
+    # Hidden activation range from samples (or a conservative bound)
+    hmax = 0.0
+    if samples:
+        for s in samples:
+            x = real_features(extract_features(*s))
+            for j in range(n_hidden):
+                hmax = max(hmax, sum(w * v for w, v in zip(w1[j], x)) + b1[j])
+    if hmax <= 0:
+        hmax = max(sum(abs(w) for w in w1[j]) + abs(b1[j]) for j in range(n_hidden))
+    s_h = hmax / 127.0
+    mult, shift = _multiplier_shift(s_acc1 / s_h)
+
+    s_w2, w2q_flat = _quantize_symmetric([v for row in w2 for v in row])
+    w2q = [w2q_flat[k * n_hidden:(k + 1) * n_hidden] for k in range(n_out)]
+    b2q = [int(round(b2[k] / (s_w2 * s_h))) for k in range(n_out)]
+    return {"w1": w1q, "b1": b1q, "mult": mult, "shift": shift, "w2": w2q, "b2": b2q}
+
+
+def mlp_evaluate(q, x):
+    rounding = (1 << (q["shift"] - 1)) if q["shift"] > 0 else 0
+    h = []
+    for j, row in enumerate(q["w1"]):
+        acc = q["b1"][j] + sum(w * v for w, v in zip(row, x))
+        v = (acc * q["mult"] + rounding) >> q["shift"]
+        h.append(max(min(v, 127), 0))
+    return [q["b2"][k] + sum(w * v for w, v in zip(row, h)) for k, row in enumerate(q["w2"])]
+
+
+def argmax(values):
+    # Lowest index wins a tie (same as classify())
+    best = 0
+    for k in range(1, len(values)):
+        if values[k] > values[best]:
+            best = k
+    return best
+
+
+def mlp_classify(q, x):
+    return argmax(mlp_evaluate(q, x))
+
+
+# ---------------------------------------------------------------------------
+# Forest
+def _feature_index(f):
+    idx = FEATURES.index(f) if isinstance(f, str) else int(f)
+    if not 0 <= idx < len(FEATURES):
+        raise ValueError("Feature index out of range: %s" % f)
+    return idx
+
+
+def _quantize_threshold(t):
+    # x_real <= t  <=>  q <= floor(t * 256) - 128
+    return int(max(min(math.floor(t * 256.0) - 128, 127), -128))
+
+
+def quantize_forest(forest, n_out):
+    nodes, roots, depth = [], [], 0
+
+    def emit(n, d):
+        nonlocal depth
+        depth = max(depth, d)
+        idx = len(nodes)
+        nodes.append(None)
+        if "class" in n:
+            if not 0 <= int(n["class"]) < n_out:
+                raise ValueError("Class index out of range: %s" % n["class"])
+            nodes[idx] = (0xFF, 0, int(n["class"]), 0)
+        else:
+            left = emit(n["left"], d + 1)
+            right = emit(n["right"], d + 1)
+            nodes[idx] = (_feature_index(n["feature"]), _quantize_threshold(n["threshold"]), left, right)
+        return idx
+
+    for t in forest["trees"]:
+        roots.append(emit(t, 0))
+    if len(nodes) > 0xFFFF:
+        raise ValueError("Too many nodes")
+    return {"nodes": nodes, "roots": roots, "depth": depth + 1}
+
+
+def forest_evaluate(q, x, n_out):
+    votes = [0] * n_out
+    for root in q["roots"]:
+        n = q["nodes"][root]
+        depth = 0
+        while n[0] != 0xFF and depth < q["depth"]:
+            depth += 1
+            n = q["nodes"][n[2] if x[n[0]] <= n[1] else n[3]]
+        if n[0] == 0xFF and n[2] < n_out:
+            votes[n[2]] += 1
+    return votes
+
+
+def forest_classify(q, x, n_out):
+    return argmax(forest_evaluate(q, x, n_out))
+
+
+# ---------------------------------------------------------------------------
+# scikit-learn
+def from_sklearn(path):
+    with open(path, "rb") as f:
+        clf = pickle.load(f)
+    classes = [str(c) for c in clf.classes_]
+    name = type(clf).__name__
+    if name == "MLPClassifier":
+        if len(clf.coefs_) != 2 or clf.activation != "relu":
+            raise ValueError("Only one hidden layer with relu is supported")
+        w1 = [list(col) for col in zip(*clf.coefs_[0].tolist())]
+        w2 = [list(col) for col in zip(*clf.coefs_[1].tolist())]
+        b1, b2 = clf.intercepts_[0].tolist(), clf.intercepts_[1].tolist()
+        if len(w2) == 1:  # binary (logistic) output
+            w2 = [[0.0] * len(w2[0]), w2[0]]
+            b2 = [0.0, b2[0]]
+        return {"classes": classes, "type": "mlp", "mlp": {"w1": w1, "b1": b1, "w2": w2, "b2": b2}}
+    if name in ("RandomForestClassifier", "DecisionTreeClassifier"):
+        estimators = clf.estimators_ if hasattr(clf, "estimators_") else [clf]
+        trees = []
+        for est in estimators:
+            t = est.tree_
+
+            def walk(i):
+                if t.children_left[i] == t.children_right[i]:
+                    return {"class": int(max(range(len(classes)), key=lambda k: t.value[i][0][k]))}
+                return {
+                    "feature": int(t.feature[i]),
+                    "threshold": float(t.threshold[i]),
+                    "left": walk(t.children_left[i]),
+                    "right": walk(t.children_right[i]),
+                }
+
+            trees.append(walk(0))
+        return {"classes": classes, "type": "forest", "forest": {"trees": trees}}
+    raise ValueError("Unsupported model: %s" % name)
+
+
+def load_samples(path):
+    samples = []
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            try:
+                samples.append([int(v, 0) for v in row[:6]])
+            except ValueError:
+                continue  # header
+    return samples
+
+
+# ---------------------------------------------------------------------------
+# Output
+def _array(ctype, name, values, per_line=16):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "constexpr %s %s[] = {\n%s\n};\n" % (ctype, name, "\n".join(lines))
+
+
+def write_header(model, samples, out, namespace):
+    name = model.get("name", "model")
+    classes = model["classes"]
+    n_out = len(classes)
+    q = []
+    q.append("/*\n * Generated by tools/color_model_export.py. Do not edit.\n */")
+    guard = ("M5_UNIT_COLOR_MODEL_%s_HPP" % name).upper()
+    q.append("#ifndef %s\n#define %s\n" % (guard, guard))
+    q.append("#include <utility/unit_color_inference.hpp>\n")
+    q.append("namespace %s {\n" % namespace)
+    q.append("// Classes: %s" % ", ".join("%u:%s" % (i, c) for i, c in enumerate(classes)))
+    q.append("constexpr size_t %s_classes{%u};\n" % (name, n_out))
+
+    if model["type"] == "mlp":
+        m = quantize_mlp(model["mlp"], samples)
+        n_hidden = len(m["w1"])
+        q.append(_array("int8_t", name + "_w1", [v for row in m["w1"] for v in row], len(FEATURES)))
+        q.append(_array("int32_t", name + "_b1", m["b1"], 8))
+        q.append(_array("int8_t", name + "_w2", [v for row in m["w2"] for v in row], n_hidden))
+        q.append(_array("int32_t", name + "_b2", m["b2"], 8))
+        q.append(
+            "constexpr m5::unit::tcs3472x::inference::QuantizedMLP<%u, %u, %u> %s{\n"
+            "    %s_w1, %s_b1, %d, %d, %s_w2, %s_b2};\n"
+            % (len(FEATURES), n_hidden, n_out, name, name, name, m["mult"], m["shift"], name, name))
+        q.append("static_assert(sizeof(%s_w1) == %u && sizeof(%s_b1) / sizeof(int32_t) == %u, \"Hidden layer size\");"
+                 % (name, len(FEATURES) * n_hidden, name, n_hidden))
+        q.append("static_assert(sizeof(%s_w2) == %u && sizeof(%s_b2) / sizeof(int32_t) == %u, \"Output layer size\");\n"
+                 % (name, n_out * n_hidden, name, n_out))
+        score_type = "int32_t"
+
+        def evaluate(x):
+            return mlp_evaluate(m, x)
+    else:
+        f = quantize_forest(model["forest"], n_out)
+        lines = ["    {%u, %d, %u, %u}," % n for n in f["nodes"]]
+        q.append("constexpr m5::unit::tcs3472x::inference::TreeNode %s_nodes[] = {\n%s\n};\n" %
+                 (name, "\n".join(lines)))
+        q.append(_array("uint16_t", name + "_roots", f["roots"]))
+        q.append("constexpr m5::unit::tcs3472x::inference::DecisionForest<%u, %u> %s{\n"
+                 "    %s_nodes, %s_roots, %u, %u, %u};" %
+                 (len(FEATURES), n_out, name, name, name, len(f["roots"]), f["depth"], len(f["nodes"])))
+        q.append("static_assert(%s.valid(), \"Malformed model\");\n" % name)
+        score_type = "uint16_t"
+
+        def evaluate(x):
+            return forest_evaluate(f, x, n_out)
+
+    if samples:
+        features = [extract_features(*s) for s in samples]
+        scores = [evaluate(x) for x in features]
+        q.append("// Reference samples {C, R, G, B, ATIME, GAIN}, and their features, scores and classes (bit-exact)")
+        rows = ["    {%u, %u, %u, %u, %u, %u}," % tuple(s) for s in samples]
+        q.append("constexpr uint16_t %s_samples[][6] = {\n%s\n};" % (name, "\n".join(rows)))
+        rows = ["    {%s}," % ", ".join(str(v) for v in x) for x in features]
+        q.append("constexpr int8_t %s_features[][%u] = {\n%s\n};" % (name, len(FEATURES), "\n".join(rows)))
+        rows = ["    {%s}," % ", ".join(str(v) for v in x) for x in scores]
+        q.append("constexpr %s %s_scores[][%u] = {\n%s\n};" % (score_type, name, n_out, "\n".join(rows)))
+        q.append(_array("uint8_t", name + "_expected", [argmax(x) for x in scores]))
+
+    q.append("}  // namespace %s\n#endif" % namespace)
+    out.write("\n".join(q) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    ex = sub.add_parser("export", help="Quantize a model and write a C++ header")
+    ex.add_argument("model", nargs="?", help="Model JSON")
+    ex.add_argument("--sklearn", help="Pickled scikit-learn MLPClassifier/RandomForestClassifier")
+    ex.add_argument("--samples", help="CSV of C,R,G,B,ATIME,GAIN used for calibration and reference")
+    ex.add_argument("--name", help="Model name (C++ identifier)")
+    ex.add_argument("--namespace", default="color_model")
+    ex.add_argument("-o", "--output", help="Output header (default stdout)")
+
+    fe = sub.add_parser("features", help="Convert raw CSV (C,R,G,B,ATIME,GAIN[,label]) to real features")
+    fe.add_argument("raw")
+
+    args = ap.parse_args()
+    if args.cmd == "features":
+        w = csv.writer(sys.stdout)
+        w.writerow(FEATURES + ["label"])
+        with open(args.raw, newline="") as f:
+            for row in csv.reader(f):
+                try:
+                    s = [int(v, 0) for v in row[:6]]
+                except ValueError:
+                    continue
+                w.writerow(["%.8f" % v for v in real_features(extract_features(*s))] + row[6:7])
+        return 0
+
+    if args.sklearn:
+        model = from_sklearn(args.sklearn)
+    elif args.model:
+        with open(args.model) as f:
+            model = json.load(f)
+    else:
+        ap.error("model or --sklearn is required")
+    if args.name:
+        model["name"] = args.name
+    samples = load_samples(args.samples) if args.samples else model.get("samples", [])
+
+    if args.output:
+        with open(args.output, "w") as f:
+            write_header(model, samples, f, args.namespace)
+    else:
+        write_header(model, samples, sys.stdout, args.namespace)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+#
+# SPDX-License-Identifier: MIT
+"""
+Flash/RAM footprint report of the library.
+
+Builds the footprint environments in platformio.ini (minimal, typical and
+full feature firmware in tools/footprint), then reports .text/.rodata/.data/
+.bss per object and per symbol of the library from the linker map.
+The library is its own objects plus the out-of-line symbols of the header-only
+modules (m5::unit::tcs3472x namespace) in the objects of the firmware.
+Exits with 1 if a budget in footprint_budget.json is exceeded, or an env
+has no budget. --update records the measured sizes plus a margin as the new
+budget (review the diff and commit it when a change is intended).
+--report-only skips the budgets (the Footprint workflow runs so until the
+budgets are measured on a real build).
+
+Usage:
+  footprint.py                       # Build all footprint_* envs and check
+  footprint.py --no-build            # Use existing build results
+  footprint.py --update              # Build, then record the budgets
+  footprint.py --report-only         # Build and report, no budget check
+  footprint.py -e footprint_Atom_full --symbols 30
+  footprint.py --map firmware.map    # Report an arbitrary map file (no budget)
+
+Categories:
+  text   : .text.* .literal.* .iram* (code in flash and IRAM)
+  rodata : .rodata.* .flash.rodata*
+  data   : .data.* .dram*
+  bss    : .bss.* COMMON
+"""
+
+import argparse
+import configparser
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+from collections import defaultdict
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+DEFAULT_BUDGET = os.path.join(os.path.dirname(os.path.abspath(__file__)), "footprint_budget.json")
+CATEGORIES = ("text", "rodata", "data", "bss")
+
+# Objects of this library
+LIBRARY_PATTERN = re.compile(r"(M5Unit-COLOR|unit_TCS3472x|unit_color_)")
+# Symbols of this library compiled into the other objects (header-only modules and templates instantiated by the
+# firmware): mangled names qualified by m5::unit::tcs3472x or the unit classes, including their vtables, typeinfo,
+# local statics and guards (not the functions of the firmware merely taking the library types)
+LIBRARY_SYMBOL = re.compile(r"^_Z(?:Z|GV|T[VIS])?NK?2m54unit(?:8tcs3472x|12UnitTCS3472[x5])")
+
+# Input section line: " .text.name  0xaddr  0xsize  object" (name may be on the previous line)
+SECTION_LINE = re.compile(r"^\s+(\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+NAME_LINE = re.compile(r"^\s(\S+)$")
+
+
+def categorize(section):
+    for prefix, cat in (
+        (".literal", "text"),
+        (".text", "text"),
+        (".iram", "text"),
+        (".rodata", "rodata"),
+        (".flash.rodata", "rodata"),
+        (".data", "data"),
+        (".dram", "data"),
+        (".bss", "bss"),
+        ("COMMON", "bss"),
+    ):
+        if section.startswith(prefix):
+            return cat
+    return None
+
+
+def symbol_name(section):
+    # -ffunction-sections / -fdata-sections: ".text._ZN..." => "_ZN..."
+    for prefix in (".literal.", ".text.", ".rodata.", ".data.", ".bss.", ".iram1.", ".dram1."):
+        if section.startswith(prefix):
+            return section[len(prefix) :]
+    return section
+
+
+def parse_map(path):
+    """Yield (category, symbol, size, object) of the allocated input sections"""
+    in_memory_map = False
+    pending = None
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+            line = line.rstrip("\n")
+            m = NAME_LINE.match(line)
+            if m and not line.startswith("  "):
+                pending = m.group(1)
+                continue
+            m = SECTION_LINE.match(line)
+            if not m:
+                pending = None
+                continue
+            name = m.group(1) or pending
+            pending = None
+            if not name:
+                continue
+            addr, size, obj = int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()
+            cat = categorize(name)
+            if cat and addr and size:
+                yield cat, symbol_name(name), size, obj
+
+
+def short_object(obj):
+    # ".../libXXX.a(unit_TCS3472x.cpp.o)" => "unit_TCS3472x.cpp.o"
+    m = re.search(r"\(([^)]+)\)$", obj)
+    return m.group(1) if m else os.path.basename(obj)
+
+
+def demangle(names):
+    cxxfilt = shutil.which("c++filt")
+    if not cxxfilt or not names:
+        return names
+    try:
+        out = subprocess.run([cxxfilt], input="\n".join(names), capture_output=True, text=True, check=True).stdout
+        res = out.splitlines()
+        return res if len(res) == len(names) else names
+    except (OSError, subprocess.CalledProcessError):
+        return names
+
+
+def analyze(path):
+    objects = defaultdict(lambda: defaultdict(int))
+    symbols = defaultdict(int)
+    totals = defaultdict(int)
+    firmware = defaultdict(int)
+    for cat, sym, size, obj in parse_map(path):
+        firmware[cat] += size
+        if LIBRARY_PATTERN.search(obj):
+            o = short_object(obj)
+        elif LIBRARY_SYMBOL.search(sym):
+            o = short_object(obj) + " (tcs3472x)"
+        else:
+            continue
+        objects[o][cat] += size
+        symbols[(cat, sym, o)] += size
+        totals[cat] += size
+    return objects, symbols, totals, firmware
+
+
+def report(name, path, num_symbols):
+    objects, symbols, totals, firmware = analyze(path)
+    print("== %s (%s)" % (name, os.path.relpath(path, ROOT)))
+    print("%-40s %8s %8s %8s %8s" % (("object",) + CATEGORIES))
+    for o in sorted(objects, key=lambda k: -sum(objects[k].values())):
+        print("%-40s %8u %8u %8u %8u" % ((o,) + tuple(objects[o][c] for c in CATEGORIES)))
+    print("%-40s %8u %8u %8u %8u" % (("total",) + tuple(totals[c] for c in CATEGORIES)))
+    # Inlined calls are counted in the callers of the firmware
+    print("%-40s %8u %8u %8u %8u" % (("(firmware)",) + tuple(firmware[c] for c in CATEGORIES)))
+    if num_symbols:
+        top = sorted(symbols.items(), key=lambda kv: -kv[1])[:num_symbols]
+        names = demangle([k[1] for k, _ in top])
+        print("-- top %u symbols" % len(top))
+        for ((cat, _, o), size), n in zip(top, names):
+            print("%8u %-6s %-28s %s" % (size, cat, o, n))
+    print()
+    return totals
+
+
+def check_budget(name, totals, budget):
+    limits = budget.get(name)
+    if not limits:
+        print("NO BUDGET %s (record it with --update)" % name)
+        return False
+    ok = True
+    for cat in CATEGORIES:
+        if cat in limits and totals[cat] > limits[cat]:
+            print("BUDGET EXCEEDED %s %s: %u > %u" % (name, cat, totals[cat], limits[cat]))
+            ok = False
+    return ok
+
+
+def measured_budget(totals, margin):
+    # Measured size plus the margin, rounded up to 64 bytes
+    return {cat: (int(totals[cat] * (100 + margin) / 100) + 63) // 64 * 64 for cat in CATEGORIES}
+
+
+def footprint_envs():
+    cfg = configparser.ConfigParser(interpolation=None, strict=False)
+    cfg.read(os.path.join(ROOT, "platformio.ini"))
+    return [s[4:] for s in cfg.sections() if s.startswith("env:footprint_")]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("-e", "--env", action="append", help="Environment (default: all footprint_* envs)")
+    ap.add_argument("--no-build", action="store_true", help="Do not run pio, use existing map files")
+    ap.add_argument("--map", help="Report the map file only")
+    ap.add_argument("--budget", default=DEFAULT_BUDGET, help="Budget JSON")
+    ap.add_argument("--symbols", type=int, default=15, help="Number of top symbols to show (0: none)")
+    ap.add_argument("--update", action="store_true", help="Write the measured sizes to the budget instead of checking")
+    ap.add_argument("--margin", type=int, default=10, help="Margin of --update (percent)")
+    ap.add_argument("--report-only", action="store_true", help="Report without checking the budgets")
+    args = ap.parse_args()
+
+    if args.map:
+        report(os.path.basename(args.map), os.path.abspath(args.map), args.symbols)
+        return 0
+
+    envs = args.env or footprint_envs()
+    with open(args.budget) as f:
+        budget = json.load(f)
+
+    ok = True
+    for env in envs:
+        if not args.no_build:
+            subprocess.run(["pio", "run", "-e", env], cwd=ROOT, check=True)
+        path = os.path.join(ROOT, ".pio", "build", env, "firmware.map")
+        if not os.path.exists(path):
+            print("Map file not found: %s" % path)
+            ok = False
+            continue
+        totals = report(env, path, args.symbols)
+        if args.update:
+            budget[env] = measured_budget(totals, args.margin)
+        elif not args.report_only:
+            ok = check_budget(env, totals, budget) and ok
+    if args.update and ok:
+        with open(args.budget, "w") as f:
+            f.write("{\n")
+            f.write(",\n".join("    %s: %s" % (json.dumps(k), json.dumps(v)) for k, v in budget.items()))
+            f.write("\n}\n")
+        print("Updated %s" % os.path.relpath(args.budget, ROOT))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
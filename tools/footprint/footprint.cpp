@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+ *
+ * SPDX-License-Identifier: MIT
+ */
+/*
+  Firmware for footprint measurement (See tools/footprint.py)
+  M5_UNIT_COLOR_FOOTPRINT_LEVEL
+  0: Minimal (periodic measurement and raw values)
+  1: Typical (+ lux/CT, calibration, gamma and pipeline)
+  2: Full (+ single shot sequence, saturation recovery, inference, output streams, drift monitor,
+     online calibrator, hot swap, memo cache, cross-core stage and sensor array)
+*/
+#include <Arduino.h>
+#include <Wire.h>
+#include <M5UnitUnified.h>
+#include <M5UnitUnifiedCOLOR.h>
+
+#if !defined(M5_UNIT_COLOR_FOOTPRINT_LEVEL)
+#define M5_UNIT_COLOR_FOOTPRINT_LEVEL (0)
+#endif
+
+using namespace m5::unit::tcs3472x;
+
+namespace {
+m5::unit::UnitUnified Units;
+m5::unit::UnitColor unit;
+
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 1
+const Calibration calib{0x0075, 0x0AFE, 0x00A1, 0x15A6, 0x00AF, 0x194D};
+#if defined(M5_UNIT_COLOR_UTILITY_UNIT_COLOR_UTILITY_CAN_CONSTEXPR_MAKE_GAMMA_TABLE)
+constexpr auto gammaTable = make_gamma_table(2.2f);
+#else
+std::array<uint8_t, 256> gammaTable = make_gamma_table(2.2f);
+#endif
+pipeline::Pipeline<pipeline::NoIR, pipeline::Calibrate, pipeline::Gamma, pipeline::RGB565> toColor{
+    pipeline::Calibrate{calib}, pipeline::Gamma{gammaTable}};
+#endif
+
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 2
+constexpr inference::TreeNode nodes[] = {
+    {7, -13, 1, 2},
+    {inference::TreeNode::LEAF, 0, 0, 0},
+    {inference::TreeNode::LEAF, 0, 1, 0},
+};
+constexpr uint16_t roots[] = {0};
+constexpr inference::DecisionForest<inference::NUMBER_OF_FEATURES, 2> forest{nodes, roots, 1, 4, 3};
+static_assert(forest.valid(), "Malformed model");
+
+uint8_t classify_sample(const Data& d)
+{
+    return forest.classify(inference::extractFeatures(d, d.atime, d.gain));
+}
+float to_lux(const Data& d)
+{
+    return calculateLux(d.R16(), d.G16(), d.B16(), d.C16(), atime_to_ms(d.atime), d.gain);
+}
+
+spc::Monitor monitor{};
+calibrator::Online online{calib};
+hotswap::Holder<Calibration> published{calib};
+auto classify = memo::make_cache<64>(&classify_sample);
+soa::SensorArray<1> sensors{};
+crosscore::Ring<Data, 8> samples{};
+crosscore::Stage<Data, float (*)(const Data&), 8> luxStage{samples, &to_lux};
+crosscore::Task luxTask{};
+#endif
+
+volatile uint32_t sink{};
+}  // namespace
+
+void setup()
+{
+    Serial.begin(115200);
+    Wire.begin();
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 2
+    auto cfg                = unit.config();
+    cfg.saturation_recovery = true;
+    unit.config(cfg);
+#endif
+    if (!Units.add(unit, Wire) || !Units.begin()) {
+        Serial.println("Failed to begin");
+    }
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 2
+    unit.addStream(10, Aggregation::Mean);
+    unit.setDriftMonitor(&monitor);
+    sensors.add(unit);
+    luxTask.start(luxStage, "lux", 0);
+#endif
+}
+
+void loop()
+{
+    Units.update();
+    if (unit.updated()) {
+        const auto& d = unit.oldest();
+        sink          = d.R16() + d.G16() + d.B16() + d.C16();
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 1
+        sink = sink + toColor(d);
+        sink = sink + static_cast<uint32_t>(calculateLux(d.R16(), d.G16(), d.B16(), d.C16(), atime_to_ms(d.atime),
+                                                         d.gain) +
+                                            calculateColorTemperature(d.R16(), d.G16(), d.B16(), d.C16()));
+#endif
+#if M5_UNIT_COLOR_FOOTPRINT_LEVEL >= 2
+        sink = sink + classify(d);
+        if (online.push(d)) {
+            published.tryPublish(online.calibration());
+        }
+        {
+            auto snap = published.read();
+            sink      = sink + snap->R8(d);
+        }
+        samples.push(d);
+        float lux{};
+        while (luxStage.output().pop(lux)) {
+            sink = sink + static_cast<uint32_t>(lux);
+        }
+        sensors.collect();
+        sensors.process();
+        sink = sink + sensors.classes()[0] + monitor.alarm();
+        if (unit.streamUpdated(0)) {
+            sink = sink + unit.streamData(0).C16();
+        }
+        if (unit.stopPeriodicMeasurement()) {
+            const std::array<Exposure, 2> bracket{{{Gain::Controlx1, 0xF6}, {Gain::Controlx16, 0xF6}}};
+            std::array<Data, 2> out{};
+            if (unit.measureSingleshotSequence(out, bracket)) {
+                sink = sink + out[1].C16();
+            }
+            unit.startPeriodicMeasurement();
+        }
+#endif
+    }
+}
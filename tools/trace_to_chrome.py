@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2025 M5Stack Technology CO LTD
+#
+# SPDX-License-Identifier: MIT
+"""
+Convert the trace ring of m5::unit::tcs3472x::trace (src/utility/unit_color_trace.hpp)
+into Chrome trace format (chrome://tracing, https://ui.perfetto.dev).
+
+Build with -DM5_UNIT_COLOR_ENABLE_TRACE, then dump the ring either as raw
+binary (array of 12-byte Event) or as text, one event per line prefixed by
+"TRACE:" and followed by the 24 hex digits of the Event bytes:
+
+  m5::unit::tcs3472x::trace::Event ev[M5_UNIT_COLOR_TRACE_SIZE];
+  auto n = m5::unit::tcs3472x::trace::ring().snapshot(ev, M5_UNIT_COLOR_TRACE_SIZE);
+  for (size_t i = 0; i < n; ++i) {
+      auto p = reinterpret_cast<const uint8_t*>(&ev[i]);
+      Serial.print("TRACE:");
+      for (size_t b = 0; b < sizeof(ev[i]); ++b) { Serial.printf("%02x", p[b]); }
+      Serial.println();
+  }
+
+Usage:
+  trace_to_chrome.py serial.log -o trace.json
+  trace_to_chrome.py --binary ring.bin -o trace.json
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+# Same order as trace::Id
+EVENT_NAMES = [
+    "update",
+    "is_data_ready",
+    "read_measurement",
+    "read_register",
+    "write_register",
+    "retry",
+    "start_periodic",
+    "stop_periodic",
+    "singleshot",
+    "sequence",
+    "synchronize",
+    "trigger_start",
+    "trigger_read",
+]
+
+EVENT = struct.Struct("<IBBHI")
+LINE = re.compile(r"TRACE:([0-9a-fA-F]{24})")
+
+
+def parse_binary(data):
+    for off in range(0, len(data) - EVENT.size + 1, EVENT.size):
+        yield EVENT.unpack_from(data, off)
+
+
+def parse_text(text):
+    for m in LINE.finditer(text):
+        yield EVENT.unpack(bytes.fromhex(m.group(1)))
+
+
+def to_chrome(events):
+    out = []
+    base = None
+    prev = None
+    wrap = 0
+    for ts, eid, ph, a0, a1 in events:
+        # micros() is 32-bit on the target
+        if prev is not None and ts < prev and prev - ts > 0x80000000:
+            wrap += 1 << 32
+        prev = ts
+        t = ts + wrap
+        if base is None:
+            base = t
+        ev = {
+            "name": EVENT_NAMES[eid] if eid < len(EVENT_NAMES) else "id%u" % eid,
+            "ph": chr(ph),
+            "ts": t - base,
+            "pid": 0,
+            "tid": 0,
+        }
+        if ev["ph"] != "E":
+            ev["args"] = {"a0": a0, "a1": a1}
+        if ev["ph"] == "i":
+            ev["s"] = "t"
+        out.append(ev)
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input", help="Text log (TRACE: lines) or binary dump")
+    ap.add_argument("--binary", action="store_true", help="Input is a raw binary dump of Event")
+    ap.add_argument("-o", "--output", help="Output JSON (default: stdout)")
+    args = ap.parse_args()
+
+    if args.binary:
+        with open(args.input, "rb") as f:
+            events = list(parse_binary(f.read()))
+    else:
+        with open(args.input, "r", errors="replace") as f:
+            events = list(parse_text(f.read()))
+
+    trace = to_chrome(events)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    print("%u events" % len(events), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())